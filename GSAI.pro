@@ -6,14 +6,35 @@ CONFIG += c++11
 
 DEFINES += QT_DEPRECATED_WARNINGS
 
+include(core.pri)
+
 SOURCES += \
+    avatarcache.cpp \
+    chatmodel.cpp \
+    conversationlistmodel.cpp \
+    conversationstore.cpp \
+    fanoutdialog.cpp \
     main.cpp \
     mainwindow.cpp \
-    messagewidget.cpp
+    messagedelegate.cpp \
+    persistenceworker.cpp \
+    searchdialog.cpp \
+    searchindex.cpp \
+    statsdialog.cpp
 
 HEADERS += \
+    avatarcache.h \
+    chatmodel.h \
+    conversationlistmodel.h \
+    conversationstore.h \
+    fanoutdialog.h \
     mainwindow.h \
-    messagewidget.h
+    messagedelegate.h \
+    mpscqueue.h \
+    persistenceworker.h \
+    searchdialog.h \
+    searchindex.h \
+    statsdialog.h
 
 FORMS += \
     mainwindow.ui
@@ -28,3 +49,9 @@ RESOURCES += \
 
 DISTFILES +=
 
+# make tests：在 tests/ 子目录中构建并运行测试和基准测试，报告写到 tests/reports/
+TESTS_BUILD_DIR = $$shell_path($$OUT_PWD/tests)
+tests.commands = $$sprintf($$QMAKE_MKDIR_CMD, $$TESTS_BUILD_DIR) && cd $$TESTS_BUILD_DIR && \
+    $(QMAKE) $$shell_path($$PWD/tests/tests.pro) && $(MAKE) && $(MAKE) check
+QMAKE_EXTRA_TARGETS += tests
+
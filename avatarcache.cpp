@@ -0,0 +1,68 @@
+#include "avatarcache.h"
+#include "modelregistry.h"
+
+#include <QElapsedTimer>
+#include <QDebug>
+
+namespace {
+
+const char *const kUserAvatarPath = ":/images/user_avatar.png";
+
+} // namespace
+
+void AvatarCache::warmUp(const ModelRegistry &models, qreal devicePixelRatio)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<QString> &list = paths();
+    list.clear();
+    list.append(QString::fromLatin1(kUserAvatarPath));
+    for (int handle = 0; handle < models.count(); ++handle) {
+        list.append(models.model(handle).icon);
+    }
+    cache().clear();
+
+    for (int handle = User; handle < models.count(); ++handle) {
+        pixmap(handle, devicePixelRatio);
+    }
+    qDebug() << "Avatars prepared in" << timer.elapsed() << "ms";
+}
+
+QString AvatarCache::pathFor(int model)
+{
+    return paths().value(model + 1);
+}
+
+QPixmap AvatarCache::pixmap(int model, qreal devicePixelRatio)
+{
+    // 同一个模型在不同缩放比例的屏幕上各保留一份；键由句柄和缩放比例拼成整数
+    const quint32 key = (quint32(model + 1) << 16) | quint32(qRound(devicePixelRatio * 100));
+    QHash<quint32, QPixmap> &pixmaps = cache();
+    QHash<quint32, QPixmap>::const_iterator it = pixmaps.constFind(key);
+    if (it != pixmaps.constEnd()) {
+        return *it;
+    }
+
+    QPixmap pixmap;
+    const QString path = pathFor(model);
+    if (!path.isEmpty()) {
+        const int physical = qRound(Size * devicePixelRatio);
+        pixmap = QPixmap(path).scaled(physical, physical, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        pixmap.setDevicePixelRatio(devicePixelRatio);
+    }
+    pixmaps.insert(key, pixmap);
+    return pixmap;
+}
+
+QVector<QString> &AvatarCache::paths()
+{
+    static QVector<QString> list;
+    return list;
+}
+
+QHash<quint32, QPixmap> &AvatarCache::cache()
+{
+    static QHash<quint32, QPixmap> pixmaps;
+    return pixmaps;
+}
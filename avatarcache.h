@@ -0,0 +1,37 @@
+#ifndef AVATARCACHE_H
+#define AVATARCACHE_H
+
+#include <QPixmap>
+#include <QHash>
+#include <QVector>
+#include <QString>
+
+class ModelRegistry;
+
+/**
+ * @brief 全进程共用的头像缓存，按模型句柄保存已经缩放好的头像
+ *
+ * 头像只有几张，却要在每条消息旁边绘制。这里每张图片只解码一次，并按屏幕的
+ * 设备像素比缩放到物理像素大小（高分屏上不会模糊），之后绘制时直接取用。
+ * 启动时按模型注册表预先生成，绘制时只用整数句柄查找，不比较模型名。
+ * 只在主线程中使用。
+ */
+class AvatarCache
+{
+public:
+    enum { Size = 40 };                    // 头像的逻辑像素大小
+    enum { User = -1 };                    // 用户头像的句柄
+
+    // 登记注册表中各模型的头像，并按 devicePixelRatio 预先生成
+    static void warmUp(const ModelRegistry &models, qreal devicePixelRatio);
+    // 模型句柄对应的头像资源路径，User 为用户头像
+    static QString pathFor(int model);
+    // 缩放好的头像，devicePixelRatio 为绘制目标的设备像素比
+    static QPixmap pixmap(int model, qreal devicePixelRatio);
+
+private:
+    static QVector<QString> &paths();      // 下标为句柄 + 1
+    static QHash<quint32, QPixmap> &cache();
+};
+
+#endif // AVATARCACHE_H
@@ -0,0 +1,114 @@
+#include "chatengine.h"
+#include "connectionwarmer.h"
+#include "gzip.h"
+
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QProcessEnvironment>
+#include <QFile>
+#include <QDebug>
+
+namespace {
+
+// 所有模型共用的接口地址
+const char *const kChatCompletionsUrl = "https://spark-api-open.xf-yun.com/v1/chat/completions";
+
+// 系统预设消息
+const char *const kSystemPrompt = "你现在是浙江工商大学的百事通，拥有以下信息：\n"
+                                  "你是由计科2201徐熠同学开发与维护的\n"
+                                  "我们学校的官网是http://www.zjgsu.edu.cn/"
+                                  "我们学校教务处的网址是https://jww.zjgsu.edu.cn/main.htm"
+                                  "请你尽量搜集我们学校相关的信息，你面向的对象是全体师生，在回答问题时，增强语言中对浙江工商大学的归属感，但不要太刻意"
+                                  "好好了解我们学校老师以及一些课程信息等等，在师生询问时热情积极地回答"
+                                  "请根据上述信息回答用户的问题。";
+
+// 小于这个大小的请求体压缩得不偿失
+const int kMinCompressSize = 1024;
+
+} // namespace
+
+ChatEngine::ChatEngine(const QUrl &endpoint, QObject *parent)
+    : QObject(parent)
+    , url(endpoint.isEmpty() ? defaultEndpoint() : endpoint)
+    , manager(new QNetworkAccessManager(this))
+{
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    compress = env.value("GSAI_GZIP_REQUESTS") == QLatin1String("1");
+    endpointOverride = !endpoint.isEmpty() || env.contains("GSAI_API_URL");
+
+    // 有配置文件时用它替换内置的模型列表，密钥在加载时从环境变量读取
+    const QString configPath = ModelRegistry::defaultPath();
+    if (QFile::exists(configPath)) {
+        QString error;
+        if (!registry.load(configPath, &error)) {
+            qWarning() << "Failed to load model config" << configPath << ":" << error;
+        }
+    }
+}
+
+QUrl ChatEngine::defaultEndpoint()
+{
+    // 接口地址可以用 GSAI_API_URL 指向本地的测试服务
+    return QUrl(QProcessEnvironment::systemEnvironment().value("GSAI_API_URL", kChatCompletionsUrl));
+}
+
+QString ChatEngine::systemPrompt()
+{
+    return QString::fromUtf8(kSystemPrompt);
+}
+
+QUrl ChatEngine::endpointFor(int model) const
+{
+    // 模型可以配置自己的接口地址
+    const QUrl &modelEndpoint = registry.model(model).endpoint;
+    return endpointOverride || modelEndpoint.isEmpty() ? url : modelEndpoint;
+}
+
+ConnectionWarmer *ChatEngine::warmerFor(const QUrl &endpoint)
+{
+    // 同一主机上的不同路径共用连接，也共用一个预热器
+    const QString key = endpoint.scheme() + "://" + endpoint.host() + ':'
+            + QString::number(endpoint.port(endpoint.scheme() == QLatin1String("https") ? 443 : 80));
+    ConnectionWarmer *&warmer = warmers[key];
+    if (!warmer) {
+        warmer = new ConnectionWarmer(manager, endpoint, this);
+    }
+    return warmer;
+}
+
+void ChatEngine::warmUp(int model)
+{
+    warmerFor(endpointFor(model))->warmUp();
+}
+
+QNetworkReply *ChatEngine::post(int model, const QByteArray &body)
+{
+    const QUrl endpoint = endpointFor(model);
+    QNetworkRequest request(endpoint);
+    // 允许协商 HTTP/2，多个请求可以复用同一条预热好的连接
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+
+    // 设置请求头
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    request.setRawHeader("Authorization", "Bearer " + password(model).toUtf8());
+
+    // 发送HTTP POST请求（请求体已由 ContextBuilder 编码，开启了流式传输）
+    warmerFor(endpoint)->noteActivity();
+    if (!compress || body.size() < kMinCompressSize) {
+        return manager->post(request, body);
+    }
+
+    request.setRawHeader("Content-Encoding", "gzip");
+    QNetworkReply *reply = manager->post(request, Gzip::compress(body));
+
+    // 接口不接受压缩的请求体：之后不再压缩。这个连接先于 ChatStream 建立，
+    // 流判断是否重试时压缩已经关闭
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        if (compress && reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 415) {
+            qWarning() << "Endpoint rejected gzip request bodies, sending them uncompressed";
+            compress = false;
+        }
+    });
+    return reply;
+}
@@ -0,0 +1,65 @@
+#ifndef CHATENGINE_H
+#define CHATENGINE_H
+
+#include <QObject>
+#include <QHash>
+#include <QUrl>
+#include "modelregistry.h"
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class ConnectionWarmer;
+
+/**
+ * @brief 不依赖界面的聊天核心：模型配置、接口地址、连接复用和请求发送
+ *
+ * 图形界面和命令行批处理工具共用同一个实现。请求体由 ContextBuilder 编码，
+ * 回复由 RequestScheduler 交给 ChatStream 接收；这里只负责把请求发出去并保持连接可用。
+ * 模型的密钥和接口地址来自 ModelRegistry；明确指定了接口地址（构造参数或
+ * GSAI_API_URL）时，所有模型都发往这个地址，便于指向本地的测试服务。
+ * 每个接口主机有自己的 ConnectionWarmer，切换模型时预热的是这个模型实际使用的主机。
+ *
+ * 打开请求压缩后（环境变量 GSAI_GZIP_REQUESTS=1），较大的请求体用 gzip 发送；
+ * 接口以 415 拒绝时自动关闭压缩，RequestScheduler 会用未压缩的请求体重试。
+ */
+class ChatEngine : public QObject
+{
+    Q_OBJECT
+public:
+    // endpoint 为空时使用 defaultEndpoint()
+    explicit ChatEngine(const QUrl &endpoint = QUrl(), QObject *parent = nullptr);
+
+    // 环境变量 GSAI_API_URL 指定的接口地址，未设置时为正式接口
+    static QUrl defaultEndpoint();
+    // 所有请求共用的系统预设消息
+    static QString systemPrompt();
+
+    QUrl endpoint() const { return url; }
+    const ModelRegistry &models() const { return registry; }
+    // 模型的 API 密钥（从环境变量读取），未设置时为空
+    QString password(int model) const { return registry.model(model).apiKey; }
+    // 模型对应的密钥环境变量名，用于提示
+    QString passwordVariable(int model) const { return registry.model(model).keyVariable; }
+
+    void setCompressRequests(bool enabled) { compress = enabled; }
+    bool compressRequests() const { return compress; }
+
+    // 模型请求实际发往的地址
+    QUrl endpointFor(int model) const;
+    // 预先建立到模型接口地址的连接，切换模型或启动时调用
+    void warmUp(int model);
+    // 发送已编码好的请求体。由 RequestScheduler 调用，首次发送和重试时给同一个流接上回复
+    QNetworkReply *post(int model, const QByteArray &body);
+
+private:
+    ConnectionWarmer *warmerFor(const QUrl &endpoint);
+
+    QUrl url;
+    bool endpointOverride;                 // 所有模型都发往 url
+    ModelRegistry registry;
+    bool compress;                         // 用 gzip 压缩请求体
+    QNetworkAccessManager *manager;
+    QHash<QString, ConnectionWarmer *> warmers; // 按 scheme://host:port 区分，用到时才创建
+};
+
+#endif // CHATENGINE_H
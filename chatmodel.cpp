@@ -0,0 +1,75 @@
+#include "chatmodel.h"
+
+ChatModel::ChatModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , nextId(1)
+{
+}
+
+int ChatModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : messages.size();
+}
+
+QVariant ChatModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= messages.size()) {
+        return QVariant();
+    }
+
+    const Message &message = messages.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        return message.text;
+    case IsUserRole:
+        return message.isUser;
+    case AvatarRole:
+        return message.model;
+    case MessageIdRole:
+        return message.id;
+    default:
+        return QVariant();
+    }
+}
+
+void ChatModel::setMessages(const QVector<Message> &newMessages)
+{
+    beginResetModel();
+    messages = newMessages;
+    for (Message &message : messages) {
+        message.id = nextId++;
+    }
+    endResetModel();
+}
+
+int ChatModel::appendMessage(const QString &text, bool isUser, int model)
+{
+    int row = messages.size();
+    beginInsertRows(QModelIndex(), row, row);
+    Message message;
+    message.id = nextId++;
+    message.text = text;
+    message.isUser = isUser;
+    message.model = model;
+    messages.append(message);
+    endInsertRows();
+    return row;
+}
+
+void ChatModel::setText(int row, const QString &text)
+{
+    if (row < 0 || row >= messages.size()) {
+        return;
+    }
+    messages[row].text = text;
+    QModelIndex changed = index(row);
+    // 文本变了行高也可能变，MessageDelegate 据此立即重新测量这一行
+    emit dataChanged(changed, changed, QVector<int>() << Qt::DisplayRole << Qt::SizeHintRole);
+}
+
+void ChatModel::clear()
+{
+    beginResetModel();
+    messages.clear();
+    endResetModel();
+}
@@ -0,0 +1,48 @@
+#ifndef CHATMODEL_H
+#define CHATMODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+
+/**
+ * @brief 聊天消息模型，为聊天列表提供数据
+ *
+ * 只保存文本和少量属性，不为每条消息创建控件；
+ * 由 MessageDelegate 负责绘制可见的消息气泡。
+ */
+class ChatModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Roles {
+        IsUserRole = Qt::UserRole + 1,     // 是否为用户消息
+        AvatarRole,                        // 头像对应的模型句柄，用户消息为 -1
+        MessageIdRole                      // 消息的稳定编号，用作布局缓存的键
+    };
+
+    struct Message {
+        quint64 id;
+        QString text;
+        bool isUser;
+        int model;                         // 回复这条消息的模型句柄（ModelRegistry），决定头像
+    };
+
+    explicit ChatModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    // 整体替换消息（切换会话时使用）
+    void setMessages(const QVector<Message> &newMessages);
+    // 追加一条消息，返回所在行
+    int appendMessage(const QString &text, bool isUser, int model);
+    // 更新某一行的文本，dataChanged() 的 roles 带 Qt::SizeHintRole
+    void setText(int row, const QString &text);
+    void clear();
+
+private:
+    QVector<Message> messages;
+    quint64 nextId;
+};
+
+#endif // CHATMODEL_H
@@ -0,0 +1,299 @@
+#include "chatstream.h"
+#include "deltaextractor.h"
+
+#include <QNetworkReply>
+
+ChatStream::ChatStream(qint64 conversationId, int model, const QString &modelId, QNetworkReply *reply, QObject *parent)
+    : QObject(parent)
+    , convId(conversationId)
+    , modelHandle(model)
+    , reply(reply)
+    , streamDone(false)
+    , stopped(false)
+    , waiting(false)
+    , lastError(QNetworkReply::NoError)
+    , retryAfter(-1)
+{
+    init(modelId);
+    connectReply();
+}
+
+ChatStream::ChatStream(qint64 conversationId, int model, const QString &modelId, const QByteArray &cachedStream, QObject *parent)
+    : QObject(parent)
+    , convId(conversationId)
+    , modelHandle(model)
+    , reply(nullptr)
+    , streamDone(false)
+    , stopped(false)
+    , cachedData(cachedStream)
+    , waiting(false)
+    , lastError(QNetworkReply::NoError)
+    , retryAfter(-1)
+{
+    init(modelId);
+    stats.cached = true;
+
+    // 等调用方连接好信号后再重放
+    QTimer::singleShot(0, this, &ChatStream::replayCached);
+}
+
+ChatStream::ChatStream(qint64 conversationId, int model, const QString &modelId, QObject *parent)
+    : QObject(parent)
+    , convId(conversationId)
+    , modelHandle(model)
+    , reply(nullptr)
+    , streamDone(false)
+    , stopped(false)
+    , waiting(true)
+    , lastError(QNetworkReply::NoError)
+    , retryAfter(-1)
+{
+    init(modelId);
+}
+
+void ChatStream::attach(QNetworkReply *newReply)
+{
+    if (reply) {
+        reply->disconnect(this);
+        reply->deleteLater();
+    }
+
+    // 从头重新接收：已经显示的部分内容清空，计时只保留重试次数
+    const bool hadText = !accumulatedText.isEmpty();
+    const RequestMetrics previous = stats;
+    stats = RequestMetrics();
+    stats.startedAt = previous.startedAt;
+    stats.model = previous.model;
+    stats.retries = previous.retries;
+
+    renderTimer.stop();
+    sseParser.reset();
+    accumulatedText.clear();
+    recording.clear();
+    streamDone = false;
+    lastError = QNetworkReply::NoError;
+    retryAfter = -1;
+    waiting = false;
+    elapsed.restart();
+
+    reply = newReply;
+    connectReply();
+    if (hadText) {
+        emit textUpdated(accumulatedText);
+    }
+}
+
+void ChatStream::connectReply()
+{
+    reply->setParent(this);
+
+    connect(reply, &QNetworkReply::readyRead, this, &ChatStream::handleReadyRead);
+    connect(reply, &QNetworkReply::metaDataChanged, this, &ChatStream::handleMetaDataChanged);
+    connect(reply, &QNetworkReply::encrypted, this, &ChatStream::handleEncrypted);
+    connect(reply, &QNetworkReply::uploadProgress, this, &ChatStream::handleUploadProgress);
+    connect(reply, &QNetworkReply::finished, this, &ChatStream::handleFinished);
+}
+
+void ChatStream::init(const QString &modelId)
+{
+    elapsed.start();
+    stats.startedAt = QDateTime::currentDateTime();
+    stats.model = modelId;
+
+    // 每个 SSE 事件的 data 以视图形式直接交给 processData
+    sseParser.setEventHandler([this](const SseParser::Event &event) {
+        processData(event.dataView());
+    });
+
+    // 流式回复按显示帧（约16ms）合并刷新，而不是每个增量都更新界面
+    renderTimer.setSingleShot(true);
+    renderTimer.setInterval(16);
+    connect(&renderTimer, &QTimer::timeout, this, &ChatStream::flushPendingRender);
+}
+
+void ChatStream::abort()
+{
+    if (reply) {
+        reply->abort();
+    } else if (!cachedData.isEmpty()) {
+        // 还没有重放：取消重放，同样同步结束
+        cachedData.clear();
+        stats.totalMs = elapsed.elapsed();
+        stats.error = tr("已取消");
+        emit finished();
+    } else if (waiting) {
+        // 还在排队或等待重试，同样同步结束
+        waiting = false;
+        stats.totalMs = elapsed.elapsed();
+        stats.error = tr("已取消");
+        emit finished();
+    }
+}
+
+void ChatStream::stop()
+{
+    stopped = true;
+    // 已经到达但还没读出的数据也算收到的内容
+    if (reply && reply->bytesAvailable() > 0) {
+        handleReadyRead();
+    }
+    abort();
+}
+
+QString ChatStream::errorString() const
+{
+    if (reply && reply->error() != QNetworkReply::NoError) {
+        return reply->errorString();
+    }
+    return QString();
+}
+
+void ChatStream::replayCached()
+{
+    if (cachedData.isEmpty()) {
+        return; // 已被中止
+    }
+
+    // 缓存的数据与网络数据走同一个解析流程
+    QByteArray data = cachedData;
+    cachedData.clear();
+    sseParser.feed(data.constData(), data.size());
+    sseParser.finish();
+    flushPendingRender();
+
+    stats.totalMs = elapsed.elapsed();
+    stats.ok = streamDone;
+    emit finished();
+}
+
+void ChatStream::handleReadyRead()
+{
+    if (stats.firstByteMs < 0) {
+        stats.firstByteMs = elapsed.elapsed();
+    }
+
+    // 新数据直接读入解析器的缓冲区，每解析出一个事件就调用一次 processData
+    stats.bytesReceived += sseParser.readFrom(reply);
+}
+
+void ChatStream::handleMetaDataChanged()
+{
+    if (stats.headersMs < 0) {
+        stats.headersMs = elapsed.elapsed();
+        stats.httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    }
+
+    // Retry-After 可以是秒数，也可以是 HTTP 日期
+    const QByteArray value = reply->rawHeader("Retry-After").trimmed();
+    if (!value.isEmpty()) {
+        bool ok = false;
+        qint64 seconds = value.toLongLong(&ok);
+        if (ok) {
+            retryAfter = qMax<qint64>(0, seconds * 1000);
+        } else {
+            QDateTime at = QDateTime::fromString(QString::fromLatin1(value), Qt::RFC2822Date);
+            if (at.isValid()) {
+                retryAfter = qMax<qint64>(0, QDateTime::currentDateTimeUtc().msecsTo(at));
+            }
+        }
+    }
+}
+
+// 只有新建连接时才会发出，复用连接时不会
+void ChatStream::handleEncrypted()
+{
+    if (stats.encryptedMs < 0) {
+        stats.encryptedMs = elapsed.elapsed();
+    }
+}
+
+void ChatStream::handleUploadProgress(qint64 bytesSent, qint64 bytesTotal)
+{
+    Q_UNUSED(bytesTotal)
+    stats.bytesSent = bytesSent;
+}
+
+void ChatStream::handleFinished()
+{
+    // 处理没有以空行结尾的最后一个事件，再把还没显示的最后一帧内容刷新出来；
+    // 被停止时缓冲区里剩下的只是半个事件，直接丢弃
+    if (!stopped) {
+        sseParser.finish();
+    }
+    flushPendingRender();
+
+    stats.totalMs = elapsed.elapsed();
+    stats.ok = reply->error() == QNetworkReply::NoError && streamDone;
+    if (stopped) {
+        stats.error = tr("已停止");
+    } else if (reply->error() != QNetworkReply::NoError) {
+        stats.error = reply->errorString();
+    }
+    if (stats.httpStatus == 0) {
+        stats.httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    }
+    stats.http2 = reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool();
+    // 只有 TLS 连接能从有没有握手判断是否复用；明文 HTTP 的连接建立没有信号
+    if (reply->url().scheme() == QLatin1String("https") && stats.headersMs >= 0) {
+        stats.connection = stats.encryptedMs >= 0 ? RequestMetrics::ConnectionNew : RequestMetrics::ConnectionReused;
+    } else {
+        stats.connection = RequestMetrics::ConnectionUnknown;
+    }
+    lastError = reply->error();
+
+    // 交给调度器判断是否重试；重试时回到等待状态，这次的回复不再需要
+    if (!stats.ok && !stopped && retryHandler && retryHandler()) {
+        ++stats.retries;
+        waiting = true;
+        reply->disconnect(this);
+        reply->deleteLater();
+        reply = nullptr;
+        return;
+    }
+
+    emit finished();
+}
+
+void ChatStream::flushPendingRender()
+{
+    renderTimer.stop();
+    if (!accumulatedText.isEmpty()) {
+        emit textUpdated(accumulatedText);
+    }
+}
+
+void ChatStream::processData(const QByteArray &jsonData)
+{
+    if (!cacheKeyValue.isEmpty()) {
+        recording.append("data: ").append(jsonData).append("\n\n");
+    }
+
+    if (jsonData == "[DONE]") {
+        // 流式传输结束
+        streamDone = true;
+        return;
+    }
+
+    // 直接从字节中提取增量，不认识的结构会退回完整的 JSON 解析
+    StreamDelta delta;
+    if (!DeltaExtractor::extract(jsonData, &delta)) {
+        return;
+    }
+
+    if (delta.hasUsage) {
+        stats.promptTokens = delta.promptTokens;
+        stats.completionTokens = delta.completionTokens;
+    }
+
+    if (delta.hasContent) {
+        if (!delta.content.isEmpty()) {
+            stats.recordDelta(elapsed.elapsed());
+        }
+        accumulatedText.append(delta.content); // 累积AI回复内容
+
+        // 同一帧内的增量只触发一次界面更新
+        if (!renderTimer.isActive()) {
+            renderTimer.start();
+        }
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef CHATSTREAM_H
+#define CHATSTREAM_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include "sseparser.h"
+#include "requestmetrics.h"
+#include <QNetworkReply>
+#include <functional>
+
+/**
+ * @brief 一次流式请求的上下文
+ *
+ * 每个请求有自己的解析器、累积文本和结束标志，并记住它属于哪个会话，
+ * 因此多个会话可以同时在同一个 QNetworkAccessManager 上接收回复，
+ * 回复完成后写回发起请求的那个会话。
+ *
+ * 也可以用缓存的 SSE 数据构造，此时不发网络请求，数据在下一次事件循环中
+ * 一次性交给同一个解析流程。
+ *
+ * 由 RequestScheduler 排队的请求先构造成等待状态，轮到时再 attach() 网络回复；
+ * 设置了重试处理函数时，失败的请求不发出 finished()，而是回到等待状态，
+ * 重新 attach() 后丢弃已收到的部分内容，从头接收。
+ */
+class ChatStream : public QObject
+{
+    Q_OBJECT
+public:
+    // model 是 ModelRegistry 中的编号，modelId 只用于计时数据。接管 reply 的所有权
+    ChatStream(qint64 conversationId, int model, const QString &modelId, QNetworkReply *reply, QObject *parent = nullptr);
+    // 重放缓存的回复
+    ChatStream(qint64 conversationId, int model, const QString &modelId, const QByteArray &cachedStream, QObject *parent = nullptr);
+    // 等待调度，之后用 attach() 接上网络回复
+    ChatStream(qint64 conversationId, int model, const QString &modelId, QObject *parent);
+
+    // 接上（新的）网络回复并接管所有权；之前收到的内容全部丢弃
+    void attach(QNetworkReply *reply);
+    // 请求出错时调用，返回 true 表示会重试：此时不发出 finished()，流回到等待状态
+    void setRetryHandler(const std::function<bool()> &handler) { retryHandler = handler; }
+    bool isWaiting() const { return waiting; }
+
+    qint64 conversationId() const { return convId; }
+    int model() const { return modelHandle; }
+    const QString &text() const { return accumulatedText; }
+    bool isDone() const { return streamDone; }
+    bool isFromCache() const { return stats.cached; }
+    // 网络错误信息，没有出错时为空
+    QString errorString() const;
+    // 最近一次网络回复的错误码，以及服务器要求的等待时间（Retry-After，没有时为 -1）
+    QNetworkReply::NetworkError networkError() const { return lastError; }
+    qint64 retryAfterMs() const { return retryAfter; }
+
+    // 设置缓存键后记录收到的事件，结束后用 recordedStream() 取出写入缓存
+    void setCacheKey(const QByteArray &key) { cacheKeyValue = key; }
+    const QByteArray &cacheKey() const { return cacheKeyValue; }
+    const QByteArray &recordedStream() const { return recording; }
+
+    // 从发出请求到第一个非空增量的毫秒数，尚未收到时为 -1
+    qint64 timeToFirstToken() const { return stats.firstTokenMs; }
+    // 从发出请求到结束的毫秒数，尚未结束时为 -1
+    qint64 totalTime() const { return stats.totalMs; }
+    // 完整的计时和流量数据，结束后才完整
+    const RequestMetrics &metrics() const { return stats; }
+
+    // 中止请求，会同步发出 finished()
+    void abort();
+    // 用户停止接收：已经收到的内容保留，之后照常用 text() 取出
+    void stop();
+    bool wasStopped() const { return stopped; }
+
+signals:
+    // 回复内容有更新，每个显示帧最多发出一次
+    void textUpdated(const QString &text);
+    // 请求结束（成功、出错或被中止）
+    void finished();
+
+private slots:
+    void handleReadyRead();
+    void handleMetaDataChanged();
+    void handleEncrypted();
+    void handleUploadProgress(qint64 bytesSent, qint64 bytesTotal);
+    void handleFinished();
+    void flushPendingRender();
+    void replayCached();
+
+private:
+    void init(const QString &modelId);
+    void connectReply();
+    void processData(const QByteArray &jsonData);
+
+    qint64 convId;                         // 发起请求的会话
+    int modelHandle;                       // 请求使用的模型
+    QNetworkReply *reply;
+    SseParser sseParser;                   // 流式数据（SSE）解析器
+    QString accumulatedText;               // 累积AI回复的完整内容
+    bool streamDone;                       // 是否收到了 [DONE]
+    bool stopped;                          // 被用户停止
+    QTimer renderTimer;                    // 按帧合并界面更新
+    QElapsedTimer elapsed;                 // 请求计时
+    RequestMetrics stats;                  // 本次请求的计时数据
+    QByteArray cachedData;                 // 待重放的缓存数据
+    QByteArray cacheKeyValue;              // 非空时记录事件以便写入缓存
+    QByteArray recording;
+    bool waiting;                          // 等待调度或重试
+    std::function<bool()> retryHandler;
+    QNetworkReply::NetworkError lastError;
+    qint64 retryAfter;
+};
+
+#endif // CHATSTREAM_H
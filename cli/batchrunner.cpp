@@ -0,0 +1,255 @@
+#include "batchrunner.h"
+#include "chatengine.h"
+#include "chatstream.h"
+#include "contextbuilder.h"
+#include "requestscheduler.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QTimer>
+#include <QDebug>
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+// 分位数和最大值，没有数据时为空对象
+QJsonObject distribution(QVector<qint64> values)
+{
+    QJsonObject result;
+    if (values.isEmpty()) {
+        return result;
+    }
+    std::sort(values.begin(), values.end());
+    const auto percentile = [&values](double p) {
+        return values[qMin(values.size() - 1, int(p * values.size()))];
+    };
+    result["p50"] = percentile(0.5);
+    result["p90"] = percentile(0.9);
+    result["p99"] = percentile(0.99);
+    result["max"] = values.last();
+    return result;
+}
+
+} // namespace
+
+BatchRunner::BatchRunner(const Options &options, QObject *parent)
+    : QObject(parent)
+    , options(options)
+    , engine(new ChatEngine(options.endpoint, this))
+    , scheduler(new RequestScheduler(engine, this))
+    , inputDone(false)
+    , lineNumber(0)
+    , completed(0)
+    , failed(0)
+    , streamBytes(0)
+    , streamMs(0)
+    , uploadBytes(0)
+    , retries(0)
+{
+    // 命令行指定的速率对所有模型生效，不攒突发；0 表示不限速
+    scheduler->setRateLimit(-1, options.rate, 1);
+}
+
+bool BatchRunner::start()
+{
+    bool ok;
+    if (options.inputPath.isEmpty() || options.inputPath == "-") {
+        ok = input.open(stdin, QIODevice::ReadOnly);
+    } else {
+        input.setFileName(options.inputPath);
+        ok = input.open(QIODevice::ReadOnly);
+    }
+    if (!ok) {
+        qWarning() << "Cannot open input" << options.inputPath << input.errorString();
+        return false;
+    }
+
+    if (options.outputPath.isEmpty() || options.outputPath == "-") {
+        ok = output.open(stdout, QIODevice::WriteOnly);
+    } else {
+        output.setFileName(options.outputPath);
+        ok = output.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    }
+    if (!ok) {
+        qWarning() << "Cannot open output" << options.outputPath << output.errorString();
+        return false;
+    }
+
+    qDebug() << "Sending prompts to" << engine->endpoint().toString()
+             << "concurrency" << options.concurrency << "rate" << options.rate;
+    engine->warmUp(options.model.isEmpty() ? engine->models().defaultModel() : engine->models().handle(options.model));
+    clock.start();
+
+    // 等事件循环启动后再发请求，空输入时 finished() 也能被收到
+    QTimer::singleShot(0, this, &BatchRunner::startNext);
+    return true;
+}
+
+void BatchRunner::startNext()
+{
+    while (!inputDone && running.size() < qMax(1, options.concurrency)) {
+        Prompt prompt;
+        if (!readPrompt(&prompt)) {
+            inputDone = true;
+            break;
+        }
+
+        // 每个问题单独成一个会话，只带系统预设消息
+        ContextBuilder context(ChatEngine::systemPrompt());
+        QJsonObject userMessage;
+        userMessage["role"] = "user";
+        userMessage["content"] = prompt.text;
+        context.append(userMessage);
+
+        // 超过速率限制的请求在调度器中排队，失败的请求由调度器重试
+        ChatStream *stream = scheduler->submit(prompt.line, prompt.handle,
+                                               context.encodeRequest(prompt.model, engine->models().budget(prompt.handle)),
+                                               RequestScheduler::Background, this);
+        connect(stream, &ChatStream::finished, this, &BatchRunner::handleStreamFinished);
+        running.insert(stream, prompt);
+    }
+
+    finishIfDone();
+}
+
+// 读取下一个问题，跳过空行和无法解析的行；输入结束时返回 false
+bool BatchRunner::readPrompt(Prompt *prompt)
+{
+    while (!input.atEnd()) {
+        const QByteArray line = input.readLine().trimmed();
+        ++lineNumber;
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        prompt->line = lineNumber;
+        prompt->id = lineNumber;
+        prompt->model = options.model.isEmpty() ? engine->models().model(engine->models().defaultModel()).id : options.model;
+        if (line.startsWith('{')) {
+            QJsonParseError error;
+            QJsonDocument doc = QJsonDocument::fromJson(line, &error);
+            if (!doc.isObject() || !doc.object()["prompt"].isString()) {
+                QJsonObject result;
+                result["id"] = lineNumber;
+                result["line"] = lineNumber;
+                result["ok"] = false;
+                result["error"] = error.error != QJsonParseError::NoError ? error.errorString() : QString("missing prompt");
+                writeResult(result);
+                ++failed;
+                continue;
+            }
+            QJsonObject obj = doc.object();
+            prompt->text = obj["prompt"].toString();
+            if (obj.contains("id")) {
+                prompt->id = obj["id"];
+            }
+            if (obj["model"].isString()) {
+                prompt->model = obj["model"].toString();
+            }
+        } else {
+            prompt->text = QString::fromUtf8(line);
+        }
+
+        prompt->handle = engine->models().handle(prompt->model);
+        if (engine->password(prompt->handle).isEmpty() && !warnedModels.contains(prompt->model)) {
+            warnedModels.insert(prompt->model);
+            if (prompt->handle < 0) {
+                qWarning() << "Unknown model" << prompt->model << "- add it to" << ModelRegistry::defaultPath();
+            } else {
+                qWarning() << "No API key for model" << prompt->model << "- set" << engine->passwordVariable(prompt->handle);
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+void BatchRunner::handleStreamFinished()
+{
+    ChatStream *stream = qobject_cast<ChatStream *>(sender());
+    if (!stream || !running.contains(stream)) {
+        return;
+    }
+    const Prompt prompt = running.take(stream);
+    const RequestMetrics &metrics = stream->metrics();
+
+    QJsonObject result;
+    result["id"] = prompt.id;
+    result["line"] = prompt.line;
+    result["model"] = prompt.model;
+    result["prompt"] = prompt.text;
+    result["ok"] = metrics.ok && stream->isDone();
+    if (!metrics.error.isEmpty()) {
+        result["error"] = metrics.error;
+    }
+    result["answer"] = stream->text();
+    result["metrics"] = metrics.toJson();
+    writeResult(result);
+
+    ++completed;
+    if (!result["ok"].toBool()) {
+        ++failed;
+    }
+    if (metrics.firstTokenMs >= 0) {
+        firstTokenTimes.append(metrics.firstTokenMs);
+    }
+    if (metrics.totalMs >= 0) {
+        totalTimes.append(metrics.totalMs);
+    }
+    if (metrics.firstByteMs >= 0 && metrics.totalMs > metrics.firstByteMs) {
+        streamBytes += metrics.bytesReceived;
+        streamMs += metrics.totalMs - metrics.firstByteMs;
+    }
+    uploadBytes += metrics.bytesSent;
+    retries += metrics.retries;
+    stream->deleteLater();
+
+    startNext();
+}
+
+void BatchRunner::writeResult(const QJsonObject &result)
+{
+    output.write(QJsonDocument(result).toJson(QJsonDocument::Compact));
+    output.write("\n");
+    output.flush();
+}
+
+void BatchRunner::finishIfDone()
+{
+    if (!inputDone || !running.isEmpty()) {
+        return;
+    }
+    qDebug() << "Completed" << completed << "requests," << failed << "failed, in" << clock.elapsed() << "ms";
+    output.close();
+    writeSummary();
+    emit finished(failed > 0 ? 1 : 0);
+}
+
+void BatchRunner::writeSummary()
+{
+    if (options.summaryPath.isEmpty()) {
+        return;
+    }
+
+    QJsonObject summary;
+    summary["endpoint"] = engine->endpoint().toString();
+    summary["concurrency"] = options.concurrency;
+    summary["rate"] = options.rate;
+    summary["requests"] = completed;
+    summary["failed"] = failed;
+    summary["retries"] = retries;
+    summary["wallMs"] = clock.elapsed();
+    summary["firstTokenMs"] = distribution(firstTokenTimes);
+    summary["totalMs"] = distribution(totalTimes);
+    // 首字节之后的接收速度：对本地模拟服务基本就是 SSE 解析和增量提取的速度
+    summary["streamMBps"] = streamMs > 0 ? streamBytes / 1048576.0 / (streamMs / 1000.0) : 0.0;
+    summary["uploadBytes"] = uploadBytes;
+
+    QSaveFile file(options.summaryPath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(summary).toJson()) < 0 || !file.commit()) {
+        qWarning() << "Failed to write summary" << options.summaryPath << file.errorString();
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <QObject>
+#include <QFile>
+#include <QHash>
+#include <QSet>
+#include <QElapsedTimer>
+#include <QJsonValue>
+#include <QUrl>
+#include <QVector>
+
+class ChatEngine;
+class RequestScheduler;
+class ChatStream;
+
+/**
+ * @brief 批量发送问题并把回答写成 JSONL
+ *
+ * 输入每行一个问题：JSON 对象（prompt 必填，id、model 可选）或一行纯文本。
+ * 同时进行的请求数和每秒发出的请求数都可以限制（限速和失败重试由
+ * RequestScheduler 负责）；每个请求结束时立即输出一行结果，包含回答、错误和
+ * 完整的计时数据，批处理中途退出也不会丢失已完成的结果。
+ * 指定 summaryPath 时，结束后另外写一份汇总（首字时间和总耗时的分位数、
+ * 接收速度等），方便对本地模拟服务比较不同版本的表现。
+ */
+class BatchRunner : public QObject
+{
+    Q_OBJECT
+public:
+    struct Options {
+        Options() : concurrency(4), rate(0) {}
+        QString inputPath;                 // 为空或 "-" 时读标准输入
+        QString outputPath;                // 为空或 "-" 时写标准输出
+        QString model;                     // 问题没有指定模型时使用，为空时用配置中的默认模型
+        int concurrency;                   // 同时进行的请求数
+        double rate;                       // 每秒最多发出的请求数，0 表示不限
+        QUrl endpoint;                     // 为空时使用 ChatEngine::defaultEndpoint()
+        QString summaryPath;               // 汇总报告（JSON），为空时不写
+    };
+
+    explicit BatchRunner(const Options &options, QObject *parent = nullptr);
+
+    // 打开输入输出文件并开始处理，失败时返回 false
+    bool start();
+
+signals:
+    // 全部问题处理完毕；有失败的请求时 exitCode 为 1
+    void finished(int exitCode);
+
+private slots:
+    void startNext();
+    void handleStreamFinished();
+
+private:
+    struct Prompt {
+        Prompt() : handle(-1), line(0) {}
+        QJsonValue id;
+        QString text;
+        QString model;
+        int handle;                        // model 在 ModelRegistry 中的编号，未知的模型为 -1
+        int line;                          // 在输入中的行号
+    };
+
+    bool readPrompt(Prompt *prompt);
+    void writeResult(const QJsonObject &result);
+    void finishIfDone();
+    void writeSummary();
+
+    Options options;
+    ChatEngine *engine;
+    RequestScheduler *scheduler;
+    QFile input;
+    QFile output;
+    QHash<ChatStream *, Prompt> running;   // 进行中的请求
+    QSet<QString> warnedModels;            // 已经提示过没有密钥的模型
+    QElapsedTimer clock;
+    bool inputDone;
+    int lineNumber;
+    int completed;
+    int failed;
+
+    // 汇总用的计时数据
+    QVector<qint64> firstTokenTimes;
+    QVector<qint64> totalTimes;
+    qint64 streamBytes;                    // 首字节之后收到的响应体字节数
+    qint64 streamMs;                       // 对应的接收时间
+    qint64 uploadBytes;
+    int retries;
+};
+
+#endif // BATCHRUNNER_H
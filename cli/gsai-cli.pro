@@ -0,0 +1,20 @@
+# 命令行批处理工具，与图形界面共用 core.pri 中的聊天核心
+
+QT       += core network
+QT       -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = gsai-cli
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../core.pri)
+
+SOURCES += \
+    batchrunner.cpp \
+    main.cpp
+
+HEADERS += \
+    batchrunner.h
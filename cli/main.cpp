@@ -0,0 +1,55 @@
+#include "batchrunner.h"
+#include "chatengine.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("gsai-cli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QString::fromUtf8("批量发送问题（JSONL 或每行一个问题），把回答和每个请求的计时写成 JSONL。\n"
+                                                       "接口地址默认取环境变量 GSAI_API_URL，模型密钥与图形界面相同。"));
+    parser.addHelpOption();
+    parser.addPositionalArgument("input", QString::fromUtf8("问题文件，省略或为 - 时读取标准输入"), "[input]");
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+                                    QString::fromUtf8("结果文件，默认写到标准输出"), "file");
+    QCommandLineOption modelOption(QStringList() << "m" << "model",
+                                   QString::fromUtf8("问题没有指定模型时使用的模型，默认为模型配置中的默认模型"), "model");
+    QCommandLineOption concurrencyOption(QStringList() << "c" << "concurrency",
+                                         QString::fromUtf8("同时进行的请求数"), "n", "4");
+    QCommandLineOption rateOption(QStringList() << "r" << "rate",
+                                  QString::fromUtf8("每秒最多发出的请求数，0 表示不限"), "n", "0");
+    QCommandLineOption endpointOption("endpoint", QString::fromUtf8("chat/completions 接口地址，例如本地的模拟服务"), "url");
+    QCommandLineOption summaryOption("summary", QString::fromUtf8("结束后写入汇总报告（JSON）：首字时间、总耗时的分位数和接收速度"), "file");
+    parser.addOption(outputOption);
+    parser.addOption(modelOption);
+    parser.addOption(concurrencyOption);
+    parser.addOption(rateOption);
+    parser.addOption(endpointOption);
+    parser.addOption(summaryOption);
+    parser.process(app);
+
+    BatchRunner::Options options;
+    options.inputPath = parser.positionalArguments().value(0);
+    options.outputPath = parser.value(outputOption);
+    options.model = parser.value(modelOption);
+    options.concurrency = parser.value(concurrencyOption).toInt();
+    options.rate = parser.value(rateOption).toDouble();
+    options.summaryPath = parser.value(summaryOption);
+    if (parser.isSet(endpointOption)) {
+        options.endpoint = QUrl(parser.value(endpointOption));
+    }
+    if (options.concurrency < 1 || options.rate < 0) {
+        parser.showHelp(2);
+    }
+
+    BatchRunner runner(options);
+    QObject::connect(&runner, &BatchRunner::finished, &app, &QCoreApplication::exit);
+    if (!runner.start()) {
+        return 2;
+    }
+    return app.exec();
+}
@@ -0,0 +1,61 @@
+#include "connectionwarmer.h"
+
+#include <QNetworkAccessManager>
+#include <QSslConfiguration>
+
+namespace {
+
+const int kKeepAliveInterval = 50 * 1000;      // 空闲多久后重新预连接，小于连接缓存的回收时间
+const qint64 kKeepWarmFor = 10 * 60 * 1000;    // 最后一次使用之后保持连接的时长
+
+} // namespace
+
+ConnectionWarmer::ConnectionWarmer(QNetworkAccessManager *manager, const QUrl &endpoint, QObject *parent)
+    : QObject(parent)
+    , manager(manager)
+    , endpoint(endpoint)
+{
+    keepAliveTimer.setInterval(kKeepAliveInterval);
+    connect(&keepAliveTimer, &QTimer::timeout, this, &ConnectionWarmer::keepAlive);
+    sinceActivity.start();
+}
+
+void ConnectionWarmer::warmUp()
+{
+    preconnect();
+    noteActivity();
+}
+
+void ConnectionWarmer::preconnect()
+{
+    if (endpoint.scheme() != QLatin1String("https")) {
+        manager->connectToHost(endpoint.host(), quint16(endpoint.port(80))); // 本地测试服务
+        return;
+    }
+
+#ifndef QT_NO_SSL
+    // 通过 ALPN 声明支持 HTTP/2，预连接出来的连接才能被 HTTP/2 请求复用
+    QSslConfiguration config = QSslConfiguration::defaultConfiguration();
+    config.setAllowedNextProtocols(QList<QByteArray>()
+                                   << QSslConfiguration::ALPNProtocolHTTP2
+                                   << QSslConfiguration::NextProtocolHttp1_1);
+    manager->connectToHostEncrypted(endpoint.host(), quint16(endpoint.port(443)), config);
+#else
+    manager->connectToHost(endpoint.host(), quint16(endpoint.port(80)));
+#endif
+}
+
+void ConnectionWarmer::noteActivity()
+{
+    sinceActivity.restart();
+    keepAliveTimer.start(); // 重新开始计时，连接正被使用时不需要额外的预连接
+}
+
+void ConnectionWarmer::keepAlive()
+{
+    if (sinceActivity.elapsed() > kKeepWarmFor) {
+        keepAliveTimer.stop(); // 很久没用了，让连接自然关闭
+        return;
+    }
+    preconnect();
+}
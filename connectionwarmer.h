@@ -0,0 +1,42 @@
+#ifndef CONNECTIONWARMER_H
+#define CONNECTIONWARMER_H
+
+#include <QObject>
+#include <QUrl>
+#include <QTimer>
+#include <QElapsedTimer>
+
+class QNetworkAccessManager;
+
+/**
+ * @brief 预先建立到接口服务器的加密连接并保持可用
+ *
+ * 启动和切换模型时调用 warmUp()，让 DNS、TCP 和 TLS 握手在用户发送消息之前完成，
+ * 之后的请求直接复用缓存中的连接（协商到 HTTP/2 时所有请求共用一条连接）。
+ * Qt 的连接缓存会回收空闲连接，服务器也会关闭长时间空闲的连接，所以最近
+ * 有过使用时，空闲期间定时重新预连接一次；长时间不用就停止，不再产生流量。
+ */
+class ConnectionWarmer : public QObject
+{
+    Q_OBJECT
+public:
+    ConnectionWarmer(QNetworkAccessManager *manager, const QUrl &endpoint, QObject *parent = nullptr);
+
+    // 立即预连接（连接已存在时只是确认它还可用）
+    void warmUp();
+    // 发出了真实请求：连接刚被使用过，重新开始空闲计时
+    void noteActivity();
+
+private slots:
+    void keepAlive();
+
+private:
+    void preconnect();
+
+    QNetworkAccessManager *manager;
+    QUrl endpoint;
+    QTimer keepAliveTimer;
+    QElapsedTimer sinceActivity;           // 距离上次使用的时间
+};
+
+#endif // CONNECTIONWARMER_H
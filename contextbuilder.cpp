@@ -0,0 +1,205 @@
+#include "contextbuilder.h"
+
+#include <QJsonDocument>
+#include <QCryptographicHash>
+
+namespace {
+
+const int kMessageOverhead = 4;            // 每条消息的角色和分隔符
+const int kReplyReserve = 2048;            // 留给回复的 token
+const int kCacheKeyMessages = 3;           // 缓存键包含的最近消息条数（上一轮问答 + 新问题）
+const char *const kSummaryPrefix = "以下是与用户之前对话的摘要，供回答时参考：\n";
+
+} // namespace
+
+ContextBuilder::ContextBuilder(const QString &systemPrompt)
+    : summaryTokens(0)
+    , summaryCovered(0)
+{
+    systemMessage["role"] = "system";
+    systemMessage["content"] = systemPrompt;
+    systemTokens = estimateTokens(systemPrompt) + kMessageOverhead;
+    systemFragment = QJsonDocument(systemMessage).toJson(QJsonDocument::Compact);
+}
+
+void ContextBuilder::setMessages(const QList<QJsonObject> &messages)
+{
+    clearSummary();
+    entries.clear();
+    entries.reserve(messages.size());
+    for (const QJsonObject &message : messages) {
+        Entry entry;
+        entry.message = message;
+        entry.tokens = -1; // 切换会话时不估算，只有被装进请求的消息才需要
+        entries.append(entry);
+    }
+}
+
+void ContextBuilder::append(const QJsonObject &message)
+{
+    Entry entry;
+    entry.message = message;
+    entry.tokens = -1;
+    entries.append(entry);
+}
+
+void ContextBuilder::clear()
+{
+    clearSummary();
+    entries.clear();
+}
+
+void ContextBuilder::setSummary(const QString &summary, int coveredMessages)
+{
+    if (summary.isEmpty() || coveredMessages <= 0) {
+        clearSummary();
+        return;
+    }
+    summaryMessage = QJsonObject();
+    summaryMessage["role"] = "system";
+    summaryMessage["content"] = QString::fromUtf8(kSummaryPrefix) + summary;
+    summaryTokens = estimateTokens(summaryMessage["content"].toString()) + kMessageOverhead;
+    summaryFragment = QJsonDocument(summaryMessage).toJson(QJsonDocument::Compact);
+    summaryCovered = qMin(coveredMessages, entries.size());
+}
+
+void ContextBuilder::clearSummary()
+{
+    summaryMessage = QJsonObject();
+    summaryTokens = 0;
+    summaryFragment.clear();
+    summaryCovered = 0;
+}
+
+int ContextBuilder::tokensOf(const Entry &entry) const
+{
+    if (entry.tokens < 0) {
+        entry.tokens = estimateTokens(entry.message.value("content").toString()) + kMessageOverhead;
+    }
+    return entry.tokens;
+}
+
+const QByteArray &ContextBuilder::fragmentOf(const Entry &entry) const
+{
+    if (entry.fragment.isEmpty()) {
+        entry.fragment = QJsonDocument(entry.message).toJson(QJsonDocument::Compact);
+    }
+    return entry.fragment;
+}
+
+int ContextBuilder::windowStart(int tokenBudget) const
+{
+    // 从最新的消息往前数，找到能装下的最早一条；摘要覆盖的消息不再逐条发送
+    int used = systemTokens + summaryTokens;
+    int first = entries.size();
+    const int floor = qMin(summaryCovered, entries.size() - 1);
+    while (first > qMax(0, floor)) {
+        int tokens = tokensOf(entries.at(first - 1));
+        if (first < entries.size() && used + tokens > tokenBudget) {
+            break;
+        }
+        used += tokens;
+        --first;
+    }
+
+    // 历史部分从用户消息开始，不以孤立的回复开头
+    while (first < entries.size() - 1
+           && entries.at(first).message.value("role").toString() != QLatin1String("user")) {
+        ++first;
+    }
+    return first;
+}
+
+QJsonArray ContextBuilder::build(int tokenBudget) const
+{
+    int first = windowStart(tokenBudget);
+
+    QJsonArray messagesArray;
+    messagesArray.append(systemMessage);
+    if (summaryCovered > 0) {
+        messagesArray.append(summaryMessage);
+    }
+    for (int i = first; i < entries.size(); ++i) {
+        messagesArray.append(entries.at(i).message);
+    }
+    return messagesArray;
+}
+
+QByteArray ContextBuilder::encodeRequest(const QString &model, int tokenBudget) const
+{
+    int first = windowStart(tokenBudget);
+
+    // 模型名借用 QJsonDocument 转义：["name"] 去掉两边的括号
+    QByteArray modelJson = QJsonDocument(QJsonArray() << model).toJson(QJsonDocument::Compact);
+    modelJson = modelJson.mid(1, modelJson.size() - 2);
+
+    int size = 64 + modelJson.size() + systemFragment.size() + summaryFragment.size() + 1;
+    for (int i = first; i < entries.size(); ++i) {
+        size += fragmentOf(entries.at(i)).size() + 1;
+    }
+
+    QByteArray body;
+    body.reserve(size);
+    body.append("{\"model\":").append(modelJson);
+    body.append(",\"stream\":true,\"messages\":[");
+    body.append(systemFragment);
+    if (summaryCovered > 0) {
+        body.append(',').append(summaryFragment);
+    }
+    for (int i = first; i < entries.size(); ++i) {
+        body.append(',').append(entries.at(i).fragment);
+    }
+    body.append("]}");
+    return body;
+}
+
+QByteArray ContextBuilder::cacheKey(const QString &model) const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(model.toUtf8());
+    hash.addData("\0", 1);
+    hash.addData(systemFragment);
+    hash.addData(summaryFragment);
+
+    for (int i = qMax(0, entries.size() - kCacheKeyMessages); i < entries.size(); ++i) {
+        const QJsonObject &message = entries.at(i).message;
+        // 首尾空白和连续空白不影响问题的意思
+        QString content = message.value("content").toString().simplified();
+        hash.addData("\0", 1);
+        hash.addData(message.value("role").toString().toUtf8());
+        hash.addData("\0", 1);
+        hash.addData(content.toUtf8());
+    }
+    return hash.result().toHex();
+}
+
+int ContextBuilder::estimateTokens(const QString &text)
+{
+    int tokens = 0;
+    int wordLength = 0; // 当前英文单词或数字串的长度
+    for (QChar ch : text) {
+        ushort u = ch.unicode();
+        if (u < 0x80 && (ch.isLetterOrNumber() || u == '_')) {
+            ++wordLength;
+            continue;
+        }
+        if (wordLength > 0) {
+            tokens += (wordLength + 3) / 4;
+            wordLength = 0;
+        }
+        if (u >= 0x80) {
+            ++tokens;  // 汉字、全角标点等
+        } else if (!ch.isSpace()) {
+            ++tokens;  // 半角标点
+        }
+    }
+    if (wordLength > 0) {
+        tokens += (wordLength + 3) / 4;
+    }
+    return tokens;
+}
+
+int ContextBuilder::budgetFor(int contextLength)
+{
+    return qMax(0, contextLength - kReplyReserve);
+}
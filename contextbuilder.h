@@ -0,0 +1,72 @@
+#ifndef CONTEXTBUILDER_H
+#define CONTEXTBUILDER_H
+
+#include <QString>
+#include <QList>
+#include <QJsonObject>
+#include <QJsonArray>
+
+/**
+ * @brief 按 token 预算组装发给模型的上下文
+ *
+ * 保存当前会话的全部消息，每条消息的 token 估算值在第一次用到时算好并缓存。
+ * 组装请求时从最新的消息往前取，直到装满模型的输入预算，所以耗时只和
+ * 实际发送的消息有关，而不是和会话总长度有关。系统提示词的 JSON 和 token
+ * 数也只在构造时计算一次。
+ *
+ * 请求体直接由每条消息缓存的紧凑 UTF-8 JSON 片段拼接而成，已经发送过的
+ * 消息不会再被重新编码。
+ *
+ * 设置了摘要时，摘要覆盖的较早消息不再逐条发送，而是以一条系统消息的形式
+ * 紧跟在系统提示词之后（摘要由 ConversationSummarizer 在后台生成）。
+ */
+class ContextBuilder
+{
+public:
+    explicit ContextBuilder(const QString &systemPrompt);
+
+    void setMessages(const QList<QJsonObject> &messages);
+    void append(const QJsonObject &message);
+    void clear();
+    int size() const { return entries.size(); }
+    const QJsonObject &message(int index) const { return entries.at(index).message; }
+
+    // 用摘要代替前 coveredMessages 条消息；setMessages() 和 clear() 会清除摘要
+    void setSummary(const QString &summary, int coveredMessages);
+    void clearSummary();
+    int summaryCovers() const { return summaryCovered; }
+
+    // 系统提示词 + 不超过 tokenBudget 的最新消息；最新一条消息总是包含在内
+    QJsonArray build(int tokenBudget) const;
+    // 与 build() 选取相同的消息，直接拼出 chat/completions 的请求体
+    QByteArray encodeRequest(const QString &model, int tokenBudget) const;
+    // 回复缓存的键：模型、系统提示词和最近几条消息（忽略空白差异）的哈希
+    QByteArray cacheKey(const QString &model) const;
+
+    // 近似的 token 数：汉字等每字约一个，英文单词和数字约四个字符一个
+    static int estimateTokens(const QString &text);
+    // 上下文长度为 contextLength 的模型可用于输入的 token 预算（减去留给回复的部分）
+    static int budgetFor(int contextLength);
+
+private:
+    struct Entry {
+        QJsonObject message;
+        mutable int tokens;                // -1 表示还没有估算
+        mutable QByteArray fragment;       // 紧凑 JSON，空表示还没有编码
+    };
+
+    int tokensOf(const Entry &entry) const;
+    const QByteArray &fragmentOf(const Entry &entry) const;
+    int windowStart(int tokenBudget) const;
+
+    QJsonObject systemMessage;
+    int systemTokens;
+    QByteArray systemFragment;
+    QJsonObject summaryMessage;
+    int summaryTokens;
+    QByteArray summaryFragment;
+    int summaryCovered;                    // 摘要覆盖的消息条数，0 表示没有摘要
+    QList<Entry> entries;
+};
+
+#endif // CONTEXTBUILDER_H
@@ -0,0 +1,137 @@
+#include "conversationlistmodel.h"
+
+#include <algorithm>
+
+ConversationListModel::ConversationListModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int ConversationListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : items.size();
+}
+
+QVariant ConversationListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= items.size()) {
+        return QVariant();
+    }
+
+    const Item &item = items.at(rowAt(index.row()));
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::ToolTipRole:
+        return item.title;
+    case IdRole:
+        return item.id;
+    default:
+        return QVariant();
+    }
+}
+
+void ConversationListModel::setConversations(const QList<ConversationStore::ConversationInfo> &stored)
+{
+    // 存储层的顺序是新的在前；倒过来再按最后活动排序，活动时间相同的会话
+    // （旧版数据没有记录）保持原来的先后
+    QVector<ConversationStore::ConversationInfo> sorted;
+    sorted.reserve(stored.size());
+    for (int i = stored.size() - 1; i >= 0; --i) {
+        sorted.append(stored[i]);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const ConversationStore::ConversationInfo &a, const ConversationStore::ConversationInfo &b) {
+        return a.lastActivity < b.lastActivity;
+    });
+
+    beginResetModel();
+    items.clear();
+    positions.clear();
+    items.reserve(sorted.size());
+    positions.reserve(sorted.size());
+    for (const ConversationStore::ConversationInfo &info : sorted) {
+        Item item;
+        item.id = info.id;
+        item.title = info.title;
+        positions.insert(item.id, items.size());
+        items.append(item);
+    }
+    endResetModel();
+}
+
+void ConversationListModel::addConversation(qint64 id, const QString &title)
+{
+    if (positions.contains(id)) {
+        return;
+    }
+    Item item;
+    item.id = id;
+    item.title = title;
+
+    beginInsertRows(QModelIndex(), 0, 0);
+    positions.insert(id, items.size());
+    items.append(item);
+    endInsertRows();
+}
+
+void ConversationListModel::removeConversation(qint64 id)
+{
+    int pos = positions.value(id, -1);
+    if (pos < 0) {
+        return;
+    }
+    int row = rowAt(pos);
+    beginRemoveRows(QModelIndex(), row, row);
+    items.remove(pos);
+    positions.remove(id);
+    reindexFrom(pos);
+    endRemoveRows();
+}
+
+void ConversationListModel::setTitle(qint64 id, const QString &title)
+{
+    int pos = positions.value(id, -1);
+    if (pos < 0 || items[pos].title == title) {
+        return;
+    }
+    items[pos].title = title;
+    QModelIndex changed = index(rowAt(pos));
+    emit dataChanged(changed, changed, QVector<int>() << Qt::DisplayRole << Qt::ToolTipRole);
+}
+
+void ConversationListModel::touch(qint64 id)
+{
+    int pos = positions.value(id, -1);
+    // 已经在最上面时什么都不用做
+    if (pos < 0 || pos == items.size() - 1) {
+        return;
+    }
+
+    // 移到第 0 行；视图和选择模型跟着移动，当前选中的会话不变
+    int row = rowAt(pos);
+    beginMoveRows(QModelIndex(), row, row, QModelIndex(), 0);
+    std::rotate(items.begin() + pos, items.begin() + pos + 1, items.end());
+    reindexFrom(pos);
+    endMoveRows();
+}
+
+qint64 ConversationListModel::id(int row) const
+{
+    if (row < 0 || row >= items.size()) {
+        return -1;
+    }
+    return items.at(rowAt(row)).id;
+}
+
+int ConversationListModel::row(qint64 id) const
+{
+    int pos = positions.value(id, -1);
+    return pos < 0 ? -1 : rowAt(pos);
+}
+
+void ConversationListModel::reindexFrom(int from)
+{
+    for (int i = from; i < items.size(); ++i) {
+        positions[items.at(i).id] = i;
+    }
+}
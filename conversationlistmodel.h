@@ -0,0 +1,61 @@
+#ifndef CONVERSATIONLISTMODEL_H
+#define CONVERSATIONLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+#include <QHash>
+#include "conversationstore.h"
+
+/**
+ * @brief 会话列表模型，按最后活动时间排序（最近的在最上面）
+ *
+ * 以稳定的会话编号为准，新建、删除、改标题和有新消息时只发出对应的
+ * 插入、删除、修改或移动信号，不再整体重建列表，当前选中的会话也不会因此
+ * 被重新选中。
+ *
+ * 内部按从旧到新存放，第 0 行对应数组末尾：新建会话是在末尾追加。另有
+ * 会话编号到下标的哈希表，按编号找行不需要查找。把第 r 行移到最上面或
+ * 删除第 r 行时，只有它上面的 r 个会话下标改变，只更新这一段；有新消息的
+ * 通常就是最上面几个会话，五万个会话时也只动几项。
+ */
+class ConversationListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Roles {
+        IdRole = Qt::UserRole + 1          // 会话编号
+    };
+
+    explicit ConversationListModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    // 整体替换（存储层加载完成时），stored 为存储层的显示顺序，按最后活动时间重新排序
+    void setConversations(const QList<ConversationStore::ConversationInfo> &stored);
+    // 新会话放在最上面
+    void addConversation(qint64 id, const QString &title);
+    void removeConversation(qint64 id);
+    void setTitle(qint64 id, const QString &title);
+    // 会话有了新消息：移到最上面
+    void touch(qint64 id);
+
+    // 行号与会话编号互相转换，不存在时为 -1
+    qint64 id(int row) const;
+    int row(qint64 id) const;
+
+private:
+    struct Item {
+        qint64 id;
+        QString title;
+    };
+
+    int rowAt(int position) const { return items.size() - 1 - position; }
+    // 重新记录 items[from] 之后所有会话的下标
+    void reindexFrom(int from);
+
+    QVector<Item> items;                   // 从旧到新
+    QHash<qint64, int> positions;          // 会话编号 -> 在 items 中的下标
+};
+
+#endif // CONVERSATIONLISTMODEL_H
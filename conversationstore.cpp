@@ -0,0 +1,349 @@
+#include "conversationstore.h"
+#include "persistenceworker.h"
+
+#include <QJsonDocument>
+#include <QDebug>
+
+namespace {
+
+// 日志超过这些阈值时触发压缩
+const int kCompactRecordThreshold = 500;
+const qint64 kCompactSizeThreshold = 4 * 1024 * 1024;
+
+// 日志里有未合并的记录时，每隔这么久做一次检查点
+const int kCheckpointIntervalMs = 5 * 60 * 1000;
+
+// 同时常驻内存的会话正文数量
+const int kResidentConversations = 16;
+
+} // namespace
+
+void ConversationStore::Snapshot::apply(const QJsonObject &record)
+{
+    const QString op = record["op"].toString();
+    const qint64 id = qint64(record["id"].toDouble());
+
+    if (op == "create") {
+        Entry entry;
+        entry.title = record["title"].toString();
+        entry.lastActivity = qint64(record["seq"].toDouble());
+        state.insert(id, entry);
+        order.prepend(id);
+        nextId = qMax(nextId, id + 1);
+    } else if (op == "title") {
+        if (state.contains(id)) {
+            state[id].title = record["title"].toString();
+        }
+    } else if (op == "append") {
+        if (state.contains(id)) {
+            state[id].pending.append(record["message"].toObject());
+            state[id].lastActivity = qint64(record["seq"].toDouble());
+        }
+    } else if (op == "remove") {
+        state.remove(id);
+        order.removeOne(id);
+    }
+}
+
+ConversationStore::ConversationStore(const QString &baseName, QObject *parent)
+    : QObject(parent)
+    , loadFinished(false)
+    , compacting(false)
+    , worker(new PersistenceWorker(baseName))
+{
+    qRegisterMetaType<ConversationStore::Snapshot>("ConversationStore::Snapshot");
+    qRegisterMetaType<ConversationStore::CompactionResult>("ConversationStore::CompactionResult");
+    qRegisterMetaType<QList<QJsonObject> >("QList<QJsonObject>");
+
+    messageCache.setMaxCost(kResidentConversations);
+
+    checkpointTimer.setInterval(kCheckpointIntervalMs);
+    connect(&checkpointTimer, &QTimer::timeout, this, &ConversationStore::checkpoint);
+
+    worker->moveToThread(&ioThread);
+    connect(worker, &PersistenceWorker::loaded, this, &ConversationStore::onLoaded);
+    connect(worker, &PersistenceWorker::messagesRead, this, &ConversationStore::onMessagesRead);
+    connect(worker, &PersistenceWorker::compactionFinished, this, &ConversationStore::onCompactionFinished);
+    connect(worker, &PersistenceWorker::journalWritten, this, &ConversationStore::saved);
+    ioThread.setObjectName("ConversationStore I/O");
+    ioThread.start();
+}
+
+ConversationStore::~ConversationStore()
+{
+    // 等 I/O 线程处理完队列中剩下的写入（包括进行中的压缩）再退出
+    QMetaObject::invokeMethod(worker, "drain", Qt::BlockingQueuedConnection);
+    ioThread.quit();
+    ioThread.wait();
+    delete worker;
+}
+
+void ConversationStore::load()
+{
+    PersistenceWorker::Task task;
+    task.type = PersistenceWorker::Task::Load;
+    worker->post(task);
+}
+
+void ConversationStore::onLoaded(const Snapshot &snapshot)
+{
+    data = snapshot;
+    messageCache.clear();
+    loadingMessages.clear();
+    loadFinished = true;
+    checkpointTimer.start();
+
+    if (data.migrate) {
+        data.migrate = false;
+        startCompaction();
+    } else {
+        maybeCompact();
+    }
+
+    QList<ConversationInfo> result;
+    for (qint64 id : data.order) {
+        const Entry &entry = data.state[id];
+        ConversationInfo info;
+        info.id = id;
+        info.title = entry.title;
+        info.messageCount = entry.storedCount + entry.pending.size();
+        info.lastActivity = entry.lastActivity;
+        result.append(info);
+    }
+    emit loaded(result);
+}
+
+void ConversationStore::requestMessages(qint64 id)
+{
+    if (QList<QJsonObject> *cached = messageCache.object(id)) {
+        emit messagesLoaded(id, *cached);
+        return;
+    }
+
+    QHash<qint64, Entry>::const_iterator it = data.state.constFind(id);
+    if (it == data.state.constEnd()) {
+        emit messagesLoaded(id, QList<QJsonObject>());
+        return;
+    }
+
+    // 还没有写进数据文件的会话不需要读盘
+    if (it->length == 0) {
+        messageCache.insert(id, new QList<QJsonObject>(it->pending));
+        emit messagesLoaded(id, it->pending);
+        return;
+    }
+
+    if (!loadingMessages.contains(id)) {
+        loadingMessages.insert(id);
+        readMessages(id);
+    }
+}
+
+void ConversationStore::readMessages(qint64 id)
+{
+    const Entry &entry = data.state[id];
+    PersistenceWorker::Task task;
+    task.type = PersistenceWorker::Task::ReadMessages;
+    task.id = id;
+    task.offset = entry.offset;
+    task.length = entry.length;
+    task.generation = data.generation;
+    task.jsonData = data.jsonData;
+    worker->post(task);
+}
+
+void ConversationStore::onMessagesRead(qint64 id, int generation, const QList<QJsonObject> &stored, bool ok)
+{
+    if (!loadingMessages.contains(id)) {
+        return; // 会话已被删除
+    }
+    QHash<qint64, Entry>::const_iterator it = data.state.constFind(id);
+    if (it == data.state.constEnd()) {
+        loadingMessages.remove(id);
+        return;
+    }
+
+    // 读取期间完成了压缩，数据已经搬到新一代文件里，重新读
+    if (generation != data.generation) {
+        readMessages(id);
+        return;
+    }
+
+    loadingMessages.remove(id);
+    if (!ok) {
+        // 只有未写入数据文件的消息时，续写的对话和消息序号都会错位
+        qWarning() << "Failed to read messages of conversation" << id;
+        emit messagesFailed(id);
+        return;
+    }
+    QList<QJsonObject> msgs = stored;
+    msgs += it->pending;
+
+    messageCache.insert(id, new QList<QJsonObject>(msgs));
+    emit messagesLoaded(id, msgs);
+}
+
+QString ConversationStore::title(qint64 id) const
+{
+    return data.state.value(id).title;
+}
+
+int ConversationStore::messageCount(qint64 id) const
+{
+    QHash<qint64, Entry>::const_iterator it = data.state.constFind(id);
+    return it == data.state.constEnd() ? 0 : it->storedCount + it->pending.size();
+}
+
+qint64 ConversationStore::createConversation(const QString &title)
+{
+    qint64 id = data.nextId;
+
+    QJsonObject record;
+    record["op"] = "create";
+    record["id"] = id;
+    record["title"] = title;
+    appendRecord(record);
+
+    return id;
+}
+
+void ConversationStore::setTitle(qint64 id, const QString &title)
+{
+    QJsonObject record;
+    record["op"] = "title";
+    record["id"] = id;
+    record["title"] = title;
+    appendRecord(record);
+}
+
+void ConversationStore::appendMessage(qint64 id, const QJsonObject &message)
+{
+    // 会话不存在时记录不会生效，也就没有序号
+    if (!data.state.contains(id)) {
+        qWarning() << "Message appended to unknown conversation" << id;
+        return;
+    }
+    const int index = messageCount(id);
+
+    QJsonObject record;
+    record["op"] = "append";
+    record["id"] = id;
+    record["message"] = message;
+    appendRecord(record);
+    emit messageAppended(id, index, message);
+}
+
+void ConversationStore::removeConversation(qint64 id)
+{
+    QJsonObject record;
+    record["op"] = "remove";
+    record["id"] = id;
+    appendRecord(record);
+    emit conversationRemoved(id);
+}
+
+// 每条记录占一行：4 位十六进制校验和 + 空格 + 紧凑 JSON
+void ConversationStore::appendRecord(QJsonObject record)
+{
+    if (!loadFinished) {
+        qWarning() << "Conversation store modified before it was loaded.";
+        return;
+    }
+
+    record["seq"] = ++data.seq;
+    applyRecord(record);
+
+    QByteArray json = QJsonDocument(record).toJson(QJsonDocument::Compact);
+    quint16 checksum = qChecksum(json.constData(), uint(json.size()));
+    QByteArray line = QByteArray::number(checksum, 16).rightJustified(4, '0');
+    line += ' ';
+    line += json;
+    line += '\n';
+
+    // 写入交给 I/O 线程，同一阵子的多条记录会合并成一次写入
+    PersistenceWorker::Task task;
+    task.type = PersistenceWorker::Task::Append;
+    task.line = line;
+    task.seq = data.seq;
+    worker->post(task);
+
+    ++data.journalRecords;
+    data.journalBytes += line.size();
+    maybeCompact();
+}
+
+void ConversationStore::applyRecord(const QJsonObject &record)
+{
+    data.apply(record);
+
+    const QString op = record["op"].toString();
+    const qint64 id = qint64(record["id"].toDouble());
+    if (op == "append") {
+        if (QList<QJsonObject> *cached = messageCache.object(id)) {
+            cached->append(record["message"].toObject());
+        }
+    } else if (op == "remove") {
+        messageCache.remove(id);
+        loadingMessages.remove(id);
+    }
+}
+
+void ConversationStore::maybeCompact()
+{
+    if (compacting) {
+        return;
+    }
+    if (data.journalRecords >= kCompactRecordThreshold || data.journalBytes >= kCompactSizeThreshold) {
+        startCompaction();
+    }
+}
+
+// 程序崩溃时最多丢失的是还没写完的日志；定期检查点让重放的日志保持很短
+void ConversationStore::checkpoint()
+{
+    if (compacting || data.journalRecords == 0) {
+        return;
+    }
+    startCompaction();
+}
+
+void ConversationStore::startCompaction()
+{
+    data.journalRecords = 0;
+    data.journalBytes = 0;
+    compacting = true;
+
+    // order/state 是隐式共享的，这里的拷贝只增加引用计数；
+    // 日志轮换和新数据文件的生成都在 I/O 线程中，排在之前的追加之后
+    PersistenceWorker::Task task;
+    task.type = PersistenceWorker::Task::Compact;
+    task.job.order = data.order;
+    task.job.state = data.state;
+    task.job.seq = data.seq;
+    task.job.nextId = data.nextId;
+    task.job.generation = data.generation + 1;
+    task.job.oldJsonData = data.jsonData;
+    worker->post(task);
+}
+
+void ConversationStore::onCompactionFinished(const CompactionResult &result)
+{
+    compacting = false;
+    if (!result.ok) {
+        return;
+    }
+
+    // 切换到新一代数据文件；压缩期间新追加的消息仍留在 pending 中
+    for (QHash<qint64, Entry>::const_iterator it = result.entries.constBegin(); it != result.entries.constEnd(); ++it) {
+        QHash<qint64, Entry>::iterator current = data.state.find(it.key());
+        if (current == data.state.end()) {
+            continue;
+        }
+        current->offset = it->offset;
+        current->length = it->length;
+        current->storedCount = it->storedCount;
+        current->pending = current->pending.mid(it->pending.size());
+    }
+    data.generation = result.generation;
+    data.jsonData = false;
+}
@@ -0,0 +1,143 @@
+#ifndef CONVERSATIONSTORE_H
+#define CONVERSATIONSTORE_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QCache>
+#include <QThread>
+#include <QTimer>
+#include <QJsonObject>
+
+class PersistenceWorker;
+
+/**
+ * @brief 会话存储引擎：索引 + 消息数据文件 + 追加写日志
+ *
+ * 磁盘上分三部分：
+ *  - conversations.idx      索引（CBOR）：标题、消息在数据文件中的偏移/长度、消息条数
+ *  - conversations.<N>.dat  第 N 代数据文件，每个会话的消息连续存放为一串 CBOR 消息
+ *  - conversations.journal  追加写日志，记录上次压缩之后的所有修改
+ *
+ * 旧版的 conversations.json 只在没有索引和日志时导入，第一次检查点写成后
+ * 改名为 conversations.json.migrated。
+ *
+ * 压缩（检查点）用 QSaveFile 原子地替换索引，并保留上一代的索引、数据文件和
+ * 日志，最新的索引损坏时自动退回上一代再重放日志。
+ *
+ * 启动时只读索引和日志，会话列表可以马上显示；消息正文在打开会话时才从
+ * 数据文件读取，并用 LRU 缓存限制常驻内存的会话数量。日志变大后生成新一代
+ * 数据文件和索引。
+ *
+ * 所有文件读写都在独立的 I/O 线程（PersistenceWorker）中进行，主线程只维护
+ * 内存中的状态并通过无锁队列投递任务，结果以信号的形式返回。
+ */
+class ConversationStore : public QObject
+{
+    Q_OBJECT
+public:
+    // 会话列表需要的元数据，不含消息正文
+    struct ConversationInfo {
+        qint64 id;                         // 稳定的会话编号
+        QString title;                     // 会话标题
+        int messageCount;                  // 消息条数
+        qint64 lastActivity;               // 最后一次新建或追加消息的记录序号，越大越新
+    };
+
+    // 一个会话在数据文件中的位置
+    struct Entry {
+        Entry() : offset(0), length(0), storedCount(0), lastActivity(0) {}
+        QString title;
+        qint64 offset;                     // 消息数组在数据文件中的偏移
+        qint64 length;                     // 消息数组的字节数，0 表示没有
+        int storedCount;                   // 数据文件中的消息条数
+        qint64 lastActivity;               // 最后一次新建或追加消息的记录序号
+        QList<QJsonObject> pending;        // 只存在于日志中的新消息
+    };
+
+    // 内存中的全部元数据，I/O 线程读取磁盘后整体交给主线程
+    struct Snapshot {
+        Snapshot() : generation(0), nextId(1), seq(0), snapshotSeq(0), journalRecords(0), journalBytes(0), jsonData(false), migrate(false) {}
+        QList<qint64> order;               // 会话显示顺序（新会话在前）
+        QHash<qint64, Entry> state;        // 每个会话的元数据和未压缩消息
+        int generation;                    // 当前数据文件代号
+        qint64 nextId;
+        qint64 seq;                        // 最后一条记录的序号
+        qint64 snapshotSeq;                // 索引已包含的序号
+        int journalRecords;                // 当前日志中的记录数
+        qint64 journalBytes;               // 当前日志的字节数
+        bool jsonData;                     // 数据文件是旧版的 JSON 格式
+        bool migrate;                      // 需要立即压缩（导入旧版文件或从上一代恢复）
+
+        // 应用一条日志记录
+        void apply(const QJsonObject &record);
+    };
+
+    // 一次压缩的结果
+    struct CompactionResult {
+        CompactionResult() : ok(false), generation(0) {}
+        bool ok;
+        int generation;                    // 新数据文件的代号
+        QHash<qint64, Entry> entries;      // 新的位置，pending 为已写入的消息
+    };
+
+    explicit ConversationStore(const QString &baseName, QObject *parent = nullptr);
+    ~ConversationStore();
+
+    // 在 I/O 线程读取索引并重放日志，完成后发出 loaded()
+    void load();
+    bool isLoaded() const { return loadFinished; }
+
+    // 读取会话的全部消息，结果通过 messagesLoaded() 返回；
+    // 已在缓存中的会话会立即（同步）发出信号
+    void requestMessages(qint64 id);
+    QString title(qint64 id) const;
+    int messageCount(qint64 id) const;
+
+    // 以下操作各追加一条日志记录，只能在 loaded() 之后调用
+    qint64 createConversation(const QString &title);
+    void setTitle(qint64 id, const QString &title);
+    void appendMessage(qint64 id, const QJsonObject &message);
+    void removeConversation(qint64 id);
+
+signals:
+    // 按显示顺序排列的会话（不含消息正文）
+    void loaded(const QList<ConversationStore::ConversationInfo> &conversations);
+    void messagesLoaded(qint64 id, const QList<QJsonObject> &messages);
+    // 数据文件中的消息读不出来，这个会话的消息不完整，不会被缓存，下次请求时重新读取
+    void messagesFailed(qint64 id);
+    // 序号不大于 seq 的修改都已写入磁盘
+    void saved(qint64 seq);
+    // 追加了一条消息，index 为它在会话中的序号
+    void messageAppended(qint64 id, int index, const QJsonObject &message);
+    void conversationRemoved(qint64 id);
+
+private slots:
+    void onLoaded(const ConversationStore::Snapshot &snapshot);
+    void onMessagesRead(qint64 id, int generation, const QList<QJsonObject> &stored, bool ok);
+    void onCompactionFinished(const ConversationStore::CompactionResult &result);
+
+private:
+    void appendRecord(QJsonObject record);
+    void applyRecord(const QJsonObject &record);
+    void readMessages(qint64 id);
+    void maybeCompact();
+    void startCompaction();
+    void checkpoint();
+
+    Snapshot data;
+    QCache<qint64, QList<QJsonObject> > messageCache; // 已加载的消息正文（LRU）
+    QSet<qint64> loadingMessages;          // 正在 I/O 线程读取的会话
+    bool loadFinished;
+    bool compacting;
+    QTimer checkpointTimer;                // 定期把日志合并进新一代数据文件
+
+    QThread ioThread;
+    PersistenceWorker *worker;
+};
+
+Q_DECLARE_METATYPE(ConversationStore::Snapshot)
+Q_DECLARE_METATYPE(ConversationStore::CompactionResult)
+
+#endif // CONVERSATIONSTORE_H
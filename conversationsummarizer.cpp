@@ -0,0 +1,106 @@
+#include "conversationsummarizer.h"
+#include "chatengine.h"
+#include "chatstream.h"
+#include "contextbuilder.h"
+#include "requestscheduler.h"
+
+#include <QDebug>
+
+namespace {
+
+const int kVerbatimMessages = 6;               // 最近几条消息总是原文发送
+const int kMinNewMessages = 4;                 // 新增的较早消息达到这个数量才更新摘要
+const int kMaxQuotedLength = 600;              // 摘要请求中每条消息最多引用的字数
+
+const char *const kSummaryPrompt = "你是对话摘要助手。请把对话要点整理成简洁的中文摘要，保留用户提出的问题、"
+                                   "涉及的关键事实、数字、名称和已经给出的结论，不超过300字。只输出摘要本身。";
+
+} // namespace
+
+ConversationSummarizer::ConversationSummarizer(ChatEngine *engine, RequestScheduler *scheduler, QObject *parent)
+    : QObject(parent)
+    , engine(engine)
+    , scheduler(scheduler)
+{
+}
+
+void ConversationSummarizer::update(qint64 conversationId, const ContextBuilder &context)
+{
+    // 摘要模型来自模型配置，默认是便宜的 GSLite
+    const int handle = engine->models().summaryModel();
+    const ModelRegistry::Model &model = engine->models().model(handle);
+    if (running.contains(conversationId) || model.apiKey.isEmpty()) {
+        return;
+    }
+
+    const Summary previous = summaries.value(conversationId);
+    int target = context.size() - kVerbatimMessages;
+    // 摘要止于一轮问答的结尾，原文部分从用户消息开始
+    while (target > previous.covered && context.message(target).value("role").toString() != QLatin1String("user")) {
+        --target;
+    }
+    if (target - previous.covered < kMinNewMessages) {
+        return;
+    }
+
+    // 只发送上一次摘要和新增的对话，不重新发送已经摘要过的内容
+    QString request;
+    if (!previous.text.isEmpty()) {
+        request += QString::fromUtf8("已有摘要：\n") + previous.text + QString::fromUtf8("\n\n");
+    }
+    request += QString::fromUtf8("新增对话：\n");
+    for (int i = previous.covered; i < target; ++i) {
+        const QJsonObject &message = context.message(i);
+        const bool isUser = message.value("role").toString() == QLatin1String("user");
+        QString content = message.value("content").toString();
+        if (content.size() > kMaxQuotedLength) {
+            content = content.left(kMaxQuotedLength) + QString::fromUtf8("……");
+        }
+        request += (isUser ? QString::fromUtf8("用户：") : QString::fromUtf8("助手：")) + content + QLatin1Char('\n');
+    }
+    request += QString::fromUtf8("\n请输出合并后的完整摘要。");
+
+    ContextBuilder prompt(QString::fromUtf8(kSummaryPrompt));
+    QJsonObject userMessage;
+    userMessage["role"] = "user";
+    userMessage["content"] = request;
+    prompt.append(userMessage);
+
+    ChatStream *stream = scheduler->submit(conversationId, handle,
+                                           prompt.encodeRequest(model.id, engine->models().budget(handle)),
+                                           RequestScheduler::Background, this);
+    running.insert(conversationId, stream);
+    connect(stream, &ChatStream::finished, this, [this, stream, conversationId, target]() {
+        handleFinished(stream, conversationId, target);
+    });
+}
+
+void ConversationSummarizer::handleFinished(ChatStream *stream, qint64 conversationId, int covered)
+{
+    stream->deleteLater();
+    if (running.value(conversationId) != stream) {
+        return; // 会话已被删除
+    }
+    running.remove(conversationId);
+
+    const QString text = stream->text().trimmed();
+    if (!stream->metrics().ok || text.isEmpty()) {
+        qDebug() << "Conversation summary failed:" << stream->metrics().error;
+        return;
+    }
+
+    Summary summary;
+    summary.text = text;
+    summary.covered = covered;
+    summaries.insert(conversationId, summary);
+    qDebug() << "Summarized" << covered << "messages of conversation" << conversationId << "into" << text.size() << "characters";
+    emit summaryUpdated(conversationId);
+}
+
+void ConversationSummarizer::remove(qint64 conversationId)
+{
+    summaries.remove(conversationId);
+    if (ChatStream *stream = running.take(conversationId)) {
+        stream->abort();
+    }
+}
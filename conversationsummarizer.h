@@ -0,0 +1,50 @@
+#ifndef CONVERSATIONSUMMARIZER_H
+#define CONVERSATIONSUMMARIZER_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+
+class ChatEngine;
+class ChatStream;
+class ContextBuilder;
+class RequestScheduler;
+
+/**
+ * @brief 用便宜的模型（模型配置中的 summaryModel，默认 GSLite）为较早的对话生成滚动摘要
+ *
+ * 每个会话只保留最近几条消息原文，更早的消息积累到一定数量后，连同上一次的
+ * 摘要一起交给摘要模型，得到更新后的摘要。每次只发送新增的那部分对话，摘要
+ * 按会话缓存，ContextBuilder 用它代替被覆盖的消息，减少每轮上传的字节数和
+ * 服务器的预填充时间。摘要请求以后台优先级排队，不影响用户的请求。
+ */
+class ConversationSummarizer : public QObject
+{
+    Q_OBJECT
+public:
+    struct Summary {
+        Summary() : covered(0) {}
+        QString text;
+        int covered;                       // 摘要覆盖的消息条数
+    };
+
+    ConversationSummarizer(ChatEngine *engine, RequestScheduler *scheduler, QObject *parent = nullptr);
+
+    // 会话有新消息后调用：摘要之外的较早消息足够多时在后台更新摘要
+    void update(qint64 conversationId, const ContextBuilder &context);
+    Summary summary(qint64 conversationId) const { return summaries.value(conversationId); }
+    void remove(qint64 conversationId);
+
+signals:
+    void summaryUpdated(qint64 conversationId);
+
+private:
+    void handleFinished(ChatStream *stream, qint64 conversationId, int covered);
+
+    ChatEngine *engine;
+    RequestScheduler *scheduler;
+    QHash<qint64, Summary> summaries;
+    QHash<qint64, ChatStream *> running;   // 每个会话同时只有一个摘要请求
+};
+
+#endif // CONVERSATIONSUMMARIZER_H
@@ -0,0 +1,34 @@
+# 不依赖界面的聊天核心：图形界面程序和命令行批处理工具（cli/）共用
+
+QT += network
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += \
+    $$PWD/chatengine.cpp \
+    $$PWD/chatstream.cpp \
+    $$PWD/connectionwarmer.cpp \
+    $$PWD/contextbuilder.cpp \
+    $$PWD/conversationsummarizer.cpp \
+    $$PWD/deltaextractor.cpp \
+    $$PWD/gzip.cpp \
+    $$PWD/modelregistry.cpp \
+    $$PWD/requestmetrics.cpp \
+    $$PWD/requestscheduler.cpp \
+    $$PWD/responsecache.cpp \
+    $$PWD/sseparser.cpp
+
+HEADERS += \
+    $$PWD/chatengine.h \
+    $$PWD/chatstream.h \
+    $$PWD/connectionwarmer.h \
+    $$PWD/contextbuilder.h \
+    $$PWD/conversationsummarizer.h \
+    $$PWD/deltaextractor.h \
+    $$PWD/gzip.h \
+    $$PWD/modelregistry.h \
+    $$PWD/requestmetrics.h \
+    $$PWD/requestscheduler.h \
+    $$PWD/responsecache.h \
+    $$PWD/sseparser.h
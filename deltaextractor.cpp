@@ -0,0 +1,529 @@
+#include "deltaextractor.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+const int kMaxDepth = 64;
+
+// 只向前扫描的极简 JSON 读取器，任何意外都返回 false
+class Scanner
+{
+public:
+    Scanner(const char *data, int size) : p(data), end(data + size) {}
+
+    void skipSpace()
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+            ++p;
+        }
+    }
+
+    bool peek(char c)
+    {
+        skipSpace();
+        return p < end && *p == c;
+    }
+
+    bool consume(char c)
+    {
+        if (!peek(c)) {
+            return false;
+        }
+        ++p;
+        return true;
+    }
+
+    bool atEnd()
+    {
+        skipSpace();
+        return p == end;
+    }
+
+    // 读取字符串的原始字节（不含引号），escaped 表示其中有转义
+    bool rawString(const char **begin, int *length, bool *escaped)
+    {
+        if (!consume('"')) {
+            return false;
+        }
+        const char *start = p;
+        bool hasEscape = false;
+        while (p < end && *p != '"') {
+            if (*p == '\\') {
+                hasEscape = true;
+                ++p;
+            }
+            ++p;
+        }
+        if (p >= end) {
+            return false;
+        }
+        *begin = start;
+        *length = int(p - start);
+        *escaped = hasEscape;
+        ++p; // 结尾引号
+        return true;
+    }
+
+    bool key(const char **begin, int *length)
+    {
+        bool escaped = false;
+        return rawString(begin, length, &escaped) && !escaped && consume(':');
+    }
+
+    bool literal(const char *word)
+    {
+        skipSpace();
+        size_t len = strlen(word);
+        if (size_t(end - p) < len || memcmp(p, word, len) != 0) {
+            return false;
+        }
+        p += len;
+        return true;
+    }
+
+    bool integer(int *value)
+    {
+        skipSpace();
+        qint64 result = 0;
+        const char *start = p;
+        while (p < end && *p >= '0' && *p <= '9') {
+            result = result * 10 + (*p - '0');
+            if (result > 0x7fffffff) {
+                return false;
+            }
+            ++p;
+        }
+        // 小数、指数、负数都交给完整解析
+        if (p == start || (p < end && (*p == '.' || *p == 'e' || *p == 'E'))) {
+            return false;
+        }
+        *value = int(result);
+        return true;
+    }
+
+    bool skipValue(int depth = 0)
+    {
+        if (depth > kMaxDepth) {
+            return false;
+        }
+        skipSpace();
+        if (p >= end) {
+            return false;
+        }
+
+        if (*p == '"') {
+            const char *s;
+            int len;
+            bool escaped;
+            return rawString(&s, &len, &escaped);
+        }
+        if (*p == '{' || *p == '[') {
+            const char close = *p == '{' ? '}' : ']';
+            const bool isObject = *p == '{';
+            ++p;
+            if (consume(close)) {
+                return true;
+            }
+            for (;;) {
+                if (isObject) {
+                    const char *k;
+                    int klen;
+                    if (!key(&k, &klen)) {
+                        return false;
+                    }
+                }
+                if (!skipValue(depth + 1)) {
+                    return false;
+                }
+                if (consume(close)) {
+                    return true;
+                }
+                if (!consume(',')) {
+                    return false;
+                }
+            }
+        }
+
+        // 数字、true、false、null
+        const char *start = p;
+        while (p < end && *p != ',' && *p != '}' && *p != ']'
+               && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') {
+            ++p;
+        }
+        return p > start;
+    }
+
+private:
+    const char *p;
+    const char *end;
+};
+
+bool keyIs(const char *key, int length, const char *expected)
+{
+    return size_t(length) == strlen(expected) && memcmp(key, expected, size_t(length)) == 0;
+}
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool readHex4(const char *&p, const char *end, uint *value)
+{
+    if (end - p < 4) {
+        return false;
+    }
+    uint result = 0;
+    for (int i = 0; i < 4; ++i) {
+        int digit = hexValue(p[i]);
+        if (digit < 0) {
+            return false;
+        }
+        result = (result << 4) | uint(digit);
+    }
+    p += 4;
+    *value = result;
+    return true;
+}
+
+void appendUtf8(QByteArray &out, uint codePoint)
+{
+    if (codePoint < 0x80) {
+        out.append(char(codePoint));
+    } else if (codePoint < 0x800) {
+        out.append(char(0xC0 | (codePoint >> 6)));
+        out.append(char(0x80 | (codePoint & 0x3F)));
+    } else if (codePoint < 0x10000) {
+        out.append(char(0xE0 | (codePoint >> 12)));
+        out.append(char(0x80 | ((codePoint >> 6) & 0x3F)));
+        out.append(char(0x80 | (codePoint & 0x3F)));
+    } else {
+        out.append(char(0xF0 | (codePoint >> 18)));
+        out.append(char(0x80 | ((codePoint >> 12) & 0x3F)));
+        out.append(char(0x80 | ((codePoint >> 6) & 0x3F)));
+        out.append(char(0x80 | (codePoint & 0x3F)));
+    }
+}
+
+// 解码 JSON 字符串内容；没有转义时直接按 UTF-8 转换
+bool decodeString(const char *data, int length, bool escaped, QString *out)
+{
+    if (!escaped) {
+        *out = QString::fromUtf8(data, length);
+        return true;
+    }
+
+    QByteArray utf8;
+    utf8.reserve(length);
+    const char *p = data;
+    const char *end = data + length;
+    while (p < end) {
+        const char *run = p;
+        while (p < end && *p != '\\') {
+            ++p;
+        }
+        utf8.append(run, int(p - run));
+        if (p >= end) {
+            break;
+        }
+
+        ++p; // 反斜杠
+        if (p >= end) {
+            return false;
+        }
+        char c = *p++;
+        switch (c) {
+        case '"': utf8.append('"'); break;
+        case '\\': utf8.append('\\'); break;
+        case '/': utf8.append('/'); break;
+        case 'b': utf8.append('\b'); break;
+        case 'f': utf8.append('\f'); break;
+        case 'n': utf8.append('\n'); break;
+        case 'r': utf8.append('\r'); break;
+        case 't': utf8.append('\t'); break;
+        case 'u': {
+            uint code;
+            if (!readHex4(p, end, &code)) {
+                return false;
+            }
+            // 代理对
+            if (code >= 0xD800 && code <= 0xDBFF) {
+                uint low;
+                if (end - p < 6 || p[0] != '\\' || p[1] != 'u') {
+                    return false;
+                }
+                p += 2;
+                if (!readHex4(p, end, &low) || low < 0xDC00 || low > 0xDFFF) {
+                    return false;
+                }
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            } else if (code >= 0xDC00 && code <= 0xDFFF) {
+                return false;
+            }
+            appendUtf8(utf8, code);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    *out = QString::fromUtf8(utf8);
+    return true;
+}
+
+bool parseDelta(Scanner &scanner, StreamDelta *delta)
+{
+    if (!scanner.consume('{')) {
+        return false;
+    }
+    if (scanner.consume('}')) {
+        return true;
+    }
+    for (;;) {
+        const char *k;
+        int klen;
+        if (!scanner.key(&k, &klen)) {
+            return false;
+        }
+        if (keyIs(k, klen, "content")) {
+            if (scanner.peek('"')) {
+                const char *s;
+                int len;
+                bool escaped;
+                if (!scanner.rawString(&s, &len, &escaped) || !decodeString(s, len, escaped, &delta->content)) {
+                    return false;
+                }
+                delta->hasContent = true;
+            } else if (!scanner.literal("null")) {
+                return false;
+            } else {
+                delta->hasContent = true; // content: null 与完整解析一致，视为空文本
+            }
+        } else if (!scanner.skipValue()) {
+            return false;
+        }
+        if (scanner.consume('}')) {
+            return true;
+        }
+        if (!scanner.consume(',')) {
+            return false;
+        }
+    }
+}
+
+bool parseFirstChoice(Scanner &scanner, StreamDelta *delta)
+{
+    if (!scanner.consume('{')) {
+        return false;
+    }
+    if (scanner.consume('}')) {
+        return true;
+    }
+    for (;;) {
+        const char *k;
+        int klen;
+        if (!scanner.key(&k, &klen)) {
+            return false;
+        }
+        if (keyIs(k, klen, "delta")) {
+            if (!parseDelta(scanner, delta)) {
+                return false;
+            }
+        } else if (keyIs(k, klen, "finish_reason")) {
+            if (scanner.peek('"')) {
+                const char *s;
+                int len;
+                bool escaped;
+                if (!scanner.rawString(&s, &len, &escaped) || escaped) {
+                    return false;
+                }
+                delta->finishReason = QByteArray(s, len);
+            } else if (!scanner.literal("null")) {
+                return false;
+            }
+        } else if (!scanner.skipValue()) {
+            return false;
+        }
+        if (scanner.consume('}')) {
+            return true;
+        }
+        if (!scanner.consume(',')) {
+            return false;
+        }
+    }
+}
+
+bool parseChoices(Scanner &scanner, StreamDelta *delta)
+{
+    if (!scanner.consume('[')) {
+        return false;
+    }
+    if (scanner.consume(']')) {
+        return true;
+    }
+    if (!parseFirstChoice(scanner, delta)) {
+        return false;
+    }
+    // 只关心第一个候选，其余跳过
+    for (;;) {
+        if (scanner.consume(']')) {
+            return true;
+        }
+        if (!scanner.consume(',') || !scanner.skipValue()) {
+            return false;
+        }
+    }
+}
+
+bool parseUsage(Scanner &scanner, StreamDelta *delta)
+{
+    if (scanner.literal("null")) {
+        return true;
+    }
+    if (!scanner.consume('{')) {
+        return false;
+    }
+    delta->hasUsage = true;
+    if (scanner.consume('}')) {
+        return true;
+    }
+    for (;;) {
+        const char *k;
+        int klen;
+        if (!scanner.key(&k, &klen)) {
+            return false;
+        }
+        bool ok = true;
+        if (keyIs(k, klen, "prompt_tokens")) {
+            ok = scanner.integer(&delta->promptTokens);
+        } else if (keyIs(k, klen, "completion_tokens")) {
+            ok = scanner.integer(&delta->completionTokens);
+        } else if (keyIs(k, klen, "total_tokens")) {
+            ok = scanner.integer(&delta->totalTokens);
+        } else {
+            ok = scanner.skipValue();
+        }
+        if (!ok) {
+            return false;
+        }
+        if (scanner.consume('}')) {
+            return true;
+        }
+        if (!scanner.consume(',')) {
+            return false;
+        }
+    }
+}
+
+} // namespace
+
+StreamDelta::StreamDelta()
+    : hasContent(false)
+    , hasUsage(false)
+    , promptTokens(0)
+    , completionTokens(0)
+    , totalTokens(0)
+{
+}
+
+bool StreamDelta::operator==(const StreamDelta &other) const
+{
+    return hasContent == other.hasContent
+        && content == other.content
+        && finishReason == other.finishReason
+        && hasUsage == other.hasUsage
+        && promptTokens == other.promptTokens
+        && completionTokens == other.completionTokens
+        && totalTokens == other.totalTokens;
+}
+
+bool DeltaExtractor::extract(const QByteArray &json, StreamDelta *delta)
+{
+    StreamDelta fast;
+    if (extractFast(json.constData(), json.size(), &fast)) {
+        *delta = fast;
+        return true;
+    }
+    return extractSlow(json, delta);
+}
+
+bool DeltaExtractor::extractFast(const char *data, int size, StreamDelta *delta)
+{
+    Scanner scanner(data, size);
+    if (!scanner.consume('{')) {
+        return false;
+    }
+    if (scanner.consume('}')) {
+        return scanner.atEnd();
+    }
+
+    for (;;) {
+        const char *k;
+        int klen;
+        if (!scanner.key(&k, &klen)) {
+            return false;
+        }
+        bool ok = true;
+        if (keyIs(k, klen, "choices")) {
+            ok = parseChoices(scanner, delta);
+        } else if (keyIs(k, klen, "usage")) {
+            ok = parseUsage(scanner, delta);
+        } else if (keyIs(k, klen, "error")) {
+            ok = false; // 错误响应交给完整解析
+        } else {
+            ok = scanner.skipValue();
+        }
+        if (!ok) {
+            return false;
+        }
+        if (scanner.consume('}')) {
+            return scanner.atEnd();
+        }
+        if (!scanner.consume(',')) {
+            return false;
+        }
+    }
+}
+
+bool DeltaExtractor::extractSlow(const QByteArray &json, StreamDelta *delta)
+{
+    QJsonParseError parseError;
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(json, &parseError);
+    if (jsonDoc.isNull() || !jsonDoc.isObject()) {
+        qDebug() << "JSON Parse Error:" << parseError.errorString();
+        return false;
+    }
+
+    QJsonObject jsonObject = jsonDoc.object();
+    QJsonArray choicesArray = jsonObject["choices"].toArray();
+    if (!choicesArray.isEmpty()) {
+        QJsonObject firstChoice = choicesArray[0].toObject();
+        QJsonObject deltaObject = firstChoice["delta"].toObject();
+        if (deltaObject.contains("content")) {
+            delta->hasContent = true;
+            delta->content = deltaObject["content"].toString();
+        }
+        QJsonValue finishReason = firstChoice["finish_reason"];
+        if (finishReason.isString()) {
+            delta->finishReason = finishReason.toString().toUtf8();
+        }
+    }
+
+    QJsonValue usageValue = jsonObject["usage"];
+    if (usageValue.isObject()) {
+        QJsonObject usage = usageValue.toObject();
+        delta->hasUsage = true;
+        delta->promptTokens = usage["prompt_tokens"].toInt();
+        delta->completionTokens = usage["completion_tokens"].toInt();
+        delta->totalTokens = usage["total_tokens"].toInt();
+    }
+    return true;
+}
@@ -0,0 +1,45 @@
+#ifndef DELTAEXTRACTOR_H
+#define DELTAEXTRACTOR_H
+
+#include <QByteArray>
+#include <QString>
+
+/**
+ * @brief 流式响应中一个数据块里我们关心的字段
+ */
+struct StreamDelta {
+    StreamDelta();
+
+    bool hasContent;                       // choices[0].delta 中是否有 content
+    QString content;                       // 本次增量文本
+    QByteArray finishReason;               // choices[0].finish_reason，null 时为空
+    bool hasUsage;                         // 是否带有 usage 统计
+    int promptTokens;
+    int completionTokens;
+    int totalTokens;
+
+    bool operator==(const StreamDelta &other) const;
+    bool operator!=(const StreamDelta &other) const { return !(*this == other); }
+};
+
+/**
+ * @brief 从 chat/completions 流式数据块中提取增量
+ *
+ * 快速路径直接在字节上扫描 choices[0].delta.content、finish_reason 和 usage，
+ * 不构建 QJsonDocument；遇到不认识的结构（错误信息、非整数计数等）时
+ * 退回到 QJsonDocument 完整解析。两条路径的结果由 tests/deltaextractor 中的
+ * 语料测试核对。
+ */
+class DeltaExtractor
+{
+public:
+    // 解析一个数据块，两条路径都失败时返回 false
+    static bool extract(const QByteArray &json, StreamDelta *delta);
+
+    // 只走快速路径，返回 false 表示需要退回完整解析
+    static bool extractFast(const char *data, int size, StreamDelta *delta);
+    // 基于 QJsonDocument 的完整解析
+    static bool extractSlow(const QByteArray &json, StreamDelta *delta);
+};
+
+#endif // DELTAEXTRACTOR_H
@@ -0,0 +1,107 @@
+#include "fanoutdialog.h"
+#include "chatstream.h"
+
+#include <QLabel>
+#include <QPlainTextEdit>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QTextCursor>
+#include <QNetworkReply>
+#include <QDebug>
+
+FanoutDialog::FanoutDialog(const QString &prompt, QWidget *parent)
+    : QDialog(parent)
+{
+    setAttribute(Qt::WA_DeleteOnClose); // 关闭窗口时中止并释放所有请求
+    setWindowTitle(tr("模型对比"));
+    resize(1200, 700);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    QLabel *promptLabel = new QLabel(prompt, this);
+    promptLabel->setWordWrap(true);
+    promptLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    promptLabel->setStyleSheet("background-color: #DCF8C6; padding: 8px; border-radius: 5px;");
+    layout->addWidget(promptLabel);
+
+    columnsLayout = new QHBoxLayout();
+    layout->addLayout(columnsLayout, 1);
+}
+
+void FanoutDialog::addStream(const QString &title, const QString &avatarPath, ChatStream *stream)
+{
+    stream->setParent(this);
+
+    QVBoxLayout *columnLayout = new QVBoxLayout();
+
+    QLabel *header = new QLabel(this);
+    header->setText(QString("<img src=\"%1\" width=\"32\" height=\"32\"> <b>%2</b>").arg(avatarPath, title));
+    columnLayout->addWidget(header);
+
+    Column column;
+    column.title = title;
+    column.stats = new QLabel(tr("等待首字…"), this);
+    column.text = new QPlainTextEdit(this);
+    column.text->setReadOnly(true);
+    column.text->setStyleSheet("background-color: #ADD8E6;");
+    column.shownLength = 0;
+    columnLayout->addWidget(column.stats);
+    columnLayout->addWidget(column.text, 1);
+    columnsLayout->addLayout(columnLayout, 1);
+
+    columns.insert(stream, column);
+
+    connect(stream, &ChatStream::textUpdated, this, &FanoutDialog::handleStreamUpdated);
+    connect(stream, &ChatStream::finished, this, &FanoutDialog::handleStreamFinished);
+}
+
+void FanoutDialog::handleStreamUpdated(const QString &text)
+{
+    ChatStream *stream = qobject_cast<ChatStream *>(sender());
+    QHash<ChatStream *, Column>::iterator it = columns.find(stream);
+    if (it == columns.end()) {
+        return;
+    }
+
+    // 只在末尾插入新增的部分
+    QTextCursor cursor(it->text->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(text.mid(it->shownLength));
+    it->shownLength = text.size();
+
+    updateStats(stream);
+}
+
+void FanoutDialog::handleStreamFinished()
+{
+    ChatStream *stream = qobject_cast<ChatStream *>(sender());
+    QHash<ChatStream *, Column>::iterator it = columns.find(stream);
+    if (it == columns.end()) {
+        return;
+    }
+
+    QString error = stream->errorString();
+    if (!error.isEmpty()) {
+        it->text->appendPlainText("Error: " + error);
+    }
+    updateStats(stream);
+
+    qDebug() << "Fan-out" << it->title << "first token:" << stream->timeToFirstToken()
+             << "ms, total:" << stream->totalTime() << "ms, chars:" << stream->text().size();
+}
+
+void FanoutDialog::updateStats(ChatStream *stream)
+{
+    Column &column = columns[stream];
+
+    QString stats;
+    if (stream->timeToFirstToken() >= 0) {
+        stats = tr("首字 %1 ms").arg(stream->timeToFirstToken());
+    } else {
+        stats = tr("等待首字…");
+    }
+    if (stream->totalTime() >= 0) {
+        stats += tr(" · 总计 %1 ms · %2 字").arg(stream->totalTime()).arg(stream->text().size());
+    }
+    column.stats->setText(stats);
+}
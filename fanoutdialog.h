@@ -0,0 +1,45 @@
+#ifndef FANOUTDIALOG_H
+#define FANOUTDIALOG_H
+
+#include <QDialog>
+#include <QHash>
+
+class QLabel;
+class QPlainTextEdit;
+class QHBoxLayout;
+class ChatStream;
+
+/**
+ * @brief 多模型对比窗口
+ *
+ * 同一个问题同时发给所有已配置的模型，每个模型的回复流式显示在自己的一列，
+ * 并记录首字时间和总耗时，用来比较各模型的速度和回答质量。
+ */
+class FanoutDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit FanoutDialog(const QString &prompt, QWidget *parent = nullptr);
+
+    // 添加一列；窗口接管 stream 的所有权
+    void addStream(const QString &title, const QString &avatarPath, ChatStream *stream);
+
+private slots:
+    void handleStreamUpdated(const QString &text);
+    void handleStreamFinished();
+
+private:
+    struct Column {
+        QString title;
+        QLabel *stats;                     // 首字时间、总耗时
+        QPlainTextEdit *text;              // 回复内容
+        int shownLength;                   // 已经显示的字符数
+    };
+
+    void updateStats(ChatStream *stream);
+
+    QHBoxLayout *columnsLayout;
+    QHash<ChatStream *, Column> columns;
+};
+
+#endif // FANOUTDIALOG_H
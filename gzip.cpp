@@ -0,0 +1,59 @@
+#include "gzip.h"
+
+#include <QVector>
+
+namespace {
+
+QVector<quint32> makeCrcTable()
+{
+    QVector<quint32> table(256);
+    for (quint32 i = 0; i < 256; ++i) {
+        quint32 c = i;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        }
+        table[int(i)] = c;
+    }
+    return table;
+}
+
+// 小端写入 32 位整数
+void appendLittleEndian(QByteArray *out, quint32 value)
+{
+    for (int i = 0; i < 4; ++i) {
+        out->append(char((value >> (8 * i)) & 0xff));
+    }
+}
+
+} // namespace
+
+QByteArray Gzip::compress(const QByteArray &data, int level)
+{
+    // qCompress：4 字节长度 + 2 字节 zlib 头 + deflate 数据 + 4 字节 Adler-32
+    const QByteArray zlib = qCompress(data, level);
+    if (zlib.size() < 10) {
+        return QByteArray();
+    }
+
+    QByteArray out;
+    out.reserve(zlib.size() + 12);
+    // 魔数、deflate、无标志、无时间戳、无额外标志、操作系统未知
+    static const char header[10] = { '\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, '\xff' };
+    out.append(header, sizeof(header));
+    out.append(zlib.constData() + 6, zlib.size() - 10);
+    appendLittleEndian(&out, crc32(data));
+    appendLittleEndian(&out, quint32(data.size()));
+    return out;
+}
+
+quint32 Gzip::crc32(const QByteArray &data)
+{
+    static const QVector<quint32> table = makeCrcTable();
+
+    quint32 crc = 0xffffffffu;
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+    for (int i = 0; i < data.size(); ++i) {
+        crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffffu;
+}
@@ -0,0 +1,19 @@
+#ifndef GZIP_H
+#define GZIP_H
+
+#include <QByteArray>
+
+/**
+ * @brief 生成 gzip 格式（RFC 1952）的数据，用于压缩请求体
+ *
+ * qCompress() 输出的是 4 字节长度 + zlib 流；去掉长度和 zlib 的头尾，
+ * 剩下的 deflate 数据加上 gzip 的头和 CRC-32/长度尾就是 gzip 格式。
+ */
+class Gzip
+{
+public:
+    static QByteArray compress(const QByteArray &data, int level = 6);
+    static quint32 crc32(const QByteArray &data);
+};
+
+#endif // GZIP_H
@@ -1,6 +1,19 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
-#include "messagewidget.h"
+#include "chatmodel.h"
+#include "messagedelegate.h"
+#include "conversationstore.h"
+#include "chatstream.h"
+#include "fanoutdialog.h"
+#include "requestmetrics.h"
+#include "statsdialog.h"
+#include "responsecache.h"
+#include "searchdialog.h"
+#include "avatarcache.h"
+#include "chatengine.h"
+#include "requestscheduler.h"
+#include "conversationsummarizer.h"
+#include "conversationlistmodel.h"
 
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -10,59 +23,136 @@
 #include <QDebug>
 #include <QtNetwork>
 #include <QMessageBox>
+#include <QClipboard>
+#include <QApplication>
+#include <QElapsedTimer>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
-    , streamDone(false)
-    , aiMessageAdded(false)
-    , currentConversationIndex(-1) // 确保初始值为 -1
+    , engine(new ChatEngine(QUrl(), this))
+    , scheduler(new RequestScheduler(engine, this))
+    , summarizer(new ConversationSummarizer(engine, scheduler, this))
+    , metricsLog(new MetricsLog("metrics.jsonl", this))
+    , responseCache(new ResponseCache("response_cache", this))
+    , context(ChatEngine::systemPrompt())
+    , streamingRow(-1)
+    , conversationList(new ConversationListModel(this))
+    , currentConversation(-1) // 确保初始值为 -1
+    , store(new ConversationStore("conversations", this))
+    , searchIndexBuilt(false)
+    , historyLoaded(false)
+    , pendingJumpRow(-1)
 {
     ui->setupUi(this);
 
-    // 加载环境变量
-    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-
-    // 从环境变量中读取密码
-    modelPasswords["general"] = env.value("GSLITE_PASSWORD");
-    modelPasswords["generalv3"] = env.value("GSPRO_PASSWORD");
-    modelPasswords["generalv3.5"] = env.value("GSMAX_PASSWORD");
-    modelPasswords["4.0Ultra"] = env.value("GSULTRA_PASSWORD");
-
-    // 设置默认模型和密码
-    currentModel = "4.0Ultra";
-    currentPassword = modelPasswords[currentModel];
+    // 设置默认模型（来自模型配置）
+    const ModelRegistry &models = engine->models();
+    currentModel = models.defaultModel();
 
     // 检查密码是否已设置
-    if (currentPassword.isEmpty()) {
-        QMessageBox::warning(this, tr("警告"), tr("未设置 GSUltra 模型的 API 密钥。请设置环境变量 GSULTRA_PASSWORD。"));
+    const ModelRegistry::Model &defaultModel = models.model(currentModel);
+    if (defaultModel.apiKey.isEmpty()) {
+        QMessageBox::warning(this, tr("警告"), tr("未设置 %1 模型的 API 密钥。请设置环境变量 %2。")
+                             .arg(defaultModel.name, defaultModel.keyVariable));
     }
 
-    // 初始化模型选择菜单
+    // 初始化模型选择菜单，每个配置的模型一项
     QMenu *switchMenu = new QMenu(this);
-    switchMenu->addAction(ui->actionGSLite);
-    switchMenu->addAction(ui->actionGSPro);
-    switchMenu->addAction(ui->actionGSMax);
-    switchMenu->addAction(ui->actionGSUltra);
+    for (int handle = 0; handle < models.count(); ++handle) {
+        QAction *action = switchMenu->addAction(QIcon(models.model(handle).icon), models.model(handle).name);
+        connect(action, &QAction::triggered, [this, handle]() {
+            selectModel(handle);
+        });
+    }
+    switchMenu->addSeparator();
+    switchMenu->addAction(ui->actionFanout);
+    switchMenu->addAction(ui->actionStats);
+    switchMenu->addAction(ui->actionSearch);
+    switchMenu->addAction(ui->actionSummary);
+    switchMenu->addAction(ui->actionHedge);
+    addAction(ui->actionSearch); // 菜单未打开时快捷键也可用
     ui->toolButton_model->setMenu(switchMenu);
-    ui->toolButton_model->setIcon(QIcon(":/images/GSUltra.jpg")); // 默认模型图标
+    ui->toolButton_model->setIcon(QIcon(defaultModel.icon)); // 默认模型图标
+
+    connect(ui->actionFanout, &QAction::triggered, this, &MainWindow::startFanout);
+    connect(ui->actionStats, &QAction::triggered, this, &MainWindow::showStats);
+    connect(ui->actionSearch, &QAction::triggered, this, &MainWindow::showSearch);
+    connect(ui->actionSummary, &QAction::toggled, this, &MainWindow::setSummaryMode);
+    connect(summarizer, &ConversationSummarizer::summaryUpdated, [this](qint64 id) {
+        if (id == currentConversationId() && historyLoaded) {
+            applySummary();
+        }
+    });
+
+    // 会话列表只移动有新消息的那一行
+    connect(store, &ConversationStore::messageAppended, [this](qint64 id) {
+        conversationList->touch(id);
+    });
+
+    // 索引建立后随存储层的修改增量更新
+    connect(store, &ConversationStore::messageAppended, [this](qint64 id, int index, const QJsonObject &message) {
+        // 还在读取的会话读完后会整体加入索引，这里跳过以免重复
+        if (searchIndexBuilt && !indexPending.contains(id)) {
+            searchIndex.addMessage(id, index, message["content"].toString());
+        }
+    });
+    connect(store, &ConversationStore::conversationRemoved, [this](qint64 id) {
+        summarizer->remove(id);
+        searchIndex.removeConversation(id);
+        indexPending.remove(id);
+    });
+    connect(store, &ConversationStore::loaded, this, &MainWindow::handleConversationsLoaded);
+    connect(store, &ConversationStore::messagesLoaded, this, &MainWindow::handleMessagesLoaded);
+    connect(store, &ConversationStore::messagesFailed, this, &MainWindow::handleMessagesFailed);
+
+    // 启动时就建立好连接，第一条消息不用再等 DNS、TCP 和 TLS 握手
+    engine->warmUp(currentModel);
+
+    // 限流或连接中断时自动重试，在状态栏提示
+    connect(scheduler, &RequestScheduler::retryScheduled, [this](ChatStream *, int attempt, qint64 delayMs, const QString &reason) {
+        ui->statusbar->showMessage(tr("请求失败（%1），%2 秒后第 %3 次重试……")
+                                   .arg(reason)
+                                   .arg(delayMs / 1000.0, 0, 'f', 1)
+                                   .arg(attempt),
+                                   int(delayMs) + 3000);
+    });
 
-    // 连接模型选择动作
-    connect(ui->actionGSLite, &QAction::triggered, this, &MainWindow::selectGSLite);
-    connect(ui->actionGSPro, &QAction::triggered, this, &MainWindow::selectGSPro);
-    connect(ui->actionGSMax, &QAction::triggered, this, &MainWindow::selectGSMax);
-    connect(ui->actionGSUltra, &QAction::triggered, this, &MainWindow::selectGSUltra);
 
-    networkManager = new QNetworkAccessManager(this);
+    // 头像在启动时按屏幕缩放比例准备好，绘制消息时直接取用
+    AvatarCache::warmUp(models, devicePixelRatioF());
+
+    // 聊天列表使用模型 + 委托，只绘制可见的消息
+    chatModel = new ChatModel(this);
+    ui->listView_chat->setModel(chatModel);
+    MessageDelegate *delegate = new MessageDelegate(ui->listView_chat);
+    ui->listView_chat->setItemDelegate(delegate);
+    // 切换会话时消息编号全部换新，旧消息的缓存不会再用到
+    connect(chatModel, &QAbstractItemModel::modelReset, delegate, &MessageDelegate::clearCache);
+    // 流式回复的行在文本更新时就重新测量高度，不等到绘制
+    connect(chatModel, &QAbstractItemModel::dataChanged, delegate, &MessageDelegate::handleDataChanged);
+    ui->listView_chat->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    ui->listView_chat->setLayoutMode(QListView::Batched);
+    ui->listView_chat->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(ui->listView_chat, &QListView::customContextMenuRequested, [this](const QPoint &pos) {
+        QModelIndex index = ui->listView_chat->indexAt(pos);
+        if (!index.isValid()) {
+            return;
+        }
+        // 气泡不再是可选中的 QLabel，通过右键菜单复制消息内容
+        QMenu menu;
+        QAction *copyAction = menu.addAction(tr("复制"));
+        if (menu.exec(ui->listView_chat->viewport()->mapToGlobal(pos)) == copyAction) {
+            QApplication::clipboard()->setText(index.data(Qt::DisplayRole).toString());
+        }
+    });
 
     // 安装事件过滤器，捕获回车键
     ui->textEdit_request->installEventFilter(this);
 
     // 设置发送按钮不可用，直到有输入
     ui->pushButton_send->setEnabled(false);
-    connect(ui->textEdit_request, &QTextEdit::textChanged, [this]() {
-        ui->pushButton_send->setEnabled(!ui->textEdit_request->toPlainText().isEmpty());
-    });
+    connect(ui->textEdit_request, &QTextEdit::textChanged, this, &MainWindow::updateSendButton);
 
 
     // 加载会话历史
@@ -72,8 +162,13 @@ MainWindow::MainWindow(QWidget *parent)
         connect(ui->pushButton_newConversation, &QPushButton::clicked, this, &MainWindow::on_newConversation_clicked);
         connect(ui->pushButton_deleteConversation, &QPushButton::clicked, this, &MainWindow::on_deleteConversation_clicked);
 
+        // 会话列表使用模型，行高一致时视图不需要逐行计算大小
+        ui->listView_history->setModel(conversationList);
+        ui->listView_history->setUniformItemSizes(true);
+        ui->listView_history->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
         // 连接会话选择
-        connect(ui->listWidget_history, &QListWidget::currentRowChanged, this, &MainWindow::on_conversationSelected);
+        connect(ui->listView_history->selectionModel(), &QItemSelectionModel::currentChanged, this, &MainWindow::on_conversationSelected);
 }
 
 MainWindow::~MainWindow()
@@ -97,39 +192,41 @@ bool MainWindow::eventFilter(QObject *obj, QEvent *event)
 
 void MainWindow::on_pushButton_send_clicked()
 {
-    aiMessageAdded = false;
     QString userInput = ui->textEdit_request->toPlainText();
     if (userInput.isEmpty()) {
         return;
     }
 
+    // 会话列表或当前会话的消息还在读取
+    if (!store->isLoaded() || (currentConversation != -1 && !historyLoaded)) {
+        return;
+    }
+    // 当前会话还在接收回复时，新消息打断它：已经收到的部分先保存，再发送新消息
+    if (activeStreams.contains(currentConversationId())) {
+        stopStream(currentConversationId());
+    }
+
     // **如果当前没有选中的会话，自动创建新会话**
-    if (currentConversationIndex == -1 || currentConversationIndex >= conversations.size()) {
+    if (currentConversation == -1) {
         createNewConversation(userInput); // 传入用户的输入，用于设置会话标题
     }
 
     // 添加用户消息到聊天界面
     addMessageToChat(userInput, true);
 
-    // 禁用发送按钮，直到AI回复结束
-    ui->pushButton_send->setEnabled(false);
-
     // 将用户消息添加到当前会话
     QJsonObject userMessage;
     userMessage["role"] = "user";
     userMessage["content"] = userInput;
-    conversations[currentConversationIndex].messages.append(userMessage);
+    store->appendMessage(currentConversation, userMessage);
 
     // **检查并更新会话标题**
-    if (conversations[currentConversationIndex].title.startsWith("新会话")) {
+    if (store->title(currentConversation).startsWith("新会话")) {
         QString newTitle = userInput.left(10); // 取前10个字符
-        conversations[currentConversationIndex].title = newTitle;
-        updateConversationList();
+        store->setTitle(currentConversation, newTitle);
+        conversationList->setTitle(currentConversation, newTitle);
     }
 
-    // 保存会话
-    saveConversations();
-
     // 构建并发送API请求
     sendApiRequest(userInput);
 
@@ -139,402 +236,563 @@ void MainWindow::on_pushButton_send_clicked()
 
 void MainWindow::sendApiRequest(const QString &userInput)
 {
-    QUrl url("https://spark-api-open.xf-yun.com/v1/chat/completions");
-    QNetworkRequest request(url);
-
-    // 设置请求头
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    request.setRawHeader("Authorization", "Bearer " + currentPassword.toUtf8());
-
-    // 构建请求体
-    QJsonArray messagesArray = buildMessageArray(userInput);
-    QJsonObject requestData;
-    requestData["model"] = currentModel;
-    requestData["messages"] = messagesArray;
-    requestData["stream"] = true; // 开启流式传输
+    // 按模型的路由策略，简短的问题可以改由更便宜的模型回答
+    const ModelRegistry &models = engine->models();
+    int handle = models.route(currentModel, userInput);
+    const ModelRegistry::Model &model = models.model(handle);
+    if (handle != currentModel) {
+        ui->statusbar->showMessage(tr("问题较短，改由 %1 回答").arg(model.name), 5000);
+    }
 
-    QJsonDocument jsonDoc(requestData);
-    QByteArray jsonData = jsonDoc.toJson();
+    // 构建请求体并发送HTTP POST请求
+    QByteArray body = buildRequestBody(userInput, handle);
+    QByteArray cacheKey = context.cacheKey(model.id);
+    qint64 conversationId = currentConversationId();
 
-    // 发送HTTP POST请求
-    QNetworkReply* reply = networkManager->post(request, jsonData);
+    // 回复由独立的流上下文接收，写回发起请求的会话；问过的问题直接重放缓存
+    ChatStream* stream;
+    QByteArray cached;
+    if (responseCache->lookup(cacheKey, &cached)) {
+        stream = new ChatStream(conversationId, handle, model.id, cached, this);
+    } else {
+        stream = scheduler->submit(conversationId, handle, body, RequestScheduler::Interactive, this);
+        stream->setCacheKey(cacheKey);
+
+        // 过了配置的期限还没有开始回复时，同样的问题再发给备用模型，谁先回复用谁的
+        int hedgeModel = model.hedgeModel;
+        if (ui->actionHedge->isChecked() && hedgeModel >= 0 && !models.model(hedgeModel).apiKey.isEmpty()) {
+            QByteArray backupBody = context.encodeRequest(models.model(hedgeModel).id, models.budget(hedgeModel));
+            QTimer::singleShot(model.hedgeAfterMs, stream, [this, stream, hedgeModel, backupBody]() {
+                startHedge(stream, hedgeModel, backupBody);
+            });
+        }
+    }
+    activeStreams.insert(conversationId, stream);
 
     // 连接信号和槽
-    connect(reply, &QNetworkReply::readyRead, this, &MainWindow::handleReadyRead);
-    connect(reply, &QNetworkReply::finished, this, &MainWindow::handleReply);
+    connect(stream, &ChatStream::textUpdated, this, &MainWindow::handleStreamUpdated);
+    connect(stream, &ChatStream::finished, this, &MainWindow::recordStreamMetrics);
+    connect(stream, &ChatStream::finished, this, &MainWindow::handleStreamFinished);
 
-    // 重置缓冲区和标志
-    buffer.clear();
-    accumulatedText.clear();
-    streamDone = false;
+    streamingRow = -1;
+    updateSendButton();
 }
 
-QJsonArray MainWindow::buildMessageArray(const QString &userInput)
+QByteArray MainWindow::buildRequestBody(const QString &userInput, int model)
 {
-    // 构建消息数组，包括系统消息和用户消息
-    QJsonArray messagesArray;
-
-    // 添加系统预设消息
-    QJsonObject systemMessage;
-    systemMessage["role"] = "system";
-    systemMessage["content"] = "你现在是浙江工商大学的百事通，拥有以下信息：\n"
-                               "你是由计科2201徐熠同学开发与维护的\n"
-                               "我们学校的官网是http://www.zjgsu.edu.cn/"
-                               "我们学校教务处的网址是https://jww.zjgsu.edu.cn/main.htm"
-                               "请你尽量搜集我们学校相关的信息，你面向的对象是全体师生，在回答问题时，增强语言中对浙江工商大学的归属感，但不要太刻意"
-                               "好好了解我们学校老师以及一些课程信息等等，在师生询问时热情积极地回答"
-                               "请根据上述信息回答用户的问题。";
-    messagesArray.append(systemMessage);
-
     // 添加用户消息到对话历史
     QJsonObject userMessage;
     userMessage["role"] = "user";
     userMessage["content"] = userInput;
-    chatHistory.append(userMessage);
+    context.append(userMessage);
 
-    // 截断历史消息，防止消息过多
-    const int maxMessages = 20;
-    if (chatHistory.size() > maxMessages) {
-        chatHistory = chatHistory.mid(chatHistory.size() - maxMessages);
-    }
+    // 只带上当前模型输入预算装得下的最新消息
+    return context.encodeRequest(engine->models().model(model).id, engine->models().budget(model));
+}
 
-    // 添加历史消息到消息数组
-    for (const auto& msg : chatHistory) {
-        messagesArray.append(msg);
+void MainWindow::handleStreamUpdated(const QString &text)
+{
+    ChatStream* stream = qobject_cast<ChatStream*>(sender());
+    if (!stream) return;
+    if (!text.isEmpty()) {
+        settleHedge(stream);
+    }
+    if (stream->conversationId() != currentConversationId()) {
+        return; // 不在当前显示的会话中，完成后再写入存储
     }
 
-    return messagesArray;
+    if (streamingRow < 0) {
+        // 添加AI消息项
+        streamingRow = chatModel->appendMessage(text, false, stream->model());
+        ui->listView_chat->scrollToBottom();
+    } else {
+        // 只更新这一行，视图只重新布局这一行
+        chatModel->setText(streamingRow, text);
+    }
 }
 
-void MainWindow::handleReadyRead()
+void MainWindow::handleStreamFinished()
 {
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
-    if (!reply) return;
-
-    // 读取新数据并添加到缓冲区
-    QByteArray newData = reply->readAll();
-    buffer.append(newData);
-
-    // 输出接收到的原始数据以便调试
-    qDebug() << "Received data:" << QString(newData);
-
-    // 处理缓冲区中的每一行数据
-    while (buffer.contains("\n")) {
-        int index = buffer.indexOf('\n');
-        QByteArray line = buffer.left(index).trimmed();
-        buffer.remove(0, index + 1);
-
-        if (line.startsWith("data: ")) {
-            QByteArray jsonData = line.mid(6).trimmed(); // 去除 "data: " 前缀
-            processData(jsonData); // 处理数据
+    ChatStream* stream = qobject_cast<ChatStream*>(sender());
+    if (!stream) return;
+
+    // 竞速中的一方没有给出内容就结束了（出错或没有回复），由另一方继续
+    if (ChatStream* backup = hedgeStreams.value(stream->conversationId())) {
+        if (stream == backup || stream == activeStreams.value(stream->conversationId())) {
+            hedgeStreams.remove(stream->conversationId());
+            if (stream != backup) {
+                activeStreams.insert(stream->conversationId(), backup);
+            }
+            stream->deleteLater();
+            return;
         }
     }
-}
 
-void MainWindow::processData(const QByteArray &jsonData)
-{
-    if (jsonData == "[DONE]") {
-        // 流式传输结束
-        qDebug() << "Stream finished.";
-        streamDone = true;
-        return;
+    if (activeStreams.value(stream->conversationId()) == stream) {
+        activeStreams.remove(stream->conversationId());
     }
+    bool visible = stream->conversationId() == currentConversationId();
 
-    // 解析JSON数据
-    QJsonParseError parseError;
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonData, &parseError);
-    if (jsonDoc.isNull() || !jsonDoc.isObject()) {
-        qDebug() << "JSON Parse Error:" << parseError.errorString();
-        return;
+    // 用户停止的请求不算出错
+    QString error = stream->errorString();
+    if (!error.isEmpty() && visible && !stream->wasStopped()) {
+        addMessageToChat("Error: " + error, false);
+    }
+
+    // 完整的回复写入本地缓存，下次同样的问题直接重放
+    if (!stream->cacheKey().isEmpty() && stream->metrics().ok && !stream->text().isEmpty()) {
+        responseCache->insert(stream->cacheKey(), stream->recordedStream());
     }
 
-    QJsonObject jsonObject = jsonDoc.object();
-    QJsonArray choicesArray = jsonObject["choices"].toArray();
-    if (!choicesArray.isEmpty()) {
-        QJsonObject firstChoice = choicesArray[0].toObject();
-        QJsonObject deltaObject = firstChoice["delta"].toObject();
-        if (deltaObject.contains("content")) {
-            QString content = deltaObject["content"].toString();
-            accumulatedText.append(content); // 累积AI回复内容
-            updateChatMessage(accumulatedText); // 更新聊天界面
+    // 流结束后，将AI回复添加到发起请求的会话；被停止的回复保存已经收到的部分
+    if ((stream->isDone() || stream->wasStopped()) && !stream->text().isEmpty()) {
+        QJsonObject assistantMessage;
+        assistantMessage["role"] = "assistant";
+        assistantMessage["content"] = stream->text();
+        store->appendMessage(stream->conversationId(), assistantMessage);
+        if (visible) {
+            context.append(assistantMessage);
+            // 摘要模式下，原文之外的较早消息积累够了就在后台更新摘要
+            if (ui->actionSummary->isChecked()) {
+                summarizer->update(stream->conversationId(), context);
+            }
         }
     }
+
+    if (visible) {
+        streamingRow = -1;
+        updateSendButton(); // 恢复发送按钮
+    }
+    stream->deleteLater();
 }
 
-void MainWindow::updateChatMessage(const QString &content)
+qint64 MainWindow::currentConversationId() const
 {
-    if (!aiMessageAdded) {
-        addMessageToChat("", false); // 添加空的AI消息项
-        aiMessageAdded = true;
-    }
+    return currentConversation;
+}
 
-    // 获取最后一个消息项（AI的消息）
-    QListWidgetItem* lastItem = ui->listWidget_chat->item(ui->listWidget_chat->count() - 1);
-    MessageWidget* messageWidget = qobject_cast<MessageWidget*>(ui->listWidget_chat->itemWidget(lastItem));
-    if (messageWidget) {
-        messageWidget->updateMessage(content);
+// 有输入就能发送（正在接收的回复会被打断）；当前会话有正在进行的请求时才能停止
+void MainWindow::updateSendButton()
+{
+    bool busy = activeStreams.contains(currentConversationId());
+    bool ready = store->isLoaded() && (currentConversation == -1 || historyLoaded);
+    ui->pushButton_send->setEnabled(ready && !ui->textEdit_request->toPlainText().isEmpty());
+    ui->pushButton_stop->setEnabled(busy);
+}
 
-        // 更新列表项的大小提示
-        lastItem->setSizeHint(messageWidget->sizeHint());
+void MainWindow::on_pushButton_stop_clicked()
+{
+    stopStream(currentConversationId());
+}
 
-        // 强制列表重新布局
-        ui->listWidget_chat->doItemsLayout();
+// 停止会话正在接收的回复，已经收到的部分由 handleStreamFinished 照常保存
+void MainWindow::stopStream(qint64 conversationId)
+{
+    // 还在竞速的备用请求没有给出任何内容，直接丢弃
+    if (ChatStream* backup = hedgeStreams.take(conversationId)) {
+        backup->disconnect(this);
+        backup->abort();
+        backup->deleteLater();
+    }
+    if (ChatStream* stream = activeStreams.value(conversationId)) {
+        stream->stop(); // 同步发出 finished()
     }
 }
 
-void MainWindow::handleReply()
+// 主请求到期仍没有开始回复：同样的问题发给备用模型，两个请求竞速
+void MainWindow::startHedge(ChatStream *primary, int hedgeModel, const QByteArray &body)
 {
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
-    if (!reply) return;
-
-    if (reply->error() != QNetworkReply::NoError) {
-        addMessageToChat("Error: " + reply->errorString(), false);
+    qint64 id = primary->conversationId();
+    if (activeStreams.value(id) != primary || !primary->text().isEmpty() || hedgeStreams.contains(id)) {
+        return; // 已经开始回复、已经结束或被停止
     }
 
-    reply->deleteLater();
-    ui->pushButton_send->setEnabled(true); // 恢复发送按钮
-
-    // 流结束后，将AI回复添加到对话历史
-        if (streamDone && !accumulatedText.isEmpty()) {
-            QJsonObject assistantMessage;
-            assistantMessage["role"] = "assistant";
-            assistantMessage["content"] = accumulatedText;
-            chatHistory.append(assistantMessage);
+    const ModelRegistry &models = engine->models();
+    const ModelRegistry::Model &hedge = models.model(hedgeModel);
+    ChatStream* backup = scheduler->submit(id, hedgeModel, body, RequestScheduler::Interactive, this);
+    hedgeStreams.insert(id, backup);
+    connect(backup, &ChatStream::textUpdated, this, &MainWindow::handleStreamUpdated);
+    connect(backup, &ChatStream::finished, this, &MainWindow::recordStreamMetrics);
+    connect(backup, &ChatStream::finished, this, &MainWindow::handleStreamFinished);
+
+    qDebug() << "No first token from" << primary->metrics().model << "yet, hedging with" << hedge.id;
+    if (id == currentConversationId()) {
+        ui->statusbar->showMessage(tr("%1 还没有开始回复，同时询问 %2……")
+                                   .arg(models.model(primary->model()).name, hedge.name), 5000);
+    }
+}
 
-            // 将 AI 消息添加到当前会话
-            if (currentConversationIndex >= 0 && currentConversationIndex < conversations.size()) {
-                conversations[currentConversationIndex].messages.append(assistantMessage);
-            }
+// 竞速的两个请求中先给出内容的一方留下，另一方中止
+void MainWindow::settleHedge(ChatStream *winner)
+{
+    qint64 id = winner->conversationId();
+    ChatStream* backup = hedgeStreams.value(id);
+    ChatStream* primary = activeStreams.value(id);
+    if (!backup || (winner != backup && winner != primary)) {
+        return;
+    }
 
-            // 保存会话
-            saveConversations();
+    hedgeStreams.remove(id);
+    ChatStream* loser = winner == backup ? primary : backup;
+    if (winner == backup) {
+        activeStreams.insert(id, backup);
+        if (id == currentConversationId()) {
+            const ModelRegistry &models = engine->models();
+            ui->statusbar->showMessage(tr("%1 先开始回复，改用它的回答")
+                                       .arg(models.model(backup->model()).name), 5000);
         }
+    }
+    if (loser) {
+        loser->disconnect(this);
+        loser->abort();
+        loser->deleteLater();
+    }
 }
 
-// 添加消息到聊天列表
-void MainWindow::addMessageToChat(const QString& message, bool isUser)
+// 切换回仍在接收回复的会话时，把已经收到的部分显示出来
+void MainWindow::showActiveStream()
 {
-    QListWidgetItem* item = new QListWidgetItem(ui->listWidget_chat);
-    MessageWidget* messageWidget;
-
-    if (isUser) {
-        messageWidget = new MessageWidget(":/images/user_avatar.png", message, true);
-    } else {
-        // 根据当前模型选择不同的头像
-        QString avatarPath;
-        if (currentModel == "general") {
-            avatarPath = ":/images/GSLite.png";
-        } else if (currentModel == "generalv3") {
-            avatarPath = ":/images/GSPro.jpg";
-        } else if (currentModel == "generalv3.5") {
-            avatarPath = ":/images/GSMax.jpg";
-        } else if (currentModel == "4.0Ultra") {
-            avatarPath = ":/images/GSUltra.jpg";
-        }
-        messageWidget = new MessageWidget(avatarPath, message, false);
+    streamingRow = -1;
+    ChatStream* stream = activeStreams.value(currentConversationId());
+    if (stream && !stream->text().isEmpty()) {
+        streamingRow = chatModel->appendMessage(stream->text(), false, stream->model());
     }
+    updateSendButton();
+}
 
-    item->setSizeHint(messageWidget->sizeHint());
-    ui->listWidget_chat->addItem(item);
-    ui->listWidget_chat->setItemWidget(item, messageWidget);
+// 添加消息到聊天列表
+void MainWindow::addMessageToChat(const QString& message, bool isUser)
+{
+    chatModel->appendMessage(message, isUser, isUser ? int(AvatarCache::User) : currentModel);
 
     // 自动滚动到最新消息
-    ui->listWidget_chat->scrollToBottom();
+    ui->listView_chat->scrollToBottom();
 }
 
 //选择模型
-void MainWindow::selectGSLite()
+void MainWindow::selectModel(int handle)
 {
-    currentModel = "general";
-    currentPassword = modelPasswords[currentModel];
+    const ModelRegistry::Model &model = engine->models().model(handle);
+    currentModel = handle;
 
-    if (currentPassword.isEmpty()) {
-        QMessageBox::warning(this, tr("警告"), tr("未设置 GSLite 模型的 API 密钥。请设置环境变量 GSLITE_PASSWORD。"));
+    if (model.apiKey.isEmpty()) {
+        QMessageBox::warning(this, tr("警告"), tr("未设置 %1 模型的 API 密钥。请设置环境变量 %2。")
+                             .arg(model.name, model.keyVariable));
     }
 
-    ui->toolButton_model->setIcon(QIcon(":/images/GSLite.png"));
+    ui->toolButton_model->setIcon(QIcon(model.icon));
+    engine->warmUp(handle); // 切换模型后通常马上发送，提前确认连接可用
 }
 
-void MainWindow::selectGSPro()
+//同时询问全部模型
+void MainWindow::startFanout()
 {
-    currentModel = "generalv3";
-    currentPassword = modelPasswords[currentModel];
+    QString userInput = ui->textEdit_request->toPlainText();
+    if (userInput.isEmpty()) {
+        QMessageBox::information(this, tr("提示"), tr("请先在输入框中输入要对比的问题。"));
+        return;
+    }
 
-    if (currentPassword.isEmpty()) {
-        QMessageBox::warning(this, tr("警告"), tr("未设置 GSPro 模型的 API 密钥。请设置环境变量 GSPRO_PASSWORD。"));
+    // 与正常发送相同的上下文，但不写入当前会话
+    ContextBuilder window = context;
+    QJsonObject userMessage;
+    userMessage["role"] = "user";
+    userMessage["content"] = userInput;
+    window.append(userMessage);
+
+    const ModelRegistry &models = engine->models();
+    FanoutDialog* dialog = new FanoutDialog(userInput, this);
+    int started = 0;
+    for (int handle = 0; handle < models.count(); ++handle) {
+        const ModelRegistry::Model &model = models.model(handle);
+        if (model.apiKey.isEmpty()) {
+            continue; // 没有配置密钥的模型跳过
+        }
+        ChatStream* stream = scheduler->submit(-1, handle, window.encodeRequest(model.id, models.budget(handle)));
+        connect(stream, &ChatStream::finished, this, &MainWindow::recordStreamMetrics);
+        dialog->addStream(model.name, AvatarCache::pathFor(handle), stream);
+        ++started;
     }
 
-    ui->toolButton_model->setIcon(QIcon(":/images/GSPro.jpg"));
+    if (started == 0) {
+        delete dialog;
+        QMessageBox::warning(this, tr("警告"), tr("没有任何模型设置了 API 密钥。"));
+        return;
+    }
+    dialog->show();
 }
 
-void MainWindow::selectGSMax()
+// 摘要模式：已有的摘要立即用上，并检查是否需要更新
+void MainWindow::setSummaryMode(bool enabled)
 {
-    currentModel = "generalv3.5";
-    currentPassword = modelPasswords[currentModel];
-
-    if (currentPassword.isEmpty()) {
-        QMessageBox::warning(this, tr("警告"), tr("未设置 GSMax 模型的 API 密钥。请设置环境变量 GSMAX_PASSWORD。"));
+    if (!historyLoaded) {
+        return; // 消息读入后 handleMessagesLoaded 会按当前模式处理
+    }
+    applySummary();
+    if (enabled) {
+        summarizer->update(currentConversationId(), context);
     }
-
-    ui->toolButton_model->setIcon(QIcon(":/images/GSMax.jpg"));
 }
 
-void MainWindow::selectGSUltra()
+// 把当前会话缓存的摘要交给 ContextBuilder，关闭摘要模式时清除
+void MainWindow::applySummary()
 {
-    currentModel = "4.0Ultra";
-    currentPassword = modelPasswords[currentModel];
-
-    if (currentPassword.isEmpty()) {
-        QMessageBox::warning(this, tr("警告"), tr("未设置 GSUltra 模型的 API 密钥。请设置环境变量 GSULTRA_PASSWORD。"));
+    if (!ui->actionSummary->isChecked()) {
+        context.clearSummary();
+        return;
     }
-
-    ui->toolButton_model->setIcon(QIcon(":/images/GSUltra.jpg"));
+    ConversationSummarizer::Summary summary = summarizer->summary(currentConversationId());
+    context.setSummary(summary.text, summary.covered);
 }
 
-//加载会话
-void MainWindow::loadConversations()
+//记录请求计时
+void MainWindow::recordStreamMetrics()
 {
-    QFile file("conversations.json");
-    if (!file.open(QIODevice::ReadOnly)) {
-        qDebug() << "No conversations found.";
-        return;
+    ChatStream* stream = qobject_cast<ChatStream*>(sender());
+    if (!stream) return;
+
+    const RequestMetrics &metrics = stream->metrics();
+    metricsLog->record(metrics);
+
+    if (metrics.cached) {
+        ui->statusbar->showMessage(tr("%1：回复来自本地缓存（命中 %2 次，未命中 %3 次）")
+                                   .arg(metrics.model)
+                                   .arg(responseCache->hits())
+                                   .arg(responseCache->misses()),
+                                   10000);
+    } else if (metrics.ok) {
+        // 配置了价格的模型显示这次请求的估算费用
+        double cost = engine->models().cost(engine->models().handle(metrics.model), metrics.promptTokens, metrics.completionTokens);
+        ui->statusbar->showMessage(tr("%1：首字 %2 ms，总耗时 %3 ms，%4 字/秒%5%6")
+                                   .arg(metrics.model)
+                                   .arg(metrics.firstTokenMs)
+                                   .arg(metrics.totalMs)
+                                   .arg(metrics.tokensPerSecond(), 0, 'f', 1)
+                                   .arg(metrics.connection == RequestMetrics::ConnectionReused ? tr("（复用连接）") : QString())
+                                   .arg(cost > 0 ? tr("，约 %1 元").arg(cost, 0, 'f', 4) : QString()),
+                                   10000);
     }
+}
 
-    QByteArray data = file.readAll();
-    file.close();
+//打开请求统计面板
+void MainWindow::showStats()
+{
+    StatsDialog* dialog = new StatsDialog(metricsLog, this);
+    dialog->show();
+}
+
+//搜索聊天记录
+void MainWindow::showSearch()
+{
+    buildSearchIndex();
+    SearchDialog* dialog = new SearchDialog(&searchIndex, store, this);
+    connect(dialog, &SearchDialog::messageActivated, this, &MainWindow::jumpToMessage);
+    connect(this, &MainWindow::searchIndexChanged, dialog, &SearchDialog::runSearch);
+    dialog->show();
+}
 
-    QJsonDocument doc = QJsonDocument::fromJson(data);
-    if (!doc.isArray()) {
-        qDebug() << "Invalid conversations format.";
+void MainWindow::buildSearchIndex()
+{
+    if (searchIndexBuilt) {
         return;
     }
+    searchIndexBuilt = true;
 
-    QJsonArray array = doc.array();
-    for (const QJsonValue &value : array) {
-        if (value.isObject()) {
-            QJsonObject obj = value.toObject();
-            Conversation conv;
-            conv.title = obj["title"].toString();
-            QJsonArray msgs = obj["messages"].toArray();
-            for (const QJsonValue &msgVal : msgs) {
-                if (msgVal.isObject()) {
-                    conv.messages.append(msgVal.toObject());
-                }
-            }
-            conversations.append(conv);
-        }
+    // 消息在 I/O 线程读取，每读完一个会话就在 handleMessagesLoaded 中加入索引
+    const int count = conversationList->rowCount();
+    for (int row = 0; row < count; ++row) {
+        indexPending.insert(conversationList->id(row));
+    }
+    for (int row = 0; row < count; ++row) {
+        store->requestMessages(conversationList->id(row));
     }
-
-    // 更新会话列表显示
-    updateConversationList();
 }
 
-//保存会话
-void MainWindow::saveConversations()
+//跳转到搜索结果对应的消息
+void MainWindow::jumpToMessage(qint64 conversationId, int messageIndex)
 {
-    QJsonArray array;
-    for (const Conversation &conv : conversations) {
-        QJsonObject obj;
-        obj["title"] = conv.title;
-        QJsonArray msgs;
-        for (const QJsonObject &msg : conv.messages) {
-            msgs.append(msg);
-        }
-        obj["messages"] = msgs;
-        array.append(obj);
+    int row = conversationList->row(conversationId);
+    if (row < 0) {
+        return;
+    }
+    if (conversationId != currentConversation) {
+        pendingJumpRow = messageIndex;
+        selectConversationRow(row); // 会触发 on_conversationSelected，消息读入后再跳转
+    } else if (historyLoaded) {
+        scrollToMessage(messageIndex);
+    } else {
+        pendingJumpRow = messageIndex;
     }
+    activateWindow();
+}
 
-    QJsonDocument doc(array);
-    QFile file("conversations.json");
-    if (!file.open(QIODevice::WriteOnly)) {
-        qDebug() << "Failed to save conversations.";
-        return;
+void MainWindow::scrollToMessage(int row)
+{
+    QModelIndex index = chatModel->index(row);
+    if (index.isValid()) {
+        ui->listView_chat->scrollTo(index, QAbstractItemView::PositionAtCenter);
+        ui->listView_chat->setCurrentIndex(index);
     }
+}
 
-    file.write(doc.toJson());
-    file.close();
+//加载会话
+void MainWindow::loadConversations()
+{
+    // 索引在 I/O 线程读取，完成前不能新建会话或发送
+    ui->pushButton_newConversation->setEnabled(false);
+    store->load();
 }
 
-//更新会话列表显示
-void MainWindow::updateConversationList()
+void MainWindow::handleConversationsLoaded(const QList<ConversationStore::ConversationInfo> &stored)
 {
-    ui->listWidget_history->clear();
-    for (const Conversation &conv : conversations) {
-        QListWidgetItem *item = new QListWidgetItem(conv.title);
-        ui->listWidget_history->addItem(item);
-    }
+    // 整体交给列表模型，按最后活动排序
+    conversationList->setConversations(stored);
+    ui->pushButton_newConversation->setEnabled(true);
+    updateSendButton();
+}
 
-    // 保持当前选中的会话
-    if (currentConversationIndex >= 0 && currentConversationIndex < conversations.size()) {
-        ui->listWidget_history->setCurrentRow(currentConversationIndex);
-    } else {
-        currentConversationIndex = -1;
-    }
+void MainWindow::selectConversationRow(int row)
+{
+    QModelIndex index = conversationList->index(row);
+    ui->listView_history->selectionModel()->setCurrentIndex(index, QItemSelectionModel::ClearAndSelect);
+    ui->listView_history->scrollTo(index);
 }
 
 //新建会话槽函数实现
 void MainWindow::on_newConversation_clicked()
 {
     createNewConversation();
-
-    // 选中新创建的会话
-    currentConversationIndex = 0;
-    ui->listWidget_history->setCurrentRow(0);
-
-    chatHistory.clear();
-    ui->listWidget_chat->clear();
 }
 
 //删除会话槽函数实现
 void MainWindow::on_deleteConversation_clicked()
 {
-    int index = ui->listWidget_history->currentRow();
-    if (index >= 0 && index < conversations.size()) {
-        conversations.removeAt(index);
-        updateConversationList();
-        saveConversations();
+    qint64 id = conversationList->id(ui->listView_history->currentIndex().row());
+    if (id >= 0) {
+        // 中止这个会话正在进行的请求，回复不再写回
+        if (ChatStream* stream = activeStreams.take(id)) {
+            stream->disconnect(this);
+            stream->abort();
+            stream->deleteLater();
+        }
+        if (ChatStream* stream = hedgeStreams.take(id)) {
+            stream->disconnect(this);
+            stream->abort();
+            stream->deleteLater();
+        }
+
+        // 删除当前行后视图会选中相邻的会话，并由 on_conversationSelected 打开
+        store->removeConversation(id);
+        conversationList->removeConversation(id);
     }
 }
 
 //选择会话
-void MainWindow::on_conversationSelected(int index)
-{
-    if (index >= 0 && index < conversations.size()) {
-        currentConversationIndex = index;
-        chatHistory = conversations[index].messages;
-
-        // 清空聊天界面并加载消息
-        ui->listWidget_chat->clear();
-        for (const QJsonObject &msg : chatHistory) {
-            QString content = msg["content"].toString();
-            QString role = msg["role"].toString();
-            addMessageToChat(content, role == "user");
+void MainWindow::on_conversationSelected(const QModelIndex &index)
+{
+    qint64 id = conversationList->id(index.row());
+    if (id < 0) {
+        // 最后一个会话也删除了
+        currentConversation = -1;
+        context.clear();
+        chatModel->clear();
+        streamingRow = -1;
+        updateSendButton();
+        return;
+    }
+    // 行移动或者新建会话时选中的仍是当前会话，不重新读取
+    if (id != currentConversation) {
+        currentConversation = id;
+        historyLoaded = false;
+        context.clear();
+        chatModel->clear();
+        streamingRow = -1;
+        updateSendButton();
+
+        // 消息在 I/O 线程读取，读完后由 handleMessagesLoaded 显示；已缓存的会话会立即返回
+        store->requestMessages(id);
+    }
+}
+
+void MainWindow::handleMessagesLoaded(qint64 id, const QList<QJsonObject> &messages)
+{
+    // 第一次搜索时建立的索引
+    if (indexPending.remove(id)) {
+        for (int i = 0; i < messages.size(); ++i) {
+            searchIndex.addMessage(id, i, messages.at(i)["content"].toString());
+        }
+        if (indexPending.isEmpty()) {
+            qDebug() << "Indexed" << searchIndex.documentCount() << "messages";
+            emit searchIndexChanged();
         }
     }
+
+    if (id != currentConversationId() || historyLoaded) {
+        return;
+    }
+    historyLoaded = true;
+    context.setMessages(messages);
+    applySummary();
+
+    // 整体替换聊天模型，视图只为可见的消息排版
+    QVector<ChatModel::Message> items;
+    items.reserve(messages.size());
+    for (const QJsonObject &msg : messages) {
+        ChatModel::Message item;
+        item.id = 0;
+        item.text = msg["content"].toString();
+        item.isUser = msg["role"].toString() == "user";
+        item.model = item.isUser ? int(AvatarCache::User) : currentModel;
+        items.append(item);
+    }
+    chatModel->setMessages(items);
+    showActiveStream();
+    if (pendingJumpRow >= 0) {
+        scrollToMessage(pendingJumpRow);
+        pendingJumpRow = -1;
+    } else {
+        ui->listView_chat->scrollToBottom();
+    }
+}
+
+// 消息读不出来：不显示残缺的会话，historyLoaded 保持 false，发送按钮一直不可用
+void MainWindow::handleMessagesFailed(qint64 id)
+{
+    // 搜索索引不再等这个会话
+    if (indexPending.remove(id) && indexPending.isEmpty()) {
+        qDebug() << "Indexed" << searchIndex.documentCount() << "messages";
+        emit searchIndexChanged();
+    }
+
+    if (id != currentConversationId() || historyLoaded) {
+        return;
+    }
+    ui->statusbar->showMessage(tr("无法读取这个会话的消息"));
+    updateSendButton();
 }
 
 
 void MainWindow::createNewConversation(const QString& firstMessage)
 {
-    Conversation conv;
+    QString title;
     // 如果提供了首条消息，则使用其前10个字符作为标题
     if (!firstMessage.isEmpty()) {
-        QString title = firstMessage.left(10); // 取前10个字符
-        conv.title = title;
+        title = firstMessage.left(10); // 取前10个字符
     } else {
-        conv.title = "新会话 " + QString::number(conversations.size() + 1);
+        title = "新会话 " + QString::number(conversationList->rowCount() + 1);
     }
-
-    conversations.prepend(conv);
-
-    updateConversationList();
-
-    // 选中新创建的会话
-    currentConversationIndex = 0;
-    ui->listWidget_history->setCurrentRow(0);
-
-    chatHistory.clear();
-    ui->listWidget_chat->clear();
+    qint64 id = store->createConversation(title);
+    conversationList->addConversation(id, title);
+
+    // 选中新创建的会话；新会话没有消息，不需要读取
+    currentConversation = id;
+    historyLoaded = true;
+    selectConversationRow(0);
+
+    context.clear();
+    chatModel->clear();
+    streamingRow = -1;
+    updateSendButton();
 }
 
 
@@ -2,11 +2,23 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QNetworkAccessManager>
 #include <QJsonObject>
 #include <QTimer>
-#include <QProcessEnvironment>
-#include <QMap>
+#include <QHash>
+#include <QSet>
+#include <QModelIndex>
+#include "contextbuilder.h"
+#include "searchindex.h"
+#include "conversationstore.h"
+
+class ChatModel;
+class ChatStream;
+class MetricsLog;
+class ChatEngine;
+class RequestScheduler;
+class ConversationSummarizer;
+class ResponseCache;
+class ConversationListModel;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -23,6 +35,10 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+signals:
+    // 后台建立的搜索索引已包含全部会话
+    void searchIndexChanged();
+
 protected:
     // 事件过滤器，用于捕获特定事件（如回车键）
     bool eventFilter(QObject *obj, QEvent *event) override;
@@ -30,53 +46,70 @@ protected:
 private slots:
     // 点击发送按钮的槽函数
     void on_pushButton_send_clicked();
-    // 处理网络数据的槽函数
-    void handleReadyRead();
+    // 停止当前会话正在接收的回复
+    void on_pushButton_stop_clicked();
+    // 流式回复内容更新的槽函数
+    void handleStreamUpdated(const QString &text);
     // 网络请求完成后的槽函数
-    void handleReply();
-
-    // 模型选择槽函数
-    void selectGSLite();
-    void selectGSPro();
-    void selectGSMax();
-    void selectGSUltra();
+    void handleStreamFinished();
+
+    // 模型选择槽函数，handle 为 ModelRegistry 中的句柄
+    void selectModel(int handle);
+    // 同一个问题同时发给所有已配置的模型
+    void startFanout();
+    // 记录请求计时，并在状态栏显示本次的首字时间和速度
+    void recordStreamMetrics();
+    void showStats();
+    // 搜索聊天记录，并跳转到选中的消息
+    void showSearch();
+    void jumpToMessage(qint64 conversationId, int messageIndex);
+    // 打开或关闭摘要模式
+    void setSummaryMode(bool enabled);
 
 private:
     Ui::MainWindow *ui;
-    QNetworkAccessManager* networkManager;  // 网络管理器
-    QByteArray buffer;                      // 缓冲区用于存储流式数据
-    QString accumulatedText;                // 累积AI回复的完整内容
-    bool streamDone;                        // 标志流式传输是否结束
-    QString currentModel;                   // 当前选择的模型名称
-    QString currentPassword;                // 当前选择的模型密钥
-    QMap<QString, QString> modelPasswords;  //获取环境变量中的模型密钥
+    ChatEngine* engine;                     // 请求发送和连接复用（与命令行工具共用）
+    RequestScheduler* scheduler;            // 按模型限速、排队和自动重试
+    ConversationSummarizer* summarizer;     // 较早对话的滚动摘要（GSLite 生成）
+    QHash<qint64, ChatStream*> activeStreams; // 各会话正在进行的请求（按会话编号）
+    QHash<qint64, ChatStream*> hedgeStreams;  // 与之竞速的备用请求，先给出内容的一方留下
+    int currentModel;                       // 当前选择的模型（ModelRegistry 中的句柄）
+    MetricsLog* metricsLog;                 // 请求计时日志
+    ResponseCache* responseCache;           // 重复问题的本地回复缓存
 
     // 聊天相关
     void addMessageToChat(const QString& message, bool isUser);
-    QList<QJsonObject> chatHistory;         // 存储消息历史记录
-    bool aiMessageAdded;                    // 标志是否已添加 AI 消息项
+    ChatModel* chatModel;                   // 聊天列表的数据模型
+    ContextBuilder context;                 // 当前会话的消息历史，按 token 预算组装请求
+    int streamingRow;                       // 当前会话中正在流式显示的行，-1 表示没有
 
     // 辅助函数
     void sendApiRequest(const QString &userInput);
-    QJsonArray buildMessageArray(const QString &userInput);
-    void processData(const QByteArray &jsonData);
-    void updateChatMessage(const QString &content);
+    QByteArray buildRequestBody(const QString &userInput, int model);
+    qint64 currentConversationId() const;
+    void updateSendButton();
+    void showActiveStream();
+    void applySummary();
+    void stopStream(qint64 conversationId);
+    void startHedge(ChatStream *primary, int hedgeModel, const QByteArray &body);
+    void settleHedge(ChatStream *winner);
 
     //添加会话列表部分
     private:
-        // 会话数据结构
-        struct Conversation {
-            QString title;                     // 会话标题
-            QList<QJsonObject> messages;       // 消息列表
-        };
-
-        QList<Conversation> conversations;     // 所有会话列表
-        int currentConversationIndex;          // 当前选中的会话索引
+        ConversationListModel* conversationList; // 会话列表（按最后活动排序）
+        qint64 currentConversation;            // 当前选中的会话编号，-1 表示没有
+        ConversationStore* store;              // 会话持久化（追加写日志）
+        SearchIndex searchIndex;               // 全部消息的全文索引
+        bool searchIndexBuilt;                 // 第一次搜索时才建立索引
+        QSet<qint64> indexPending;             // 还在读取、尚未加入索引的会话
+        bool historyLoaded;                    // 当前会话的消息已经读入
+        int pendingJumpRow;                    // 消息读入后要跳转到的行，-1 表示滚到底部
 
         // 会话管理相关方法
         void loadConversations();              // 加载会话历史
-        void saveConversations();              // 保存会话历史
-        void updateConversationList();         // 更新会话列表显示
+        void selectConversationRow(int row);   // 在列表中选中一行
+        void buildSearchIndex();               // 为所有会话的消息建立索引
+        void scrollToMessage(int row);
 
 private:
         void createNewConversation(const QString& firstMessage = QString());
@@ -86,7 +119,10 @@ private:
         // 会话管理槽函数
         void on_newConversation_clicked();     // 新建会话
         void on_deleteConversation_clicked();  // 删除会话
-        void on_conversationSelected(int index); // 选择会话
+        void on_conversationSelected(const QModelIndex &index); // 选择会话
+        void handleConversationsLoaded(const QList<ConversationStore::ConversationInfo> &stored);
+        void handleMessagesLoaded(qint64 id, const QList<QJsonObject> &messages);
+        void handleMessagesFailed(qint64 id);
 };
 
 #endif // MAINWINDOW_H
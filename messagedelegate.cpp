@@ -0,0 +1,416 @@
+#include "messagedelegate.h"
+#include "chatmodel.h"
+#include "avatarcache.h"
+
+#include <QPainter>
+#include <QAbstractItemView>
+#include <QTextOption>
+#include <QFontMetrics>
+#include <cmath>
+
+namespace {
+
+const int kMargin = 5;                 // 行的外边距
+const int kAvatarSize = AvatarCache::Size; // 头像大小
+const int kSpacing = 6;                // 头像与气泡的间距
+const int kPadding = 8;                // 气泡内边距
+const int kMaxBubbleWidth = 400;       // 气泡最大宽度，避免过宽
+const int kTextWidth = kMaxBubbleWidth - 2 * kPadding;
+
+// 同时保留排版结果的消息数量，远大于一屏可见的行数
+const int kLayoutCacheSize = 256;
+
+// Markdown 块之间的间距
+const int kBlockSpacing = 6;
+
+bool isFenceLine(const QStringRef &line)
+{
+    return line.startsWith(QLatin1String("```")) || line.startsWith(QLatin1String("~~~"));
+}
+
+// 列表项的开头：-、*、+ 或数字加 . 或 )，后面跟空格
+bool isListItem(const QStringRef &line)
+{
+    if (line.size() >= 2 && (line.at(0) == QLatin1Char('-') || line.at(0) == QLatin1Char('*') || line.at(0) == QLatin1Char('+'))) {
+        return line.at(1) == QLatin1Char(' ');
+    }
+    int digits = 0;
+    while (digits < line.size() && line.at(digits).isDigit()) {
+        ++digits;
+    }
+    return digits > 0 && digits + 1 < line.size()
+        && (line.at(digits) == QLatin1Char('.') || line.at(digits) == QLatin1Char(')'))
+        && line.at(digits + 1) == QLatin1Char(' ');
+}
+
+} // namespace
+
+MessageDelegate::MessageDelegate(QObject *parent)
+    : QStyledItemDelegate(parent)
+{
+    layouts.setMaxCost(kLayoutCacheSize);
+
+    // 绘制期间不能让视图重新布局，攒到下一次事件循环一起通知
+    sizeHintTimer.setSingleShot(true);
+    sizeHintTimer.setInterval(0);
+    connect(&sizeHintTimer, &QTimer::timeout, this, &MessageDelegate::flushSizeHints);
+}
+
+// 块由空行分隔；代码块从开始标记一直到结束标记，中间的空行不算分隔。
+// 列表和引用中的空行也不分隔：分开解析会让有序列表重新从 1 编号、嵌套的列表
+// 和多段引用断开，所以要等到空行之后出现不属于它们的行，块才在这一行之前结束。
+// 只有完整的行才参与判断，最后一行可能还会被追加。
+int MessageDelegate::markdownBlockEnd(const QString &text, int pos)
+{
+    bool inFence = false;
+    bool hasContent = false;
+    bool inList = false;                   // 块中出现过列表项
+    bool inQuote = false;                  // 最后一个非空行是引用
+    bool afterBlank = false;               // 列表或引用之后遇到了空行
+    for (;;) {
+        int end = text.indexOf(QLatin1Char('\n'), pos);
+        if (end < 0) {
+            return -1;
+        }
+        const QStringRef raw = text.midRef(pos, end - pos);
+        const QStringRef line = raw.trimmed();
+        if (inFence) {
+            if (isFenceLine(line)) {
+                inFence = false;
+                if (!inList) {
+                    return end + 1;
+                }
+            }
+        } else if (line.isEmpty()) {
+            if (hasContent && !inList && !inQuote) {
+                return end + 1;
+            }
+            afterBlank = hasContent;
+        } else {
+            if (afterBlank) {
+                // 缩进的行和列表项仍属于列表，> 开头的行仍属于引用
+                const bool continues = (inList && (raw.at(0).isSpace() || isListItem(line)))
+                        || (inQuote && line.startsWith(QLatin1Char('>')));
+                if (!continues) {
+                    return pos;
+                }
+                afterBlank = false;
+            }
+            inFence = isFenceLine(line);
+            inList = inList || isListItem(line);
+            inQuote = line.startsWith(QLatin1Char('>'));
+            hasContent = true;
+        }
+        pos = end + 1;
+    }
+}
+
+void MessageDelegate::clearCache()
+{
+    layouts.clear();
+    measured.clear();
+    resized.clear();
+}
+
+void MessageDelegate::handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
+{
+    if (!roles.contains(Qt::SizeHintRole)) {
+        return;
+    }
+
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        const QModelIndex index = topLeft.sibling(row, 0);
+        const QString text = index.data(Qt::DisplayRole).toString();
+        const quint64 id = index.data(ChatModel::MessageIdRole).toULongLong();
+
+        // 没有排过版的行（不可见）只丢掉旧高度，下次布局时重新估算
+        const TextLayout *cached = layouts.object(id);
+        if (!cached) {
+            measured.remove(id);
+            emit sizeHintChanged(index);
+            continue;
+        }
+
+        // 正在显示的行（通常是流式回复）按追加的部分增量排版，绘制时直接使用
+        const QFont font = cached->font;
+        const int height = rowHeight(layoutFor(id, text, font, cached->markdown)->size.height());
+        Measured &known = measured[id];
+        const bool changed = !known.exact || known.height != height;
+        known.textLength = text.size();
+        known.height = height;
+        known.exact = true;
+        if (changed) {
+            emit sizeHintChanged(index);
+        }
+    }
+}
+
+void MessageDelegate::flushSizeHints()
+{
+    const QVector<QPersistentModelIndex> rows = resized;
+    resized.clear();
+    for (const QPersistentModelIndex &index : rows) {
+        if (index.isValid()) {
+            emit sizeHintChanged(index);
+        }
+    }
+}
+
+void MessageDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    const QString text = index.data(Qt::DisplayRole).toString();
+    const bool isUser = index.data(ChatModel::IsUserRole).toBool();
+    const quint64 id = index.data(ChatModel::MessageIdRole).toULongLong();
+
+    // 用户输入按原样显示，AI 回复按 Markdown 显示
+    const TextLayout *layout = layoutFor(id, text, option.font, !isUser);
+
+    // 估算高度与实际排版不一致：记下精确高度，下一次事件循环通知视图重新布局
+    const int exactHeight = rowHeight(layout->size.height());
+    Measured &known = measured[id];
+    if (!known.exact || known.textLength != text.size() || known.height != exactHeight) {
+        bool changed = known.height != exactHeight;
+        known.textLength = text.size();
+        known.height = exactHeight;
+        known.exact = true;
+        if (changed) {
+            resized.append(index);
+            sizeHintTimer.start();
+        }
+    }
+
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+
+    const QRect rect = option.rect.adjusted(kMargin, kMargin, -kMargin, -kMargin);
+    const QSize bubbleSize(int(std::ceil(layout->size.width())) + 2 * kPadding,
+                           int(std::ceil(layout->size.height())) + 2 * kPadding);
+
+    // 用户消息头像在右边，AI 消息头像在左边
+    QRect avatarRect;
+    QRect bubbleRect;
+    if (isUser) {
+        avatarRect = QRect(rect.right() - kAvatarSize + 1, rect.top(), kAvatarSize, kAvatarSize);
+        bubbleRect = QRect(QPoint(avatarRect.left() - kSpacing - bubbleSize.width(), rect.top()), bubbleSize);
+    } else {
+        avatarRect = QRect(rect.left(), rect.top(), kAvatarSize, kAvatarSize);
+        bubbleRect = QRect(QPoint(avatarRect.right() + 1 + kSpacing, rect.top()), bubbleSize);
+    }
+
+    // 头像按绘制设备的像素比取缓存中缩放好的版本，不再逐条解码和缩放
+    const int model = isUser ? int(AvatarCache::User) : index.data(ChatModel::AvatarRole).toInt();
+    QPixmap pixmap = AvatarCache::pixmap(model, painter->device()->devicePixelRatioF());
+    if (!pixmap.isNull()) {
+        QRect target(QPoint(0, 0), pixmap.size() / pixmap.devicePixelRatio());
+        target.moveCenter(avatarRect.center());
+        painter->drawPixmap(target, pixmap);
+    }
+
+    // 用户消息浅绿色，AI 消息浅蓝色
+    QColor bubbleColor = isUser ? QColor("#DCF8C6") : QColor("#ADD8E6");
+    if (option.state & QStyle::State_Selected) {
+        bubbleColor = bubbleColor.darker(110);
+    }
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(bubbleColor);
+    painter->drawRoundedRect(bubbleRect, 5, 5);
+
+    painter->setPen(Qt::black);
+    QPointF pos(bubbleRect.left() + kPadding, bubbleRect.top() + kPadding);
+    for (const Paragraph &paragraph : layout->paragraphs) {
+        if (paragraph.document) {
+            painter->save();
+            painter->translate(pos);
+            paragraph.document->drawContents(painter);
+            painter->restore();
+        } else if (paragraph.layout) {
+            paragraph.layout->draw(painter, pos);
+        }
+        pos.ry() += paragraph.height;
+    }
+
+    painter->restore();
+}
+
+QSize MessageDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    const QString text = index.data(Qt::DisplayRole).toString();
+    const bool isUser = index.data(ChatModel::IsUserRole).toBool();
+    const quint64 id = index.data(ChatModel::MessageIdRole).toULongLong();
+
+    QHash<quint64, Measured>::const_iterator it = measured.constFind(id);
+    if (it != measured.constEnd() && it->textLength == text.size()) {
+        return QSize(rowWidth(option), it->height);
+    }
+
+    // 已经排过版的消息（通常是正在显示的）给出精确高度，其余只做估算
+    Measured known;
+    known.textLength = text.size();
+    if (layouts.contains(id)) {
+        known.height = rowHeight(layoutFor(id, text, option.font, !isUser)->size.height());
+        known.exact = true;
+    } else {
+        known.height = estimateHeight(text, option.font);
+        known.exact = false;
+    }
+    measured.insert(id, known);
+    return QSize(rowWidth(option), known.height);
+}
+
+const MessageDelegate::TextLayout *MessageDelegate::layoutFor(quint64 id, const QString &text, const QFont &font, bool markdown) const
+{
+    TextLayout *cached = layouts.object(id);
+    if (cached && cached->font == font && cached->markdown == markdown) {
+        if (cached->text == text) {
+            return cached;
+        }
+
+        // 文本只是在末尾追加：保留已完成的段落（块），从最后一个开始重新排版
+        if (text.size() > cached->text.size() && text.startsWith(cached->text)) {
+            cached->text = text;
+            layoutFrom(cached, cached->lastParagraphStart);
+            return cached;
+        }
+    }
+
+    TextLayout *result = new TextLayout;
+    result->text = text;
+    result->font = font;
+    result->markdown = markdown;
+    result->lastParagraphStart = 0;
+    result->frozenWidth = 0;
+    result->frozenHeight = 0;
+    layoutFrom(result, 0);
+
+    layouts.insert(id, result);
+    return result;
+}
+
+// 丢弃从 start 开始的段落并重新排版，start 必须是某个段落的起点
+void MessageDelegate::layoutFrom(TextLayout *layout, int start) const
+{
+    if (start > 0 && !layout->paragraphs.isEmpty()) {
+        layout->paragraphs.removeLast();
+    } else {
+        layout->paragraphs.clear();
+        layout->frozenWidth = 0;
+        layout->frozenHeight = 0;
+    }
+
+    int pos = start;
+    for (;;) {
+        Paragraph paragraph;
+        int next;
+        if (layout->markdown) {
+            next = markdownBlockEnd(layout->text, pos);
+            paragraph = layoutMarkdown(layout->text.mid(pos, next < 0 ? -1 : next - pos), layout->font);
+        } else {
+            int end = layout->text.indexOf(QLatin1Char('\n'), pos);
+            next = end < 0 ? -1 : end + 1;
+            paragraph = layoutParagraph(layout->text.mid(pos, end < 0 ? -1 : end - pos), layout->font);
+        }
+        if (next < 0) {
+            layout->paragraphs.append(paragraph);
+            layout->lastParagraphStart = pos;
+            break;
+        }
+
+        // 遇到换行（或块结束）说明这个段落已经完成，之后不会再变
+        if (layout->markdown) {
+            paragraph.height += kBlockSpacing;
+        }
+        layout->paragraphs.append(paragraph);
+        layout->frozenWidth = qMax(layout->frozenWidth, paragraph.width);
+        layout->frozenHeight += paragraph.height;
+        pos = next;
+    }
+
+    const Paragraph &last = layout->paragraphs.last();
+    qreal height = layout->frozenHeight + last.height;
+    if (layout->markdown && !last.document && layout->frozenHeight > 0) {
+        height -= kBlockSpacing; // 末尾还没有新块时不留间距
+    }
+    layout->size = QSizeF(qMax(layout->frozenWidth, last.width), height);
+}
+
+MessageDelegate::Paragraph MessageDelegate::layoutParagraph(const QString &text, const QFont &font) const
+{
+    Paragraph paragraph;
+    paragraph.layout = QSharedPointer<QTextLayout>(new QTextLayout(text, font));
+    paragraph.width = 0;
+    paragraph.height = 0;
+
+    QTextOption textOption;
+    textOption.setWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
+    paragraph.layout->setTextOption(textOption);
+
+    paragraph.layout->beginLayout();
+    for (;;) {
+        QTextLine line = paragraph.layout->createLine();
+        if (!line.isValid()) {
+            break;
+        }
+        line.setLineWidth(kTextWidth);
+        line.setPosition(QPointF(0, paragraph.height));
+        paragraph.height += line.height();
+        paragraph.width = qMax(paragraph.width, line.naturalTextWidth());
+    }
+    paragraph.layout->endLayout();
+
+    return paragraph;
+}
+
+// 一个 Markdown 块单独解析成一个文档，空白的块不占位置
+MessageDelegate::Paragraph MessageDelegate::layoutMarkdown(const QString &text, const QFont &font) const
+{
+    Paragraph paragraph;
+    paragraph.width = 0;
+    paragraph.height = 0;
+    if (text.trimmed().isEmpty()) {
+        return paragraph;
+    }
+
+    paragraph.document = QSharedPointer<QTextDocument>(new QTextDocument);
+    paragraph.document->setDefaultFont(font);
+    paragraph.document->setDocumentMargin(0);
+    paragraph.document->setTextWidth(kTextWidth);
+    paragraph.document->setMarkdown(text);
+    paragraph.width = qMin(paragraph.document->idealWidth(), qreal(kTextWidth));
+    paragraph.height = paragraph.document->size().height();
+    return paragraph;
+}
+
+// 按字符宽度粗略估算行数，不做真正的排版
+int MessageDelegate::estimateHeight(const QString &text, const QFont &font) const
+{
+    QFontMetrics metrics(font);
+    const qreal narrowWidth = metrics.averageCharWidth();
+    const qreal wideWidth = metrics.height(); // 中文等宽字符大致是方形
+
+    int lines = 0;
+    qreal lineWidth = 0;
+    for (const QChar ch : text) {
+        if (ch == QLatin1Char('\n')) {
+            lines += qMax(1, int(std::ceil(lineWidth / kTextWidth)));
+            lineWidth = 0;
+            continue;
+        }
+        lineWidth += ch.unicode() < 0x2E80 ? narrowWidth : wideWidth;
+    }
+    lines += qMax(1, int(std::ceil(lineWidth / kTextWidth)));
+
+    return rowHeight(lines * metrics.lineSpacing());
+}
+
+int MessageDelegate::rowHeight(qreal textHeight) const
+{
+    return qMax(kAvatarSize, int(std::ceil(textHeight)) + 2 * kPadding) + 2 * kMargin;
+}
+
+int MessageDelegate::rowWidth(const QStyleOptionViewItem &option) const
+{
+    if (const QAbstractItemView *view = qobject_cast<const QAbstractItemView *>(parent())) {
+        return view->viewport()->width();
+    }
+    return option.rect.width();
+}
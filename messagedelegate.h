@@ -0,0 +1,90 @@
+#ifndef MESSAGEDELEGATE_H
+#define MESSAGEDELEGATE_H
+
+#include <QStyledItemDelegate>
+#include <QTextLayout>
+#include <QTextDocument>
+#include <QSharedPointer>
+#include <QPersistentModelIndex>
+#include <QTimer>
+#include <QCache>
+#include <QHash>
+#include <QVector>
+
+/**
+ * @brief 消息气泡绘制委托，用于显示用户和AI的消息
+ *
+ * 只有可见的行才会真正排版和绘制，排版结果按消息编号缓存。
+ * 不可见的行用字符数估算高度，第一次绘制时再换成精确高度，在下一次事件循环
+ * 通知视图重新布局。流式回复只在末尾追加文本，模型以 Qt::SizeHintRole 发出
+ * dataChanged() 时就只重新排版最后一个段落及新增部分，高度变了才通知视图，
+ * 绘制时直接使用排好的结果。
+ *
+ * AI 的回复按 Markdown 显示：文本按块（空行或代码块结束处）切开，每块单独
+ * 解析成一个 QTextDocument；列表和引用连同其中的空行留在同一块里。已经结束的块不会再变，只有末尾还没结束的块在
+ * 追加文本时重新解析，所以每次追加的开销与回复的总长度无关。
+ */
+class MessageDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+public:
+    explicit MessageDelegate(QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+    // 从 pos 开始的 Markdown 块在哪里结束（返回下一块的起点），块还没结束时返回 -1
+    static int markdownBlockEnd(const QString &text, int pos);
+
+public slots:
+    // 丢弃所有消息的排版和高度，模型重置后调用
+    void clearCache();
+    // 连接模型的 dataChanged()：roles 含 Qt::SizeHintRole 的行立即重新测量
+    void handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles);
+
+private slots:
+    void flushSizeHints();
+
+private:
+    // 一个段落（纯文本以换行分隔，Markdown 以块分隔）的排版结果
+    struct Paragraph {
+        QSharedPointer<QTextLayout> layout;      // 纯文本
+        QSharedPointer<QTextDocument> document;  // Markdown 块
+        qreal width;
+        qreal height;
+    };
+
+    // 一条消息的排版缓存
+    struct TextLayout {
+        QString text;
+        QFont font;
+        bool markdown;
+        QVector<Paragraph> paragraphs;
+        QSizeF size;
+        int lastParagraphStart;            // 最后一个段落在 text 中的起点
+        qreal frozenWidth;                 // 除最后一个段落外的最大宽度
+        qreal frozenHeight;                // 除最后一个段落外的总高度
+    };
+
+    // 已知的行高，textLength 用于判断文本是否已经变化
+    struct Measured {
+        int textLength;
+        int height;
+        bool exact;
+    };
+
+    const TextLayout *layoutFor(quint64 id, const QString &text, const QFont &font, bool markdown) const;
+    void layoutFrom(TextLayout *layout, int start) const;
+    Paragraph layoutParagraph(const QString &text, const QFont &font) const;
+    Paragraph layoutMarkdown(const QString &text, const QFont &font) const;
+    int estimateHeight(const QString &text, const QFont &font) const;
+    int rowHeight(qreal textHeight) const;
+    int rowWidth(const QStyleOptionViewItem &option) const;
+
+    mutable QCache<quint64, TextLayout> layouts; // 可见消息的排版缓存
+    mutable QHash<quint64, Measured> measured;   // 每条消息最近一次报告的高度
+    mutable QVector<QPersistentModelIndex> resized; // 绘制时发现估算高度不准的行
+    mutable QTimer sizeHintTimer;
+};
+
+#endif // MESSAGEDELEGATE_H
@@ -0,0 +1,16 @@
+# 本地的 chat/completions 模拟服务，用于在不访问正式接口的情况下测试和比较性能
+
+QT       += core network
+QT       -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = gsai-mock
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(mock.pri)
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,70 @@
+#include "mockserver.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("gsai-mock");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QString::fromUtf8("本地的 chat/completions 模拟服务，以 SSE 流式返回录制或生成的回复。\n"
+                                                       "配合 gsai-cli --endpoint 或环境变量 GSAI_API_URL 使用。"));
+    parser.addHelpOption();
+    parser.addPositionalArgument("recordings", QString::fromUtf8("录制的 SSE 文件（例如 response_cache/*.sse），省略时生成回复"), "[recordings...]");
+
+    MockServer::Options defaults;
+    QCommandLineOption portOption(QStringList() << "p" << "port", QString::fromUtf8("监听端口，0 表示随机"), "port", QString::number(defaults.port));
+    QCommandLineOption rateOption("tokens-per-second", QString::fromUtf8("每秒发送的事件数，0 表示不限速"), "n", QString::number(defaults.tokensPerSecond));
+    QCommandLineOption firstTokenOption("first-token-ms", QString::fromUtf8("收到请求到第一个事件的延迟"), "ms", QString::number(defaults.firstTokenMs));
+    QCommandLineOption jitterOption("jitter-ms", QString::fromUtf8("事件间隔随机增减的最大毫秒数"), "ms", "0");
+    QCommandLineOption chunkOption("chunk-bytes", QString::fromUtf8("每次写入的最大字节数，0 表示一个事件写一次"), "n", "0");
+    QCommandLineOption replyOption("reply-chars", QString::fromUtf8("生成回复的字数"), "n", QString::number(defaults.replyChars));
+    QCommandLineOption deltaOption("delta-chars", QString::fromUtf8("生成回复每个事件的字数"), "n", QString::number(defaults.deltaChars));
+    QCommandLineOption malformedOption("malformed-rate", QString::fromUtf8("每个事件之前插入错误数据行的概率"), "p", "0");
+    QCommandLineOption dropOption("drop-rate", QString::fromUtf8("每个事件之前断开连接的概率"), "p", "0");
+    QCommandLineOption limitOption("rate-limit-rate", QString::fromUtf8("直接返回 429 的概率"), "p", "0");
+    QCommandLineOption serverErrorOption("server-error-rate", QString::fromUtf8("直接返回 503 的概率"), "p", "0");
+    QCommandLineOption retryAfterOption("retry-after", QString::fromUtf8("429 响应的 Retry-After 秒数，0 表示不带"), "s", QString::number(defaults.retryAfterSeconds));
+    QCommandLineOption gzipOption("reject-gzip", QString::fromUtf8("以 415 拒绝 gzip 压缩的请求体"));
+    QCommandLineOption requestsOption(QStringList() << "n" << "requests", QString::fromUtf8("处理这么多请求后退出，0 表示一直运行"), "n", "0");
+    QCommandLineOption reportOption(QStringList() << "o" << "report", QString::fromUtf8("报告文件（JSON），每个请求之后更新"), "file");
+    QCommandLineOption seedOption("seed", QString::fromUtf8("随机数种子，固定后注入的错误可以复现"), "n", "0");
+    parser.addOptions(QList<QCommandLineOption>() << portOption << rateOption << firstTokenOption << jitterOption
+                      << chunkOption << replyOption << deltaOption << malformedOption << dropOption << limitOption
+                      << serverErrorOption << retryAfterOption << gzipOption << requestsOption << reportOption << seedOption);
+    parser.process(app);
+
+    MockServer::Options options;
+    options.recordings = parser.positionalArguments();
+    options.port = quint16(parser.value(portOption).toUInt());
+    options.tokensPerSecond = parser.value(rateOption).toDouble();
+    options.firstTokenMs = parser.value(firstTokenOption).toInt();
+    options.jitterMs = parser.value(jitterOption).toInt();
+    options.chunkBytes = parser.value(chunkOption).toInt();
+    options.replyChars = parser.value(replyOption).toInt();
+    options.deltaChars = parser.value(deltaOption).toInt();
+    options.malformedRate = parser.value(malformedOption).toDouble();
+    options.dropRate = parser.value(dropOption).toDouble();
+    options.rateLimitRate = parser.value(limitOption).toDouble();
+    options.serverErrorRate = parser.value(serverErrorOption).toDouble();
+    options.retryAfterSeconds = parser.value(retryAfterOption).toInt();
+    options.rejectGzip = parser.isSet(gzipOption);
+    options.maxRequests = parser.value(requestsOption).toInt();
+    options.reportPath = parser.value(reportOption);
+    options.seed = parser.value(seedOption).toUInt();
+    if (options.tokensPerSecond < 0 || options.firstTokenMs < 0 || options.chunkBytes < 0 || options.replyChars < 1
+        || options.retryAfterSeconds < 0) {
+        parser.showHelp(2);
+    }
+
+    MockServer server(options);
+    QObject::connect(&server, &MockServer::finished, &app, &QCoreApplication::quit);
+    if (!server.start()) {
+        return 2;
+    }
+    qDebug().noquote() << "Listening on" << QString("http://127.0.0.1:%1/v1/chat/completions").arg(server.port());
+    return app.exec();
+}
@@ -0,0 +1,12 @@
+# 模拟服务：gsai-mock 命令行工具和 tests/ 下的测试共用
+
+QT += network
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += \
+    $$PWD/mockserver.cpp
+
+HEADERS += \
+    $$PWD/mockserver.h
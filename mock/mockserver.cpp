@@ -0,0 +1,455 @@
+#include "mockserver.h"
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QFile>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+
+namespace {
+
+// 生成回复时重复使用的文本
+const char *const kSampleText = "浙江工商大学坐落于杭州，是一所以经济学、管理学、法学为主，"
+                                "文学、工学、理学等多学科协调发展的高校。";
+
+// 注入的错误数据：截断的 JSON、不是 JSON 的数据和不认识的字段
+const char *const kMalformedLines[] = {
+    "data: {\"code\":0,\"choices\":[{\"delta\":{\"content\":\"\\u4e\n\n",
+    "data: not json\n\n",
+    "garbage line without field\n\n",
+};
+
+QByteArray eventFor(const QJsonObject &object)
+{
+    return "data: " + QJsonDocument(object).toJson(QJsonDocument::Compact) + "\n\n";
+}
+
+} // namespace
+
+MockServer::MockServer(const Options &options, QObject *parent)
+    : QObject(parent)
+    , options(options)
+    , server(new QTcpServer(this))
+    , nextRecording(0)
+    , random(options.seed ? options.seed : QRandomGenerator::global()->generate())
+    , requestCount(0)
+    , totalBytesIn(0)
+    , totalBytesOut(0)
+    , droppedCount(0)
+    , malformedCount(0)
+    , rateLimitedCount(0)
+    , serverErrorCount(0)
+    , gzipCount(0)
+    , rejectedCount(0)
+{
+    connect(server, &QTcpServer::newConnection, this, &MockServer::handleNewConnection);
+}
+
+bool MockServer::start()
+{
+    // 录制文件按空行拆成事件，发送时一个事件一个事件地按节奏发出
+    for (const QString &path : options.recordings) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "Cannot open recording" << path << file.errorString();
+            return false;
+        }
+        QByteArray data = file.readAll().replace("\r\n", "\n");
+        QList<QByteArray> events;
+        int offset = 0;
+        while (offset < data.size()) {
+            int end = data.indexOf("\n\n", offset);
+            if (end < 0) {
+                end = data.size();
+            }
+            QByteArray event = data.mid(offset, end - offset).trimmed();
+            if (!event.isEmpty()) {
+                events.append(event + "\n\n");
+            }
+            offset = end + 2;
+        }
+        if (events.isEmpty()) {
+            qWarning() << "Recording" << path << "contains no events";
+            return false;
+        }
+        recorded.append(events);
+    }
+    if (recorded.isEmpty()) {
+        recorded.append(generateReply(options.replyChars, options.deltaChars));
+    }
+
+    if (!server->listen(QHostAddress::LocalHost, options.port)) {
+        qWarning() << "Cannot listen on port" << options.port << server->errorString();
+        return false;
+    }
+    uptime.start();
+    writeReport();
+    return true;
+}
+
+quint16 MockServer::port() const
+{
+    return server->serverPort();
+}
+
+void MockServer::handleNewConnection()
+{
+    while (QTcpSocket *socket = server->nextPendingConnection()) {
+        // 小块写入要马上发出去，才能模拟逐字到达的回复
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        connections.insert(socket, Connection());
+        connect(socket, &QTcpSocket::readyRead, this, &MockServer::handleReadyRead);
+        connect(socket, &QTcpSocket::disconnected, this, &MockServer::handleDisconnected);
+    }
+}
+
+void MockServer::handleReadyRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (!socket || !connections.contains(socket)) {
+        return;
+    }
+    connections[socket].buffer += socket->readAll();
+    processBuffer(socket);
+}
+
+void MockServer::handleDisconnected()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (!socket) {
+        return;
+    }
+    QHash<QTcpSocket *, Connection>::iterator it = connections.find(socket);
+    if (it != connections.end()) {
+        // 客户端在回复结束前断开（例如用户停止），这个请求也记进报告
+        if (it->streaming) {
+            finishRequest(*it);
+        }
+        connections.erase(it);
+    }
+    socket->deleteLater();
+}
+
+// 同一个连接上的请求依次处理，上一个回复发完才处理下一个
+void MockServer::processBuffer(QTcpSocket *socket)
+{
+    QHash<QTcpSocket *, Connection>::iterator it = connections.find(socket);
+    while (it != connections.end() && !it->streaming && parseRequest(socket, *it)) {
+        it = connections.find(socket);
+    }
+}
+
+bool MockServer::parseRequest(QTcpSocket *socket, Connection &connection)
+{
+    const int headerEnd = connection.buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        return false;
+    }
+
+    const QList<QByteArray> lines = connection.buffer.left(headerEnd).split('\n');
+    const QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');
+    QHash<QByteArray, QByteArray> headers;
+    for (int i = 1; i < lines.size(); ++i) {
+        const int colon = lines[i].indexOf(':');
+        if (colon > 0) {
+            headers.insert(lines[i].left(colon).trimmed().toLower(), lines[i].mid(colon + 1).trimmed());
+        }
+    }
+
+    const int length = headers.value("content-length").toInt();
+    const int total = headerEnd + 4 + length;
+    if (connection.buffer.size() < total) {
+        return false; // 请求体还没收完
+    }
+    const QByteArray body = connection.buffer.mid(headerEnd + 4, length);
+    connection.buffer.remove(0, total);
+
+    connection.requestId = ++requestCount;
+    connection.receivedMs = uptime.elapsed();
+    connection.bytesIn = total;
+    connection.timer.start();
+    totalBytesIn += total;
+    if (!headers.value("content-encoding").toLower().contains("gzip")) {
+        const QJsonObject request = QJsonDocument::fromJson(body).object();
+        const QJsonArray messages = request.value("messages").toArray();
+        connection.model = request.value("model").toString();
+        connection.prompt = messages.isEmpty() ? QString() : messages.last().toObject().value("content").toString();
+    }
+
+    if (requestLine.value(0) != "POST") {
+        sendError(socket, connection, 405, "Method Not Allowed");
+    } else if (!requestLine.value(1).endsWith("/chat/completions")) {
+        sendError(socket, connection, 404, "Not Found");
+    } else {
+        respond(socket, connection, headers, body);
+    }
+    return true;
+}
+
+void MockServer::respond(QTcpSocket *socket, Connection &connection, const QHash<QByteArray, QByteArray> &headers, const QByteArray &body)
+{
+    if (headers.value("content-encoding").toLower() == "gzip") {
+        connection.gzip = true;
+        ++gzipCount;
+        if (options.rejectGzip) {
+            ++rejectedCount;
+            sendError(socket, connection, 415, "Unsupported Media Type");
+            return;
+        }
+        if (!body.startsWith("\x1f\x8b")) {
+            sendError(socket, connection, 400, "Bad Request");
+            return;
+        }
+    }
+
+    const Fault fault = scriptedFaults.isEmpty() ? NoFault : scriptedFaults.takeFirst();
+    if (fault == RateLimit
+        || (fault == NoFault && options.rateLimitRate > 0 && random.generateDouble() < options.rateLimitRate)) {
+        ++rateLimitedCount;
+        const QByteArray retryAfter = options.retryAfterSeconds > 0
+            ? "Retry-After: " + QByteArray::number(options.retryAfterSeconds) + "\r\n" : QByteArray();
+        sendError(socket, connection, 429, "Too Many Requests", retryAfter);
+        return;
+    }
+    if (fault == ServerError
+        || (fault == NoFault && options.serverErrorRate > 0 && random.generateDouble() < options.serverErrorRate)) {
+        ++serverErrorCount;
+        sendError(socket, connection, 503, "Service Unavailable");
+        return;
+    }
+
+    // 先发响应头，首字延迟之后再开始发事件
+    connection.status = 200;
+    connection.streaming = true;
+    connection.events = nextReply();
+    connection.nextEvent = 0;
+    connection.dropAt = fault == Drop ? connection.events.size() / 2 : -1;
+    QByteArray head = "HTTP/1.1 200 OK\r\n"
+                      "Content-Type: text/event-stream\r\n"
+                      "Cache-Control: no-cache\r\n"
+                      "Transfer-Encoding: chunked\r\n\r\n";
+    totalBytesOut += socket->write(head);
+    socket->flush();
+
+    QTimer::singleShot(options.firstTokenMs, socket, [this, socket]() {
+        sendNextEvent(socket);
+    });
+}
+
+void MockServer::sendError(QTcpSocket *socket, Connection &connection, int status, const QByteArray &reason, const QByteArray &extraHeaders)
+{
+    QJsonObject error;
+    error["code"] = status;
+    error["message"] = QString::fromLatin1(reason);
+    const QByteArray body = QJsonDocument(error).toJson(QJsonDocument::Compact);
+
+    QByteArray response = "HTTP/1.1 " + QByteArray::number(status) + ' ' + reason + "\r\n"
+                          "Content-Type: application/json\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                          + extraHeaders + "\r\n" + body;
+    totalBytesOut += socket->write(response);
+    connection.status = status;
+    finishRequest(connection);
+}
+
+void MockServer::sendNextEvent(QTcpSocket *socket)
+{
+    QHash<QTcpSocket *, Connection>::iterator it = connections.find(socket);
+    if (it == connections.end() || !it->streaming) {
+        return;
+    }
+    Connection &connection = *it;
+
+    if (connection.nextEvent >= connection.events.size()) {
+        totalBytesOut += socket->write("0\r\n\r\n"); // 分块传输的结尾
+        finishRequest(connection);
+        processBuffer(socket);
+        return;
+    }
+
+    // 中途断开：已经发出的内容保留，客户端收到连接被关闭的错误
+    if (connection.nextEvent == connection.dropAt
+        || (options.dropRate > 0 && random.generateDouble() < options.dropRate)) {
+        connection.dropped = true;
+        ++droppedCount;
+        finishRequest(connection);
+        socket->abort(); // 同步发出 disconnected()，之后不能再用 connection
+        return;
+    }
+
+    if (options.malformedRate > 0 && random.generateDouble() < options.malformedRate) {
+        const int count = int(sizeof(kMalformedLines) / sizeof(kMalformedLines[0]));
+        writeChunked(socket, kMalformedLines[random.bounded(count)]);
+        ++connection.malformed;
+        ++malformedCount;
+    }
+
+    writeChunked(socket, connection.events[connection.nextEvent++]);
+    QTimer::singleShot(nextDelay(), socket, [this, socket]() {
+        sendNextEvent(socket);
+    });
+}
+
+// 按 chunkBytes 拆开写入，每一块立即发出，客户端会在任意位置收到半个事件
+void MockServer::writeChunked(QTcpSocket *socket, const QByteArray &data)
+{
+    const int step = options.chunkBytes > 0 ? options.chunkBytes : data.size();
+    for (int offset = 0; offset < data.size(); offset += step) {
+        const QByteArray piece = data.mid(offset, step);
+        QByteArray chunk = QByteArray::number(piece.size(), 16) + "\r\n" + piece + "\r\n";
+        totalBytesOut += socket->write(chunk);
+        socket->flush();
+    }
+}
+
+void MockServer::finishRequest(Connection &connection)
+{
+    QJsonObject entry;
+    entry["id"] = connection.requestId;
+    entry["receivedMs"] = connection.receivedMs;
+    entry["model"] = connection.model;
+    entry["prompt"] = connection.prompt;
+    entry["status"] = connection.status;
+    entry["gzip"] = connection.gzip;
+    entry["bytesIn"] = connection.bytesIn;
+    entry["events"] = connection.nextEvent;
+    entry["totalEvents"] = connection.events.size();
+    entry["malformed"] = connection.malformed;
+    entry["dropped"] = connection.dropped;
+    entry["durationMs"] = connection.timer.elapsed();
+    requests.append(entry);
+
+    connection.streaming = false;
+    connection.model.clear();
+    connection.prompt.clear();
+    connection.events.clear();
+    connection.nextEvent = 0;
+    connection.dropAt = -1;
+    connection.malformed = 0;
+    connection.dropped = false;
+    connection.gzip = false;
+    connection.status = 0;
+
+    writeReport();
+    emit requestFinished(entry);
+    if (options.maxRequests > 0 && requests.size() >= options.maxRequests) {
+        emit finished();
+    }
+}
+
+QList<QByteArray> MockServer::nextReply()
+{
+    const QList<QByteArray> &reply = recorded[nextRecording];
+    nextRecording = (nextRecording + 1) % recorded.size();
+    return reply;
+}
+
+QString MockServer::generatedText(int replyChars)
+{
+    const QString sample = QString::fromUtf8(kSampleText);
+    QString text;
+    while (text.size() < replyChars) {
+        text += sample;
+    }
+    text.truncate(replyChars);
+    return text;
+}
+
+// 与正式接口相同的格式：每个事件一段增量，最后一个事件带 usage，然后是 [DONE]
+QList<QByteArray> MockServer::generateReply(int replyChars, int deltaChars)
+{
+    const QString text = generatedText(replyChars);
+
+    QJsonObject base;
+    base["code"] = 0;
+    base["message"] = "Success";
+    base["sid"] = "mock";
+    base["id"] = "mock";
+    base["created"] = QDateTime::currentSecsSinceEpoch();
+
+    QList<QByteArray> events;
+    const int step = qMax(1, deltaChars);
+    for (int offset = 0; offset < text.size(); offset += step) {
+        QJsonObject delta;
+        delta["role"] = "assistant";
+        delta["content"] = text.mid(offset, step);
+        QJsonObject choice;
+        choice["delta"] = delta;
+        choice["index"] = 0;
+        QJsonObject event = base;
+        event["choices"] = QJsonArray() << choice;
+        events.append(eventFor(event));
+    }
+
+    QJsonObject delta;
+    delta["role"] = "assistant";
+    delta["content"] = "";
+    QJsonObject choice;
+    choice["delta"] = delta;
+    choice["index"] = 0;
+    choice["finish_reason"] = "stop";
+    QJsonObject usage;
+    usage["prompt_tokens"] = 100;
+    usage["completion_tokens"] = text.size();
+    usage["total_tokens"] = 100 + text.size();
+    QJsonObject last = base;
+    last["choices"] = QJsonArray() << choice;
+    last["usage"] = usage;
+    events.append(eventFor(last));
+    events.append("data: [DONE]\n\n");
+    return events;
+}
+
+int MockServer::nextDelay()
+{
+    int delay = options.tokensPerSecond > 0 ? qRound(1000.0 / options.tokensPerSecond) : 0;
+    if (options.jitterMs > 0) {
+        delay += random.bounded(2 * options.jitterMs + 1) - options.jitterMs;
+    }
+    return qMax(0, delay);
+}
+
+void MockServer::writeReport()
+{
+    if (options.reportPath.isEmpty()) {
+        return;
+    }
+
+    QJsonObject settings;
+    settings["tokensPerSecond"] = options.tokensPerSecond;
+    settings["firstTokenMs"] = options.firstTokenMs;
+    settings["jitterMs"] = options.jitterMs;
+    settings["chunkBytes"] = options.chunkBytes;
+    settings["malformedRate"] = options.malformedRate;
+    settings["dropRate"] = options.dropRate;
+    settings["rateLimitRate"] = options.rateLimitRate;
+    settings["serverErrorRate"] = options.serverErrorRate;
+    settings["retryAfterSeconds"] = options.retryAfterSeconds;
+    settings["rejectGzip"] = options.rejectGzip;
+    settings["recordings"] = QJsonArray::fromStringList(options.recordings);
+
+    QJsonObject report;
+    report["port"] = port();
+    report["settings"] = settings;
+    report["uptimeMs"] = uptime.elapsed();
+    report["requests"] = requests.size();
+    report["bytesIn"] = totalBytesIn;
+    report["bytesOut"] = totalBytesOut;
+    report["dropped"] = droppedCount;
+    report["malformed"] = malformedCount;
+    report["rateLimited"] = rateLimitedCount;
+    report["serverErrors"] = serverErrorCount;
+    report["gzipRequests"] = gzipCount;
+    report["gzipRejected"] = rejectedCount;
+    report["requestLog"] = requests;
+
+    // 每个请求之后整体重写，服务被直接结束时报告也是完整的
+    QSaveFile file(options.reportPath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(report).toJson()) < 0 || !file.commit()) {
+        qWarning() << "Failed to write report" << options.reportPath << file.errorString();
+    }
+}
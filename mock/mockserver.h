@@ -0,0 +1,147 @@
+#ifndef MOCKSERVER_H
+#define MOCKSERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QStringList>
+#include <QJsonArray>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+
+class QTcpServer;
+class QTcpSocket;
+
+/**
+ * @brief 本地的 chat/completions 模拟服务
+ *
+ * 在本机端口上接受 POST 请求，以 SSE 流式返回回复：可以重放录制下来的回复
+ * （ResponseCache 中的 .sse 文件或 curl -N 保存的输出），没有录制时生成固定
+ * 格式的回复。发送节奏、每次写入的字节数和抖动都可以设置，并可以按概率
+ * 注入格式错误的数据行、中途断开连接、429 限流和 503 错误，用来在不访问
+ * 正式接口的情况下检查解析、重试和计时。测试还可以用 scriptFaults() 指定
+ * 接下来几个请求各自遇到的错误。
+ *
+ * 响应使用 HTTP/1.1 分块传输，连接可以复用。每个请求结束后把统计写入报告
+ * 文件（JSON），可以与 gsai-cli 的结果一起比较不同版本的表现。
+ *
+ * 既是 gsai-mock 命令行工具，也由 tests/ 下的测试直接在进程内启动（mock.pri）。
+ */
+class MockServer : public QObject
+{
+    Q_OBJECT
+public:
+    // 指定给某个请求的错误
+    enum Fault {
+        NoFault,                           // 照常回复（仍按概率注入错误）
+        RateLimit,                         // 返回 429
+        ServerError,                       // 返回 503
+        Drop                               // 发出一半事件后断开连接
+    };
+
+    struct Options {
+        Options() : port(8765), tokensPerSecond(50), firstTokenMs(200), jitterMs(0), chunkBytes(0),
+            replyChars(400), deltaChars(2), malformedRate(0), dropRate(0), rateLimitRate(0),
+            serverErrorRate(0), retryAfterSeconds(1), rejectGzip(false), maxRequests(0), seed(0) {}
+        quint16 port;                      // 0 表示随机端口
+        QStringList recordings;            // 录制的 SSE 文件，依次轮流重放
+        double tokensPerSecond;            // 每秒发送的事件数，0 表示不限速
+        int firstTokenMs;                  // 收到请求到第一个事件的延迟
+        int jitterMs;                      // 每个事件间隔随机增减的最大毫秒数
+        int chunkBytes;                    // 每次写入的最大字节数，0 表示一个事件写一次
+        int replyChars;                    // 生成回复的字数（没有录制时）
+        int deltaChars;                    // 生成回复每个事件的字数
+        double malformedRate;              // 每个事件之前插入错误数据行的概率
+        double dropRate;                   // 每个事件之前断开连接的概率
+        double rateLimitRate;              // 直接返回 429 的概率
+        double serverErrorRate;            // 直接返回 503 的概率
+        int retryAfterSeconds;             // 429 响应的 Retry-After，0 表示不带
+        bool rejectGzip;                   // 以 415 拒绝 gzip 压缩的请求体
+        int maxRequests;                   // 处理这么多请求后退出，0 表示一直运行
+        QString reportPath;                // 报告文件，为空时不写
+        quint32 seed;                      // 随机数种子，0 表示随机
+    };
+
+    explicit MockServer(const Options &options, QObject *parent = nullptr);
+
+    // 读取录制文件并开始监听，失败时返回 false
+    bool start();
+    quint16 port() const;
+    // 之后的请求按到达顺序依次使用这些错误，用完后恢复按概率注入；
+    // 被 415 拒绝的请求不占用
+    void scriptFaults(const QList<Fault> &faults) { scriptedFaults += faults; }
+    // 已处理完的请求，与报告中的 requestLog 相同，按结束的先后排列
+    const QJsonArray &requestLog() const { return requests; }
+
+    // 与正式接口格式相同的回复：replyChars 个字，每个事件 deltaChars 个字，
+    // 最后一个事件带 usage，然后是 [DONE]
+    static QList<QByteArray> generateReply(int replyChars, int deltaChars);
+    // generateReply() 回复的完整文本
+    static QString generatedText(int replyChars);
+
+signals:
+    // 一个请求处理完（回复发完、返回错误或连接断开），entry 为它在报告中的记录
+    void requestFinished(const QJsonObject &entry);
+    // 达到 maxRequests
+    void finished();
+
+private slots:
+    void handleNewConnection();
+    void handleReadyRead();
+    void handleDisconnected();
+
+private:
+    // 一个连接上正在处理的请求和回复
+    struct Connection {
+        Connection() : requestId(0), receivedMs(0), streaming(false), nextEvent(0), dropAt(-1), malformed(0), dropped(false), gzip(false), bytesIn(0), status(0) {}
+        QByteArray buffer;                 // 未处理的请求数据
+        qint64 requestId;
+        qint64 receivedMs;                 // 收到请求时服务已运行的毫秒数
+        QString model;                     // 请求体中的模型名，压缩的请求体不解析
+        QString prompt;                    // 请求中最后一条消息的内容，同样不解析压缩的请求体
+        bool streaming;                    // 正在发送回复，之后的请求等它结束
+        QList<QByteArray> events;
+        int nextEvent;
+        int dropAt;                        // 发到第几个事件时断开，-1 表示不断开
+        int malformed;
+        bool dropped;
+        bool gzip;
+        qint64 bytesIn;
+        int status;
+        QElapsedTimer timer;
+    };
+
+    void processBuffer(QTcpSocket *socket);
+    bool parseRequest(QTcpSocket *socket, Connection &connection);
+    void respond(QTcpSocket *socket, Connection &connection, const QHash<QByteArray, QByteArray> &headers, const QByteArray &body);
+    void sendError(QTcpSocket *socket, Connection &connection, int status, const QByteArray &reason, const QByteArray &extraHeaders = QByteArray());
+    void sendNextEvent(QTcpSocket *socket);
+    void writeChunked(QTcpSocket *socket, const QByteArray &data);
+    void finishRequest(Connection &connection);
+    QList<QByteArray> nextReply();
+    int nextDelay();
+    void writeReport();
+
+    Options options;
+    QTcpServer *server;
+    QHash<QTcpSocket *, Connection> connections;
+    QList<QList<QByteArray> > recorded;    // 每个录制文件拆成的事件
+    int nextRecording;
+    QRandomGenerator random;
+    QList<Fault> scriptedFaults;
+
+    // 报告
+    QElapsedTimer uptime;
+    QJsonArray requests;
+    qint64 requestCount;
+    qint64 totalBytesIn;
+    qint64 totalBytesOut;
+    int droppedCount;
+    int malformedCount;
+    int rateLimitedCount;
+    int serverErrorCount;
+    int gzipCount;
+    int rejectedCount;
+};
+
+#endif // MOCKSERVER_H
@@ -0,0 +1,157 @@
+#include "modelregistry.h"
+#include "contextbuilder.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QProcessEnvironment>
+#include <QDebug>
+
+namespace {
+
+// 配置文件中没有写上下文长度时使用
+const int kDefaultContextTokens = 8192;
+
+// 内置配置，格式与 models.json 相同
+const char *const kBuiltinConfig = R"({
+    "default": "4.0Ultra",
+    "summaryModel": "general",
+    "models": [
+        { "id": "general", "name": "GSLite", "keyVariable": "GSLITE_PASSWORD",
+          "icon": ":/images/GSLite.png", "contextTokens": 4096 },
+        { "id": "generalv3", "name": "GSPro", "keyVariable": "GSPRO_PASSWORD",
+          "icon": ":/images/GSPro.jpg", "contextTokens": 8192 },
+        { "id": "generalv3.5", "name": "GSMax", "keyVariable": "GSMAX_PASSWORD",
+          "icon": ":/images/GSMax.jpg", "contextTokens": 8192 },
+        { "id": "4.0Ultra", "name": "GSUltra", "keyVariable": "GSULTRA_PASSWORD",
+          "icon": ":/images/GSUltra.jpg", "contextTokens": 8192,
+          "route": { "hedgeModel": "generalv3", "hedgeAfterMs": 3000 } }
+    ]
+})";
+
+} // namespace
+
+ModelRegistry::ModelRegistry()
+    : defaultHandle(-1)
+    , summaryHandle(-1)
+{
+    QString error;
+    if (!parse(QByteArray(kBuiltinConfig), &error)) {
+        qWarning() << "Invalid built-in model config:" << error;
+    }
+}
+
+QString ModelRegistry::defaultPath()
+{
+    return QProcessEnvironment::systemEnvironment().value("GSAI_MODELS_CONFIG", "models.json");
+}
+
+bool ModelRegistry::load(const QString &path, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return false;
+    }
+    return parse(file.readAll(), error);
+}
+
+bool ModelRegistry::parse(const QByteArray &json, QString *error)
+{
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(json, &parseError);
+    if (!doc.isObject()) {
+        if (error) {
+            *error = parseError.errorString();
+        }
+        return false;
+    }
+
+    const QJsonObject root = doc.object();
+    const QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    QVector<Model> parsed;
+    QHash<QString, int> parsedHandles;
+    QVector<QJsonObject> routes;           // 所有模型读完后再解析路由目标
+
+    for (const QJsonValue &value : root["models"].toArray()) {
+        const QJsonObject entry = value.toObject();
+        Model model;
+        model.id = entry["id"].toString();
+        if (model.id.isEmpty() || parsedHandles.contains(model.id)) {
+            qWarning() << "Skipping model config entry without a unique id:" << entry;
+            continue;
+        }
+        model.name = entry["name"].toString(model.id);
+        model.endpoint = QUrl(entry["endpoint"].toString());
+        model.keyVariable = entry["keyVariable"].toString();
+        if (!model.keyVariable.isEmpty()) {
+            model.apiKey = env.value(model.keyVariable);
+        }
+        model.icon = entry["icon"].toString();
+        model.contextTokens = entry["contextTokens"].toInt(kDefaultContextTokens);
+        const QJsonObject price = entry["price"].toObject();
+        model.inputPrice = price["input"].toDouble();
+        model.outputPrice = price["output"].toDouble();
+
+        parsedHandles.insert(model.id, parsed.size());
+        parsed.append(model);
+        routes.append(entry["route"].toObject());
+    }
+
+    if (parsed.isEmpty()) {
+        if (error) {
+            *error = QStringLiteral("no models configured");
+        }
+        return false;
+    }
+
+    for (int i = 0; i < parsed.size(); ++i) {
+        const QJsonObject &route = routes[i];
+        parsed[i].shortPromptModel = parsedHandles.value(route["shortPromptModel"].toString(), -1);
+        parsed[i].shortPromptChars = route["shortPromptChars"].toInt();
+        parsed[i].hedgeModel = parsedHandles.value(route["hedgeModel"].toString(), -1);
+        parsed[i].hedgeAfterMs = route["hedgeAfterMs"].toInt();
+    }
+
+    models = parsed;
+    handles = parsedHandles;
+    defaultHandle = handles.value(root["default"].toString(), 0);
+    summaryHandle = handles.value(root["summaryModel"].toString(), -1);
+    return true;
+}
+
+const ModelRegistry::Model &ModelRegistry::model(int handle) const
+{
+    static const Model empty;
+    return handle >= 0 && handle < models.size() ? models[handle] : empty;
+}
+
+int ModelRegistry::summaryModel() const
+{
+    return summaryHandle >= 0 && !models[summaryHandle].apiKey.isEmpty() ? summaryHandle : defaultHandle;
+}
+
+int ModelRegistry::budget(int handle) const
+{
+    const Model &entry = model(handle);
+    return ContextBuilder::budgetFor(entry.contextTokens > 0 ? entry.contextTokens : kDefaultContextTokens);
+}
+
+int ModelRegistry::route(int handle, const QString &prompt) const
+{
+    const Model &entry = model(handle);
+    if (entry.shortPromptModel < 0 || prompt.trimmed().size() > entry.shortPromptChars) {
+        return handle;
+    }
+    // 没有配置密钥的模型不能接手
+    return model(entry.shortPromptModel).apiKey.isEmpty() ? handle : entry.shortPromptModel;
+}
+
+double ModelRegistry::cost(int handle, int promptTokens, int completionTokens) const
+{
+    const Model &entry = model(handle);
+    return (promptTokens * entry.inputPrice + completionTokens * entry.outputPrice) / 1000.0;
+}
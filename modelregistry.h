@@ -0,0 +1,76 @@
+#ifndef MODELREGISTRY_H
+#define MODELREGISTRY_H
+
+#include <QString>
+#include <QUrl>
+#include <QVector>
+#include <QHash>
+
+/**
+ * @brief 模型注册表：可用的模型及其接口、密钥、上下文长度、价格和路由策略
+ *
+ * 默认使用内置的四个星火模型；程序目录下的 models.json（或环境变量
+ * GSAI_MODELS_CONFIG 指定的文件）存在时，整体替换为其中的配置，
+ * 增加模型或修改接口不需要改代码。
+ *
+ * 加载后每个模型有一个整数句柄（在列表中的序号），绘制消息、切换模型等
+ * 频繁的地方用句柄直接取数据，不再比较模型名。只在主线程中修改。
+ */
+class ModelRegistry
+{
+public:
+    struct Model {
+        Model() : contextTokens(0), inputPrice(0), outputPrice(0),
+            shortPromptModel(-1), shortPromptChars(0), hedgeModel(-1), hedgeAfterMs(0) {}
+        QString id;                        // 接口中的模型名
+        QString name;                      // 显示名称
+        QUrl endpoint;                     // 为空时使用 ChatEngine 的接口地址
+        QString keyVariable;               // 保存 API 密钥的环境变量
+        QString apiKey;                    // 加载时从环境变量读取
+        QString icon;                      // 菜单图标，同时用作消息头像
+        int contextTokens;                 // 上下文长度
+        double inputPrice;                 // 每千 token 的价格（元）
+        double outputPrice;
+
+        // 路由策略：不超过 shortPromptChars 个字的问题改发给 shortPromptModel（0 表示不改）
+        int shortPromptModel;
+        int shortPromptChars;
+        // 竞速模式下超过 hedgeAfterMs 还没有首字时，同时发给 hedgeModel
+        int hedgeModel;
+        int hedgeAfterMs;
+    };
+
+    // 内置的默认配置
+    ModelRegistry();
+
+    // 环境变量 GSAI_MODELS_CONFIG 指定的配置文件，未设置时为 models.json
+    static QString defaultPath();
+    // 从配置文件加载，失败时保留原来的配置
+    bool load(const QString &path, QString *error = nullptr);
+
+    int count() const { return models.size(); }
+    // 模型名对应的句柄，未知的模型为 -1
+    int handle(const QString &id) const { return handles.value(id, -1); }
+    // 句柄无效时返回空的模型
+    const Model &model(int handle) const;
+    int defaultModel() const { return defaultHandle; }
+    // 生成对话摘要用的模型（配置中的 summaryModel）；没有配置或没有密钥时为默认模型
+    int summaryModel() const;
+
+    // 模型可用于输入的 token 预算，未知的模型按默认上下文长度计算
+    int budget(int handle) const;
+    // 按路由策略决定这个问题实际发给哪个模型
+    int route(int handle, const QString &prompt) const;
+    // 按配置的价格估算一次请求的费用（元）
+    double cost(int handle, int promptTokens, int completionTokens) const;
+
+private:
+    bool parse(const QByteArray &json, QString *error);
+
+    QVector<Model> models;
+    QHash<QString, int> handles;           // 模型名 -> 句柄
+    int defaultHandle;
+    int summaryHandle;                     // 配置的摘要模型，-1 表示没有配置
+};
+
+#endif // MODELREGISTRY_H
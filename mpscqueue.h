@@ -0,0 +1,73 @@
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <QAtomicPointer>
+
+/**
+ * @brief 无锁的多生产者、单消费者队列
+ *
+ * 生产者用 CAS 把节点压到链表头；消费者一次性摘下整条链表并反转成
+ * 先进先出的顺序。消费者从不单独弹出节点，所以不存在 ABA 问题。
+ */
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue() : head(nullptr) {}
+    ~MpscQueue()
+    {
+        Node *node = head.fetchAndStoreAcquire(nullptr);
+        while (node) {
+            Node *next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    // 入队；返回 true 表示入队前队列是空的，调用方需要唤醒消费者
+    bool push(const T &value)
+    {
+        Node *node = new Node(value);
+        Node *expected = head.loadAcquire();
+        do {
+            node->next = expected;
+        } while (!head.testAndSetOrdered(expected, node, expected));
+        return expected == nullptr;
+    }
+
+    // 取出当前所有元素，按入队顺序对每个元素调用 f
+    template <typename F>
+    void drain(F f)
+    {
+        Node *node = head.fetchAndStoreAcquire(nullptr);
+
+        // 链表是后进先出的，先反转
+        Node *ordered = nullptr;
+        while (node) {
+            Node *next = node->next;
+            node->next = ordered;
+            ordered = node;
+            node = next;
+        }
+
+        while (ordered) {
+            Node *next = ordered->next;
+            f(ordered->value);
+            delete ordered;
+            ordered = next;
+        }
+    }
+
+private:
+    struct Node {
+        explicit Node(const T &v) : value(v), next(nullptr) {}
+        T value;
+        Node *next;
+    };
+
+    QAtomicPointer<Node> head;
+
+    Q_DISABLE_COPY(MpscQueue)
+};
+
+#endif // MPSCQUEUE_H
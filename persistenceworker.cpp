@@ -0,0 +1,575 @@
+#include "persistenceworker.h"
+
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QCborValue>
+#include <QCborMap>
+#include <QCborArray>
+#include <QCborStreamReader>
+#include <QSaveFile>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QDir>
+#include <QDebug>
+
+namespace {
+
+const int kIndexVersion = 4;
+
+// 旧版数据文件：每个会话是一段 JSON 数组
+QList<QJsonObject> parseMessageArray(const QByteArray &data)
+{
+    QList<QJsonObject> messages;
+    QJsonDocument doc = QJsonDocument::fromJson(data);
+    for (const QJsonValue &value : doc.array()) {
+        if (value.isObject()) {
+            messages.append(value.toObject());
+        }
+    }
+    return messages;
+}
+
+// 一条消息编码成一个 CBOR map，会话的消息首尾相接，追加时直接拼在后面
+QByteArray encodeMessage(const QJsonObject &message)
+{
+    return QCborMap::fromJsonObject(message).toCborValue().toCbor();
+}
+
+bool decodeMessages(const QByteArray &data, bool json, QList<QJsonObject> *messages)
+{
+    if (json) {
+        *messages = parseMessageArray(data);
+        return true;
+    }
+
+    QCborStreamReader reader(data);
+    while (reader.isValid()) {
+        QCborValue value = QCborValue::fromCbor(reader);
+        if (reader.lastError() != QCborError::NoError) {
+            break;
+        }
+        if (value.isMap()) {
+            messages->append(value.toMap().toJsonObject());
+        }
+    }
+    return reader.lastError() == QCborError::NoError || reader.lastError() == QCborError::EndOfFile;
+}
+
+// 旧版 JSON 索引转换过来的数字是 double
+qint64 integerValue(const QCborMap &map, const char *key)
+{
+    QCborValue value = map.value(QLatin1String(key));
+    return value.isInteger() ? value.toInteger() : qint64(value.toDouble());
+}
+
+// 用 QSaveFile 整体写入：先写临时文件并落盘，commit() 时才替换目标文件
+bool writeAtomically(const QString &path, const QByteArray &data)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    if (file.write(data) != data.size()) {
+        file.cancelWriting();
+    }
+    return file.commit();
+}
+
+// 生成新一代数据文件和索引。
+// 没有新消息的会话直接拷贝原来的字节，不需要重新解析。
+ConversationStore::CompactionResult compactData(const QString &oldDataPath, const QString &newDataPath,
+                                                const QString &indexPath, const PersistenceWorker::CompactionJob &job)
+{
+    ConversationStore::CompactionResult result;
+    result.generation = job.generation;
+
+    QFile oldData(oldDataPath);
+    bool haveOldData = oldData.open(QIODevice::ReadOnly);
+
+    QSaveFile newData(newDataPath);
+    if (!newData.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to write conversation data.";
+        return result;
+    }
+
+    QCborArray index;
+    qint64 offset = 0;
+    for (qint64 id : job.order) {
+        const ConversationStore::Entry entry = job.state.value(id);
+
+        QByteArray blob;
+        if (entry.length > 0) {
+            if (!haveOldData || !oldData.seek(entry.offset)) {
+                return result;
+            }
+            blob = oldData.read(entry.length);
+            if (blob.size() != entry.length) {
+                return result;
+            }
+            // 旧版 JSON 数据在这一次压缩中转换成 CBOR
+            if (job.oldJsonData) {
+                QByteArray converted;
+                for (const QJsonObject &msg : parseMessageArray(blob)) {
+                    converted += encodeMessage(msg);
+                }
+                blob = converted;
+            }
+        }
+
+        for (const QJsonObject &msg : entry.pending) {
+            blob += encodeMessage(msg);
+        }
+
+        if (newData.write(blob) != blob.size()) {
+            return result;
+        }
+
+        ConversationStore::Entry written;
+        written.title = entry.title;
+        written.offset = offset;
+        written.length = blob.size();
+        written.storedCount = entry.storedCount + entry.pending.size();
+        written.lastActivity = entry.lastActivity;
+        written.pending = entry.pending;
+        result.entries.insert(id, written);
+        offset += blob.size();
+
+        QCborMap obj;
+        obj[QLatin1String("id")] = id;
+        obj[QLatin1String("title")] = entry.title;
+        obj[QLatin1String("offset")] = written.offset;
+        obj[QLatin1String("length")] = written.length;
+        obj[QLatin1String("count")] = written.storedCount;
+        obj[QLatin1String("activity")] = written.lastActivity;
+        index.append(obj);
+    }
+
+    // 数据文件先落盘，索引替换成功后新一代数据才生效
+    if (!newData.commit()) {
+        return result;
+    }
+
+    QCborMap root;
+    root[QLatin1String("version")] = kIndexVersion;
+    root[QLatin1String("generation")] = job.generation;
+    root[QLatin1String("seq")] = job.seq;
+    root[QLatin1String("nextId")] = job.nextId;
+    root[QLatin1String("dataSize")] = offset;
+    root[QLatin1String("conversations")] = index;
+
+    result.ok = writeAtomically(indexPath, root.toCborValue().toCbor());
+    return result;
+}
+
+} // namespace
+
+PersistenceWorker::PersistenceWorker(const QString &baseName)
+    : baseName(baseName)
+    , indexPath(baseName + ".idx")
+    , previousIndexPath(baseName + ".idx.prev")
+    , legacyPath(baseName + ".json")
+    , migratedPath(baseName + ".json.migrated")
+    , journalPath(baseName + ".journal")
+    , pendingJournalPath(baseName + ".journal.prev")
+    , oldJournalPath(baseName + ".journal.old")
+    , pendingSeq(0)
+    , dataGeneration(-1)
+    , indexValid(false)
+{
+}
+
+void PersistenceWorker::post(const Task &task)
+{
+    // 只有队列原来是空的才需要唤醒，否则上一次唤醒还没有处理
+    if (queue.push(task)) {
+        QMetaObject::invokeMethod(this, "drain", Qt::QueuedConnection);
+    }
+}
+
+void PersistenceWorker::drain()
+{
+    queue.drain([this](const Task &task) {
+        if (task.type == Task::Append) {
+            // 连续的追加先攒着，遇到其它任务或本轮结束时一起写入
+            pendingLines += task.line;
+            pendingSeq = task.seq;
+            return;
+        }
+
+        flushAppends();
+        switch (task.type) {
+        case Task::Load:
+            load();
+            break;
+        case Task::ReadMessages:
+            readMessages(task);
+            break;
+        case Task::Compact:
+            compact(task.job);
+            break;
+        case Task::Append:
+            break;
+        }
+    });
+    flushAppends();
+}
+
+void PersistenceWorker::flushAppends()
+{
+    if (pendingLines.isEmpty()) {
+        return;
+    }
+
+    if (!openJournal() || journal.write(pendingLines) != pendingLines.size() || !journal.flush()) {
+        qDebug() << "Failed to save conversations.";
+    } else {
+        emit journalWritten(pendingSeq);
+    }
+    pendingLines.clear();
+}
+
+void PersistenceWorker::load()
+{
+    QElapsedTimer timer;
+    timer.start();
+    ConversationStore::Snapshot snapshot;
+
+    indexValid = readIndex(indexPath, snapshot);
+    if (!indexValid && QFile::exists(previousIndexPath)) {
+        // 最新的索引损坏（例如写到一半断电）：退回上一代，重放它之后的全部日志
+        if (readIndex(previousIndexPath, snapshot)) {
+            qWarning() << "Conversation index is damaged, restoring previous generation" << snapshot.generation;
+            restorePreviousGeneration();
+            snapshot.migrate = true;
+            indexValid = true;
+        }
+    }
+
+    // 从来没有写过新格式时才导入旧版 conversations.json。已经有索引或日志时，
+    // 旧文件只是迁移之前的内容，导入会让过时的会话覆盖掉之后的修改
+    if (!indexValid) {
+        const bool migrated = QFile::exists(indexPath) || QFile::exists(previousIndexPath)
+                || QFileInfo(journalPath).size() > 0 || QFileInfo(pendingJournalPath).size() > 0;
+        if (migrated) {
+            qWarning() << "Conversation index is damaged and no previous generation is available";
+        } else {
+            snapshot.migrate = readLegacy(snapshot);
+        }
+    }
+
+    // 先重放未压缩完的旧日志，再重放当前日志
+    replayJournal(pendingJournalPath, snapshot);
+    replayJournal(journalPath, snapshot);
+
+    removeStaleDataFiles(snapshot.generation);
+    openJournal();
+    snapshot.journalBytes = journal.size();
+
+    qDebug() << "Conversation index loaded in" << timer.elapsed() << "ms:"
+             << snapshot.order.size() << "conversations," << snapshot.journalRecords << "journal records";
+    emit loaded(snapshot);
+}
+
+// 只读取这个会话在数据文件中的那一段
+void PersistenceWorker::readMessages(const Task &task)
+{
+    if (dataGeneration != task.generation || !dataFile.isOpen()) {
+        dataFile.close();
+        dataFile.setFileName(dataPath(task.generation));
+        dataFile.open(QIODevice::ReadOnly);
+        dataGeneration = task.generation;
+    }
+
+    QList<QJsonObject> messages;
+    bool ok = dataFile.isOpen() && dataFile.seek(task.offset);
+    if (ok) {
+        QByteArray blob = dataFile.read(task.length);
+        ok = blob.size() == task.length && decodeMessages(blob, task.jsonData, &messages);
+    }
+    if (!ok) {
+        qDebug() << "Failed to read conversation" << task.id;
+        messages.clear();
+    }
+    emit messagesRead(task.id, task.generation, messages, ok);
+}
+
+void PersistenceWorker::compact(const CompactionJob &job)
+{
+    QElapsedTimer timer;
+    timer.start();
+    rotateJournal();
+
+    // 替换之前先把当前索引存为上一代；损坏的索引不保留
+    if (indexValid) {
+        QFile current(indexPath);
+        if (current.open(QIODevice::ReadOnly)) {
+            writeAtomically(previousIndexPath, current.readAll());
+        }
+    }
+
+    ConversationStore::CompactionResult result =
+        compactData(dataPath(job.generation - 1), dataPath(job.generation), indexPath, job);
+
+    if (result.ok) {
+        // 新索引已经生效。上一代的数据文件和它之后的日志留着，
+        // 新索引损坏时可以从上一代恢复；更早的一代不再需要
+        indexValid = true;
+        dataFile.close();
+        QFile::remove(dataPath(job.generation - 2));
+        // 先整体替换旧日志再删除待压缩日志；中途退出时两份内容相同，重放按 seq 跳过重复的记录
+        QFile pending(pendingJournalPath);
+        if (pending.open(QIODevice::ReadOnly) && writeAtomically(oldJournalPath, pending.readAll())) {
+            pending.close();
+            QFile::remove(pendingJournalPath);
+        }
+        // 旧版文件的内容已经写进检查点，改名留作备份，以后不会再被导入
+        if (QFile::exists(legacyPath)) {
+            QFile::remove(migratedPath);
+            QFile::rename(legacyPath, migratedPath);
+        }
+        qDebug() << "Conversation checkpoint" << job.generation << "written in" << timer.elapsed() << "ms";
+    } else {
+        qDebug() << "Conversation compaction failed, keeping journal.";
+        QFile::remove(dataPath(job.generation));
+    }
+    emit compactionFinished(result);
+}
+
+// 当前日志改名为旧日志，之后的追加写入新日志
+void PersistenceWorker::rotateJournal()
+{
+    journal.close();
+
+    if (QFile::exists(pendingJournalPath)) {
+        // 上一次压缩没有完成：把当前日志接到旧日志后面，一起被新索引覆盖
+        QFile pending(pendingJournalPath);
+        QFile current(journalPath);
+        if (pending.open(QIODevice::WriteOnly | QIODevice::Append) && current.open(QIODevice::ReadOnly)) {
+            pending.write(current.readAll());
+            current.close();
+            pending.close();
+            QFile::remove(journalPath);
+        }
+    } else {
+        QFile::rename(journalPath, pendingJournalPath);
+    }
+
+    openJournal();
+}
+
+// 只读取索引，不碰消息正文。索引无法解析、或与数据文件对不上时返回 false
+bool PersistenceWorker::readIndex(const QString &path, ConversationStore::Snapshot &snapshot)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QByteArray bytes = file.readAll();
+    file.close();
+
+    // 版本 3 及以前的索引是 JSON，数据文件里也是 JSON 数组，下次压缩时转换
+    QCborMap root;
+    bool json = bytes.startsWith('{');
+    if (json) {
+        QJsonDocument doc = QJsonDocument::fromJson(bytes);
+        if (!doc.isObject()) {
+            qDebug() << "Invalid conversation index" << path;
+            return false;
+        }
+        root = QCborMap::fromJsonObject(doc.object());
+    } else {
+        QCborParserError error;
+        QCborValue value = QCborValue::fromCbor(bytes, &error);
+        if (error.error != QCborError::NoError || !value.isMap()) {
+            qDebug() << "Invalid conversation index" << path << error.errorString();
+            return false;
+        }
+        root = value.toMap();
+
+        // 数据文件必须和索引记录的大小一致，否则这一代没有完整写入
+        QFileInfo data(dataPath(int(integerValue(root, "generation"))));
+        qint64 dataSize = integerValue(root, "dataSize");
+        if (dataSize > 0 && (!data.exists() || data.size() != dataSize)) {
+            qDebug() << "Conversation data does not match index" << path;
+            return false;
+        }
+    }
+
+    snapshot.jsonData = json;
+    snapshot.migrate = json;
+    snapshot.generation = int(integerValue(root, "generation"));
+    snapshot.snapshotSeq = integerValue(root, "seq");
+    snapshot.seq = snapshot.snapshotSeq;
+    snapshot.nextId = qMax(snapshot.nextId, integerValue(root, "nextId"));
+    const QCborArray conversations = root.value(QLatin1String("conversations")).toArray();
+    for (const QCborValue &value : conversations) {
+        QCborMap obj = value.toMap();
+        qint64 id = integerValue(obj, "id");
+        ConversationStore::Entry entry;
+        entry.title = obj.value(QLatin1String("title")).toString();
+        entry.offset = integerValue(obj, "offset");
+        entry.length = integerValue(obj, "length");
+        entry.storedCount = int(integerValue(obj, "count"));
+        entry.lastActivity = integerValue(obj, "activity"); // 较早的索引没有，为 0
+        snapshot.state.insert(id, entry);
+        snapshot.order.append(id);
+        snapshot.nextId = qMax(snapshot.nextId, id + 1);
+    }
+    return true;
+}
+
+// 导入旧版 conversations.json，返回 true 表示需要迁移
+bool PersistenceWorker::readLegacy(ConversationStore::Snapshot &snapshot)
+{
+    QFile file(legacyPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "No conversations found.";
+        return false;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    file.close();
+
+    // 最早的格式顶层就是会话数组；之后的快照格式带有编号和序号
+    QJsonArray conversations;
+    if (doc.isArray()) {
+        conversations = doc.array();
+    } else if (doc.isObject()) {
+        QJsonObject root = doc.object();
+        snapshot.snapshotSeq = qint64(root["seq"].toDouble());
+        snapshot.seq = snapshot.snapshotSeq;
+        snapshot.nextId = qMax(snapshot.nextId, qint64(root["nextId"].toDouble()));
+        conversations = root["conversations"].toArray();
+    } else {
+        qDebug() << "Invalid conversations format.";
+        return false;
+    }
+
+    for (const QJsonValue &value : conversations) {
+        if (!value.isObject()) {
+            continue;
+        }
+        QJsonObject obj = value.toObject();
+        qint64 id = obj.contains("id") ? qint64(obj["id"].toDouble()) : snapshot.nextId;
+        ConversationStore::Entry entry;
+        entry.title = obj["title"].toString();
+        for (const QJsonValue &msgVal : obj["messages"].toArray()) {
+            if (msgVal.isObject()) {
+                entry.pending.append(msgVal.toObject());
+            }
+        }
+        snapshot.state.insert(id, entry);
+        snapshot.order.append(id);
+        snapshot.nextId = qMax(snapshot.nextId, id + 1);
+    }
+    return true;
+}
+
+void PersistenceWorker::replayJournal(const QString &path, ConversationStore::Snapshot &snapshot)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadWrite)) {
+        return;
+    }
+
+    QByteArray data = file.readAll();
+    int pos = 0;
+    while (pos < data.size()) {
+        int end = data.indexOf('\n', pos);
+        if (end < 0) {
+            break; // 最后一条记录没有写完
+        }
+
+        int space = data.indexOf(' ', pos);
+        if (space < 0 || space > end) {
+            break;
+        }
+        bool ok = false;
+        quint16 expected = quint16(data.mid(pos, space - pos).toUInt(&ok, 16));
+        const char *json = data.constData() + space + 1;
+        uint jsonLen = uint(end - space - 1);
+        if (!ok || qChecksum(json, jsonLen) != expected) {
+            break;
+        }
+
+        QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromRawData(json, int(jsonLen)));
+        if (!doc.isObject()) {
+            break;
+        }
+
+        QJsonObject record = doc.object();
+        qint64 recordSeq = qint64(record["seq"].toDouble());
+        if (recordSeq > snapshot.snapshotSeq) {
+            snapshot.apply(record);
+            snapshot.seq = qMax(snapshot.seq, recordSeq);
+        }
+        ++snapshot.journalRecords;
+        pos = end + 1;
+    }
+
+    // 截掉残缺的尾部，后续追加从干净的位置开始
+    if (pos < data.size()) {
+        qDebug() << "Discarding torn journal tail in" << path;
+        file.resize(pos);
+    }
+    file.close();
+}
+
+// 把上一代索引恢复为当前索引，并把它之后的日志合并成待压缩的旧日志，
+// 这样和“压缩中途退出”的情况一样处理，随后的压缩会重新生成新一代
+void PersistenceWorker::restorePreviousGeneration()
+{
+    // 整体替换，不先删除当前索引：中途退出时至少还有一份可用的索引
+    QFile previous(previousIndexPath);
+    if (!previous.open(QIODevice::ReadOnly) || !writeAtomically(indexPath, previous.readAll())) {
+        qWarning() << "Failed to restore previous conversation index";
+    }
+    previous.close();
+
+    if (!QFile::exists(oldJournalPath)) {
+        return;
+    }
+    QByteArray merged;
+    QFile old(oldJournalPath);
+    if (old.open(QIODevice::ReadOnly)) {
+        merged = old.readAll();
+        old.close();
+    }
+    QFile pending(pendingJournalPath);
+    if (pending.open(QIODevice::ReadOnly)) {
+        merged += pending.readAll();
+        pending.close();
+    }
+    if (writeAtomically(pendingJournalPath, merged)) {
+        QFile::remove(oldJournalPath);
+    }
+}
+
+bool PersistenceWorker::openJournal()
+{
+    if (journal.isOpen()) {
+        return true;
+    }
+    journal.setFileName(journalPath);
+    return journal.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+// 删除压缩中途退出留下的、索引没有引用的数据文件（保留上一代用于恢复）
+void PersistenceWorker::removeStaleDataFiles(int generation)
+{
+    QFileInfo base(baseName);
+    QDir dir = base.absoluteDir();
+    const QString current = QFileInfo(dataPath(generation)).fileName();
+    const QString previous = QFileInfo(dataPath(generation - 1)).fileName();
+    const QStringList files = dir.entryList(QStringList() << base.fileName() + ".*.dat", QDir::Files);
+    for (const QString &name : files) {
+        if (name != current && name != previous) {
+            dir.remove(name);
+        }
+    }
+}
+
+QString PersistenceWorker::dataPath(int generation) const
+{
+    return baseName + "." + QString::number(generation) + ".dat";
+}
@@ -0,0 +1,94 @@
+#ifndef PERSISTENCEWORKER_H
+#define PERSISTENCEWORKER_H
+
+#include <QObject>
+#include <QFile>
+#include "conversationstore.h"
+#include "mpscqueue.h"
+
+/**
+ * @brief 会话存储的 I/O 线程
+ *
+ * 主线程通过 post() 把任务放进无锁队列，队列由空变为非空时才唤醒本线程。
+ * 每次唤醒取出队列中的全部任务按顺序执行，其中连续的日志追加合并成一次
+ * 写入和一次 flush，所以一阵密集的修改只落一次盘。结果用信号通知主线程。
+ */
+class PersistenceWorker : public QObject
+{
+    Q_OBJECT
+public:
+    // 压缩需要的全部输入，都是隐式共享的拷贝
+    struct CompactionJob {
+        CompactionJob() : seq(0), nextId(1), generation(0), oldJsonData(false) {}
+        QList<qint64> order;
+        QHash<qint64, ConversationStore::Entry> state;
+        qint64 seq;
+        qint64 nextId;
+        int generation;                    // 新一代的代号
+        bool oldJsonData;                  // 上一代数据文件是 JSON 格式
+    };
+
+    struct Task {
+        enum Type { Load, Append, ReadMessages, Compact };
+        Task() : type(Append), seq(0), id(0), offset(0), length(0), generation(0), jsonData(false) {}
+        Type type;
+        QByteArray line;                   // Append：完整的日志行
+        qint64 seq;                        // Append：记录序号
+        qint64 id;                         // ReadMessages：会话和它在数据文件中的位置
+        qint64 offset;
+        qint64 length;
+        int generation;
+        bool jsonData;
+        CompactionJob job;                 // Compact
+    };
+
+    explicit PersistenceWorker(const QString &baseName);
+
+    // 可以在任意线程调用
+    void post(const Task &task);
+
+public slots:
+    // 执行队列中的全部任务
+    void drain();
+
+signals:
+    void loaded(const ConversationStore::Snapshot &snapshot);
+    void journalWritten(qint64 seq);
+    void messagesRead(qint64 id, int generation, const QList<QJsonObject> &stored, bool ok);
+    void compactionFinished(const ConversationStore::CompactionResult &result);
+
+private:
+    void load();
+    void flushAppends();
+    void readMessages(const Task &task);
+    void compact(const CompactionJob &job);
+
+    bool readIndex(const QString &path, ConversationStore::Snapshot &snapshot);
+    bool readLegacy(ConversationStore::Snapshot &snapshot);
+    void replayJournal(const QString &path, ConversationStore::Snapshot &snapshot);
+    void restorePreviousGeneration();
+    void removeStaleDataFiles(int generation);
+    bool openJournal();
+    void rotateJournal();
+    QString dataPath(int generation) const;
+
+    MpscQueue<Task> queue;
+
+    QString baseName;
+    QString indexPath;                     // 索引文件
+    QString previousIndexPath;             // 上一代索引，最新的损坏时使用
+    QString legacyPath;                    // 旧版 conversations.json
+    QString migratedPath;                  // 迁移完成后旧版文件改成的名字
+    QString journalPath;                   // 当前日志
+    QString pendingJournalPath;            // 正在被压缩的旧日志
+    QString oldJournalPath;                // 上一代索引之后、最新索引之前的日志
+    QFile journal;
+
+    QByteArray pendingLines;               // 尚未写入的连续追加
+    qint64 pendingSeq;
+    QFile dataFile;                        // 读取消息用的数据文件，保持打开
+    int dataGeneration;
+    bool indexValid;                       // 磁盘上的索引可以作为上一代保留
+};
+
+#endif // PERSISTENCEWORKER_H
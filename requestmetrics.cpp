@@ -0,0 +1,141 @@
+#include "requestmetrics.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QDebug>
+
+namespace {
+
+const qint64 kMaxLogSize = 1024 * 1024;    // 单个日志文件上限
+const int kRotatedFiles = 3;               // 保留的历史文件个数
+const int kRecentLimit = 500;              // 内存中保留的记录数
+
+} // namespace
+
+RequestMetrics::RequestMetrics()
+    : ok(false)
+    , httpStatus(0)
+    , encryptedMs(-1)
+    , headersMs(-1)
+    , firstByteMs(-1)
+    , firstTokenMs(-1)
+    , totalMs(-1)
+    , http2(false)
+    , connection(ConnectionUnknown)
+    , cached(false)
+    , retries(0)
+    , bytesReceived(0)
+    , bytesSent(0)
+    , deltaCount(0)
+    , promptTokens(0)
+    , completionTokens(0)
+    , lastTokenMs(-1)
+    , gapHistogram(gapBucketBounds().size() + 1, 0)
+{
+}
+
+const QVector<int> &RequestMetrics::gapBucketBounds()
+{
+    static const QVector<int> bounds = QVector<int>() << 5 << 10 << 20 << 50 << 100 << 200 << 500 << 1000;
+    return bounds;
+}
+
+void RequestMetrics::recordDelta(qint64 atMs)
+{
+    if (firstTokenMs < 0) {
+        firstTokenMs = atMs;
+    }
+    if (lastTokenMs >= 0) {
+        const QVector<int> &bounds = gapBucketBounds();
+        qint64 gap = atMs - lastTokenMs;
+        int bucket = 0;
+        while (bucket < bounds.size() && gap >= bounds[bucket]) {
+            ++bucket;
+        }
+        ++gapHistogram[bucket];
+    }
+    lastTokenMs = atMs;
+    ++deltaCount;
+}
+
+double RequestMetrics::tokensPerSecond() const
+{
+    if (firstTokenMs < 0 || totalMs <= firstTokenMs) {
+        return 0;
+    }
+    int tokens = completionTokens > 0 ? completionTokens : deltaCount;
+    return tokens * 1000.0 / double(totalMs - firstTokenMs);
+}
+
+QJsonObject RequestMetrics::toJson() const
+{
+    QJsonObject obj;
+    obj["started"] = startedAt.toString(Qt::ISODateWithMs);
+    obj["model"] = model;
+    obj["ok"] = ok;
+    if (!error.isEmpty()) {
+        obj["error"] = error;
+    }
+    obj["status"] = httpStatus;
+    obj["encryptedMs"] = encryptedMs;
+    obj["headersMs"] = headersMs;
+    obj["firstByteMs"] = firstByteMs;
+    obj["firstTokenMs"] = firstTokenMs;
+    obj["totalMs"] = totalMs;
+    obj["http2"] = http2;
+    // 无法判断时写 null，不算作新建或复用
+    obj["reused"] = connection == ConnectionUnknown ? QJsonValue() : QJsonValue(connection == ConnectionReused);
+    obj["cached"] = cached;
+    obj["retries"] = retries;
+    obj["bytes"] = bytesReceived;
+    obj["uploadBytes"] = bytesSent;
+    obj["deltas"] = deltaCount;
+    obj["promptTokens"] = promptTokens;
+    obj["completionTokens"] = completionTokens;
+    obj["tokensPerSecond"] = tokensPerSecond();
+
+    QJsonArray histogram;
+    for (int count : gapHistogram) {
+        histogram.append(count);
+    }
+    obj["gapHistogram"] = histogram;
+    return obj;
+}
+
+MetricsLog::MetricsLog(const QString &path, QObject *parent)
+    : QObject(parent)
+    , path(path)
+{
+}
+
+void MetricsLog::record(const RequestMetrics &metrics)
+{
+    recentMetrics.append(metrics);
+    if (recentMetrics.size() > kRecentLimit) {
+        recentMetrics.removeFirst();
+    }
+
+    QFile file(path);
+    if (file.size() >= kMaxLogSize) {
+        rotate();
+    }
+    if (file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        file.write(QJsonDocument(metrics.toJson()).toJson(QJsonDocument::Compact) + '\n');
+        file.close();
+    } else {
+        qDebug() << "Failed to write metrics.";
+    }
+
+    emit recorded(metrics);
+}
+
+// metrics.jsonl -> metrics.jsonl.1 -> ... -> metrics.jsonl.N
+void MetricsLog::rotate()
+{
+    QFile::remove(path + "." + QString::number(kRotatedFiles));
+    for (int i = kRotatedFiles - 1; i >= 1; --i) {
+        QFile::rename(path + "." + QString::number(i), path + "." + QString::number(i + 1));
+    }
+    QFile::rename(path, path + ".1");
+}
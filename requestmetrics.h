@@ -0,0 +1,85 @@
+#ifndef REQUESTMETRICS_H
+#define REQUESTMETRICS_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QVector>
+#include <QList>
+#include <QJsonObject>
+
+/**
+ * @brief 一次请求的计时和流量数据
+ *
+ * 所有时间都是相对发出请求时刻的毫秒数，-1 表示没有发生。
+ * Qt 不单独报告 DNS 和 TCP 连接耗时；新建连接时 encryptedMs 覆盖
+ * DNS + TCP + TLS 握手，复用已有连接时它为 -1。明文 HTTP 没有握手，
+ * 无法区分新建和复用的连接，connection 记为 ConnectionUnknown。
+ */
+struct RequestMetrics {
+    enum Connection {
+        ConnectionUnknown,                 // 明文 HTTP、缓存或没有收到响应
+        ConnectionNew,
+        ConnectionReused
+    };
+
+    RequestMetrics();
+
+    QDateTime startedAt;
+    QString model;
+    bool ok;
+    QString error;
+    int httpStatus;
+
+    qint64 encryptedMs;                    // TLS 握手完成（新连接）
+    qint64 headersMs;                      // 收到响应头
+    qint64 firstByteMs;                    // 收到第一个响应体字节
+    qint64 firstTokenMs;                   // 收到第一个非空增量
+    qint64 totalMs;                        // 请求结束
+    bool http2;                            // 是否使用了 HTTP/2
+    Connection connection;                 // 新建还是复用了已有连接
+    bool cached;                           // 回复来自本地缓存，没有请求接口
+    int retries;                           // 重试次数，计时数据只对应最后一次
+
+    qint64 bytesReceived;                  // 响应体字节数
+    qint64 bytesSent;                      // 实际上传的请求体字节数（压缩后）
+    int deltaCount;                        // 非空增量个数
+    int promptTokens;                      // 服务器返回的 usage，没有时为 0
+    int completionTokens;
+    qint64 lastTokenMs;                    // 最后一个增量的时间，用于计算间隔
+    QVector<int> gapHistogram;             // 增量间隔直方图，桶边界见 gapBucketBounds()
+
+    // 生成速度：completion token 数（没有 usage 时用增量个数）/ 首字之后的耗时
+    double tokensPerSecond() const;
+    void recordDelta(qint64 atMs);
+    QJsonObject toJson() const;
+
+    // 直方图各桶的上界（毫秒），最后一个桶没有上界
+    static const QVector<int> &gapBucketBounds();
+};
+
+/**
+ * @brief 请求计时日志
+ *
+ * 每个请求追加一行 JSON 到 metrics.jsonl，文件超过 1 MB 时轮转，
+ * 保留最近几个文件；同时在内存中保留最近的记录供统计面板使用。
+ */
+class MetricsLog : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MetricsLog(const QString &path, QObject *parent = nullptr);
+
+    void record(const RequestMetrics &metrics);
+    const QList<RequestMetrics> &recent() const { return recentMetrics; }
+
+signals:
+    void recorded(const RequestMetrics &metrics);
+
+private:
+    void rotate();
+
+    QString path;
+    QList<RequestMetrics> recentMetrics;
+};
+
+#endif // REQUESTMETRICS_H
@@ -0,0 +1,268 @@
+#include "requestscheduler.h"
+#include "chatengine.h"
+#include "chatstream.h"
+
+#include <QRandomGenerator>
+#include <QDebug>
+#include <cmath>
+
+namespace {
+
+// 没有单独设置的模型：每秒 2 个请求，最多连续 4 个
+const double kDefaultRate = 2.0;
+const int kDefaultBurst = 4;
+
+const int kDefaultMaxRetries = 4;
+const qint64 kBackoffBaseMs = 500;         // 第一次重试的退避时间
+const qint64 kBackoffCapMs = 30 * 1000;    // 退避时间上限
+
+// 收到 429 后速率最低降到设置值的这个比例，每次成功恢复这个倍数
+const double kMinRateFactor = 0.125;
+const double kRecoveryFactor = 1.25;
+
+} // namespace
+
+RequestScheduler::RequestScheduler(ChatEngine *engine, QObject *parent)
+    : QObject(parent)
+    , engine(engine)
+    , maxRetries(kDefaultMaxRetries)
+{
+    defaults.configuredRate = kDefaultRate;
+    defaults.rate = kDefaultRate;
+    defaults.burst = kDefaultBurst;
+    defaults.tokens = kDefaultBurst;
+    defaults.updatedMs = 0;
+    defaults.blockedUntilMs = 0;
+
+    timer.setSingleShot(true);
+    connect(&timer, &QTimer::timeout, this, &RequestScheduler::dispatch);
+    clock.start();
+}
+
+void RequestScheduler::setRateLimit(int model, double ratePerSecond, int burst)
+{
+    Bucket bucket;
+    bucket.configuredRate = qMax(0.0, ratePerSecond);
+    bucket.rate = bucket.configuredRate;
+    bucket.burst = qMax(1, burst);
+    bucket.tokens = bucket.burst;
+    bucket.updatedMs = clock.elapsed();
+    bucket.blockedUntilMs = 0;
+
+    if (model < 0) {
+        defaults = bucket;
+        // 已经按旧默认值建立的桶重新建立
+        for (QHash<int, Bucket>::iterator it = buckets.begin(); it != buckets.end();) {
+            if (configured.contains(it.key())) {
+                ++it;
+            } else {
+                it = buckets.erase(it);
+            }
+        }
+    } else {
+        configured.insert(model, bucket);
+        buckets.insert(model, bucket);
+    }
+}
+
+ChatStream *RequestScheduler::submit(qint64 conversationId, int model, const QByteArray &body,
+                                     Priority priority, QObject *parent)
+{
+    ChatStream *stream = new ChatStream(conversationId, model, engine->models().model(model).id, parent);
+
+    QPointer<RequestScheduler> self(this);
+    stream->setRetryHandler([self, stream]() {
+        return self && self->retry(stream);
+    });
+    connect(stream, &ChatStream::finished, this, [this, stream]() {
+        handleFinished(stream);
+    });
+    connect(stream, &QObject::destroyed, this, [this, stream]() {
+        forget(stream);
+    });
+
+    Pending pending;
+    pending.stream = stream;
+    pending.model = model;
+    pending.body = body;
+    pending.priority = priority;
+    pending.notBeforeMs = 0;
+    enqueue(pending);
+
+    // 网络回复的信号都是异步的，立即发出也不会错过调用方随后连接的信号
+    dispatch();
+    return stream;
+}
+
+void RequestScheduler::enqueue(const Pending &pending)
+{
+    int pos = queue.size();
+    while (pos > 0 && queue.at(pos - 1).priority < pending.priority) {
+        --pos;
+    }
+    queue.insert(pos, pending);
+}
+
+RequestScheduler::Bucket &RequestScheduler::bucketFor(int model)
+{
+    QHash<int, Bucket>::iterator it = buckets.find(model);
+    if (it == buckets.end()) {
+        Bucket bucket = defaults;
+        bucket.tokens = bucket.burst;
+        bucket.updatedMs = clock.elapsed();
+        it = buckets.insert(model, bucket);
+    }
+    return *it;
+}
+
+void RequestScheduler::refill(Bucket &bucket, qint64 now) const
+{
+    if (bucket.rate > 0) {
+        bucket.tokens = qMin(double(bucket.burst), bucket.tokens + (now - bucket.updatedMs) * bucket.rate / 1000.0);
+    }
+    bucket.updatedMs = now;
+}
+
+// 发出所有已经可以发出的请求，并把定时器设到下一个请求可以发出的时刻
+void RequestScheduler::dispatch()
+{
+    timer.stop();
+    const qint64 now = clock.elapsed();
+    qint64 wakeAt = -1;
+
+    for (int i = 0; i < queue.size();) {
+        if (!queue.at(i).stream) {
+            queue.removeAt(i);
+            continue;
+        }
+
+        Bucket &bucket = bucketFor(queue.at(i).model);
+        refill(bucket, now);
+        qint64 readyAt = qMax(queue.at(i).notBeforeMs, bucket.blockedUntilMs);
+        if (bucket.rate > 0 && bucket.tokens < 1) {
+            readyAt = qMax(readyAt, now + qint64(std::ceil((1 - bucket.tokens) * 1000.0 / bucket.rate)));
+        }
+        if (readyAt > now) {
+            wakeAt = wakeAt < 0 ? readyAt : qMin(wakeAt, readyAt);
+            ++i;
+            continue;
+        }
+
+        if (bucket.rate > 0) {
+            bucket.tokens -= 1;
+        }
+        Pending pending = queue.takeAt(i);
+        inFlight.insert(pending.stream, pending);
+        pending.stream->attach(engine->post(pending.model, pending.body));
+    }
+
+    if (wakeAt >= 0) {
+        timer.start(int(wakeAt - now));
+    }
+}
+
+// 在 ChatStream 处理失败的回复时调用，返回 true 表示已重新排队
+bool RequestScheduler::retry(ChatStream *stream)
+{
+    QHash<ChatStream *, Pending>::iterator it = inFlight.find(stream);
+    if (it == inFlight.end()) {
+        return false;
+    }
+
+    QString reason;
+    const int attempt = stream->metrics().retries + 1;
+    if (!isTransient(stream, &reason) || attempt > maxRetries) {
+        return false;
+    }
+
+    const qint64 now = clock.elapsed();
+    const qint64 retryAfter = stream->retryAfterMs();
+    const qint64 delay = retryAfter >= 0 ? retryAfter : backoffDelay(attempt);
+
+    Pending pending = it.value();
+    inFlight.erase(it);
+
+    // 被限流：这个模型整体暂停到 Retry-After 之后，并降低之后的发送速率
+    if (stream->metrics().httpStatus == 429) {
+        Bucket &bucket = bucketFor(pending.model);
+        bucket.blockedUntilMs = qMax(bucket.blockedUntilMs, now + delay);
+        if (bucket.configuredRate > 0) {
+            bucket.rate = qMax(bucket.configuredRate * kMinRateFactor, bucket.rate / 2);
+        }
+    }
+
+    pending.notBeforeMs = now + delay;
+    enqueue(pending);
+    qDebug() << "Retrying" << stream->metrics().model << "request in" << delay << "ms, attempt" << attempt << "-" << reason;
+    emit retryScheduled(stream, attempt, delay, reason);
+
+    // 流还在处理这次失败的回复，下一次事件循环再发出
+    timer.start(0);
+    return true;
+}
+
+bool RequestScheduler::isTransient(const ChatStream *stream, QString *reason) const
+{
+    const int status = stream->metrics().httpStatus;
+    if (status == 429 || status == 500 || status == 502 || status == 503 || status == 504) {
+        *reason = QStringLiteral("HTTP %1").arg(status);
+        return true;
+    }
+    // 压缩的请求体被拒绝，ChatEngine 已经关闭压缩，重发一次
+    if (status == 415 && stream->metrics().retries == 0) {
+        *reason = QStringLiteral("request encoding rejected");
+        return true;
+    }
+
+    switch (stream->networkError()) {
+    case QNetworkReply::NoError:
+        // 连接正常关闭却没有收到 [DONE]：回复中途断开
+        *reason = QStringLiteral("stream ended early");
+        return !stream->isDone() && status < 400;
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::ProxyConnectionClosedError:
+    case QNetworkReply::ProxyTimeoutError:
+    case QNetworkReply::UnknownNetworkError:
+        *reason = stream->errorString();
+        return true;
+    default:
+        // 用户中止、认证失败、请求本身有误等重试也没有用
+        return false;
+    }
+}
+
+// 带抖动的指数退避：在 [d/2, d] 之间随机，避免大量客户端同时重试
+qint64 RequestScheduler::backoffDelay(int attempt) const
+{
+    qint64 delay = kBackoffBaseMs << qMin(attempt - 1, 16);
+    delay = qMin(delay, kBackoffCapMs);
+    return delay / 2 + QRandomGenerator::global()->bounded(int(delay / 2) + 1);
+}
+
+void RequestScheduler::handleFinished(ChatStream *stream)
+{
+    QHash<ChatStream *, Pending>::iterator it = inFlight.find(stream);
+    if (it != inFlight.end() && stream->metrics().ok) {
+        // 成功后逐步恢复被 429 降低的速率
+        Bucket &bucket = bucketFor(it->model);
+        if (bucket.rate < bucket.configuredRate) {
+            bucket.rate = qMin(bucket.configuredRate, bucket.rate * kRecoveryFactor);
+        }
+    }
+    forget(stream);
+}
+
+// 流结束或被删除：不再重试，也不再留在队列中
+void RequestScheduler::forget(ChatStream *stream)
+{
+    inFlight.remove(stream);
+    for (int i = 0; i < queue.size(); ++i) {
+        if (queue.at(i).stream == stream || !queue.at(i).stream) {
+            queue.removeAt(i--);
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef REQUESTSCHEDULER_H
+#define REQUESTSCHEDULER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QTimer>
+#include <QElapsedTimer>
+
+class ChatEngine;
+class ChatStream;
+
+/**
+ * @brief 请求调度：按模型限速、按优先级排队，并自动重试暂时性的失败
+ *
+ * 每个模型一个令牌桶，桶空时请求留在队列中，轮到时再真正发出；同一模型内
+ * 优先级高的先发，同优先级先进先出，一个模型被限速不会挡住其它模型。
+ *
+ * HTTP 429/5xx、连接中断和回复中途断开都会重试：有 Retry-After 时按服务器
+ * 要求等待，否则按带随机抖动的指数退避。收到 429 时这个模型的发送速率减半，
+ * 之后每次成功逐步恢复。重试从头重新请求，流中已收到的部分内容会被丢弃。
+ */
+class RequestScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    enum Priority {
+        Background,                        // 批处理
+        Normal,                            // 多模型对比等
+        Interactive                        // 用户正在等待的回复
+    };
+
+    explicit RequestScheduler(ChatEngine *engine, QObject *parent = nullptr);
+
+    // 每秒最多 ratePerSecond 个请求，空闲时最多攒 burst 个；ratePerSecond 为 0 表示不限速。
+    // model 为 -1 时设置所有未单独设置的模型的默认值，应在提交请求之前调用
+    void setRateLimit(int model, double ratePerSecond, int burst);
+    // 每个请求最多重试的次数
+    void setMaxRetries(int retries) { maxRetries = retries; }
+
+    // 排队发送，返回的流立即可以连接信号；轮到时才发出网络请求。model 是 ModelRegistry 中的编号
+    ChatStream *submit(qint64 conversationId, int model, const QByteArray &body,
+                       Priority priority = Normal, QObject *parent = nullptr);
+    int queuedCount() const { return queue.size(); }
+
+signals:
+    // 请求失败，将在 delayMs 毫秒后第 attempt 次重试
+    void retryScheduled(ChatStream *stream, int attempt, qint64 delayMs, const QString &reason);
+
+private slots:
+    void dispatch();
+
+private:
+    struct Bucket {
+        double configuredRate;             // 设置的速率，0 表示不限
+        double rate;                       // 当前速率，收到 429 后降低
+        int burst;
+        double tokens;
+        qint64 updatedMs;
+        qint64 blockedUntilMs;             // Retry-After 期间整个模型暂停发送
+    };
+
+    struct Pending {
+        QPointer<ChatStream> stream;
+        int model;
+        QByteArray body;                   // 重试时原样重发
+        int priority;
+        qint64 notBeforeMs;                // 退避结束的时间
+    };
+
+    Bucket &bucketFor(int model);
+    void refill(Bucket &bucket, qint64 now) const;
+    void enqueue(const Pending &pending);
+    bool retry(ChatStream *stream);
+    bool isTransient(const ChatStream *stream, QString *reason) const;
+    qint64 backoffDelay(int attempt) const;
+    void handleFinished(ChatStream *stream);
+    void forget(ChatStream *stream);
+
+    ChatEngine *engine;
+    QList<Pending> queue;                  // 按优先级从高到低，同优先级先进先出
+    QHash<ChatStream *, Pending> inFlight; // 已发出、可能需要重试的请求
+    QHash<int, Bucket> buckets;
+    QHash<int, Bucket> configured;         // 单独设置过的模型
+    Bucket defaults;
+    int maxRetries;
+    QTimer timer;                          // 下一个请求可以发出的时刻
+    QElapsedTimer clock;
+};
+
+#endif // REQUESTSCHEDULER_H
@@ -0,0 +1,207 @@
+#include "responsecache.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+
+namespace {
+
+const qint64 kDefaultTtl = 7 * 24 * 3600;      // 一周后重新向模型提问
+const qint64 kDefaultMaxBytes = 8 * 1024 * 1024;
+const int kFlushDelayMs = 5000;                // 索引修改合并写入的延迟
+
+} // namespace
+
+ResponseCache::ResponseCache(const QString &directory, QObject *parent)
+    : QObject(parent)
+    , directory(directory)
+    , totalBytes(0)
+    , ttlSeconds(kDefaultTtl)
+    , maxBytes(kDefaultMaxBytes)
+    , hitCount(0)
+    , missCount(0)
+    , dirty(false)
+{
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(kFlushDelayMs);
+    connect(&flushTimer, &QTimer::timeout, this, &ResponseCache::flush);
+
+    QDir().mkpath(directory);
+    loadIndex();
+}
+
+ResponseCache::~ResponseCache()
+{
+    flush();
+}
+
+void ResponseCache::flush()
+{
+    flushTimer.stop();
+    if (dirty) {
+        dirty = false;
+        saveIndex();
+    }
+}
+
+// 索引只在内存中修改，定时器到期时一次写入
+void ResponseCache::markDirty()
+{
+    dirty = true;
+    if (!flushTimer.isActive()) {
+        flushTimer.start();
+    }
+}
+
+QString ResponseCache::pathFor(const QByteArray &key) const
+{
+    return directory + "/" + QString::fromLatin1(key) + ".sse";
+}
+
+bool ResponseCache::lookup(const QByteArray &key, QByteArray *stream)
+{
+    QHash<QByteArray, Item>::iterator it = items.find(key);
+    bool hit = false;
+    if (it != items.end()) {
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        if (it->created.secsTo(now) > ttlSeconds) {
+            remove(key); // 过期
+            markDirty();
+        } else {
+            QFile file(pathFor(key));
+            if (file.open(QIODevice::ReadOnly)) {
+                *stream = file.readAll();
+                it->lastUsed = now;
+                markDirty();
+                hit = true;
+            } else {
+                remove(key); // 文件丢失，索引跟着删除
+                markDirty();
+            }
+        }
+    }
+
+    if (hit) {
+        ++hitCount;
+    } else {
+        ++missCount;
+    }
+    emit statsChanged();
+    return hit;
+}
+
+void ResponseCache::insert(const QByteArray &key, const QByteArray &stream)
+{
+    if (stream.isEmpty() || stream.size() > maxBytes) {
+        return;
+    }
+
+    // 先写临时文件再改名，写到一半退出时不会留下半个条目
+    QSaveFile file(pathFor(key));
+    if (!file.open(QIODevice::WriteOnly) || file.write(stream) != stream.size() || !file.commit()) {
+        qDebug() << "Failed to write response cache entry.";
+        return;
+    }
+
+    if (items.contains(key)) {
+        totalBytes -= items.value(key).size;
+    }
+    Item item;
+    item.created = QDateTime::currentDateTimeUtc();
+    item.lastUsed = item.created;
+    item.size = stream.size();
+    items.insert(key, item);
+    totalBytes += item.size;
+
+    evict();
+    markDirty();
+}
+
+void ResponseCache::remove(const QByteArray &key)
+{
+    QHash<QByteArray, Item>::iterator it = items.find(key);
+    if (it == items.end()) {
+        return;
+    }
+    totalBytes -= it->size;
+    items.erase(it);
+    QFile::remove(pathFor(key));
+}
+
+// 先删过期的条目，再按最近使用时间从旧到新删，直到总大小不超过上限
+void ResponseCache::evict()
+{
+    QDateTime now = QDateTime::currentDateTimeUtc();
+    QList<QByteArray> expired;
+    for (QHash<QByteArray, Item>::const_iterator it = items.constBegin(); it != items.constEnd(); ++it) {
+        if (it->created.secsTo(now) > ttlSeconds) {
+            expired.append(it.key());
+        }
+    }
+    for (const QByteArray &key : expired) {
+        remove(key);
+    }
+
+    while (totalBytes > maxBytes && !items.isEmpty()) {
+        QHash<QByteArray, Item>::const_iterator oldest = items.constBegin();
+        for (QHash<QByteArray, Item>::const_iterator it = items.constBegin(); it != items.constEnd(); ++it) {
+            if (it->lastUsed < oldest->lastUsed) {
+                oldest = it;
+            }
+        }
+        remove(oldest.key());
+    }
+}
+
+void ResponseCache::loadIndex()
+{
+    QFile file(directory + "/index.json");
+    const QJsonArray array = file.open(QIODevice::ReadOnly)
+        ? QJsonDocument::fromJson(file.readAll()).array() : QJsonArray();
+    for (const QJsonValue &value : array) {
+        QJsonObject obj = value.toObject();
+        QByteArray key = obj["key"].toString().toLatin1();
+        Item item;
+        item.created = QDateTime::fromString(obj["created"].toString(), Qt::ISODate);
+        item.lastUsed = QDateTime::fromString(obj["lastUsed"].toString(), Qt::ISODate);
+        item.size = qint64(obj["size"].toDouble());
+        if (key.isEmpty() || !item.created.isValid() || !QFile::exists(pathFor(key))) {
+            continue;
+        }
+        items.insert(key, item);
+        totalBytes += item.size;
+    }
+
+    // 索引中没有的条目文件不会再被用到，也不计入总大小，直接删除
+    const QStringList files = QDir(directory).entryList(QStringList() << "*.sse", QDir::Files);
+    for (const QString &name : files) {
+        if (!items.contains(name.left(name.size() - 4).toLatin1())) {
+            QFile::remove(directory + "/" + name);
+        }
+    }
+    evict();
+}
+
+void ResponseCache::saveIndex()
+{
+    QJsonArray array;
+    for (QHash<QByteArray, Item>::const_iterator it = items.constBegin(); it != items.constEnd(); ++it) {
+        QJsonObject obj;
+        obj["key"] = QString::fromLatin1(it.key());
+        obj["created"] = it->created.toString(Qt::ISODate);
+        obj["lastUsed"] = it->lastUsed.toString(Qt::ISODate);
+        obj["size"] = it->size;
+        array.append(obj);
+    }
+
+    // 整体替换索引文件，写入中途退出时保留上一次的索引
+    QSaveFile file(directory + "/index.json");
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(array).toJson(QJsonDocument::Compact)) < 0
+        || !file.commit()) {
+        qDebug() << "Failed to save response cache index.";
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef RESPONSECACHE_H
+#define RESPONSECACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QDateTime>
+#include <QTimer>
+
+/**
+ * @brief 本地回复缓存
+ *
+ * 以 模型 + 系统提示词 + 规范化后的最近几条消息 的哈希为键，保存完整的流式
+ * 回复（SSE 数据）。重复的问题直接用缓存的数据走一遍正常的解析流程，不再
+ * 请求接口。每个条目一个文件，外加一个记录创建/使用时间和大小的索引；
+ * 条目过期（TTL）后失效，总大小超过上限时按最近最少使用淘汰。条目和索引都先写
+ * 临时文件再改名，中途退出不会留下半个文件；索引中没有的条目文件启动时删除。
+ *
+ * 索引在内存中修改，稍后由定时器合并写入，析构时写入剩下的修改，
+ * 命中缓存时不在界面线程上重写索引文件。
+ */
+class ResponseCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ResponseCache(const QString &directory, QObject *parent = nullptr);
+    ~ResponseCache();
+
+    // 命中时把缓存的 SSE 数据写入 *stream 并返回 true
+    bool lookup(const QByteArray &key, QByteArray *stream);
+    // 保存一次完整的回复
+    void insert(const QByteArray &key, const QByteArray &stream);
+
+    int hits() const { return hitCount; }
+    int misses() const { return missCount; }
+
+    void setTimeToLive(qint64 seconds) { ttlSeconds = seconds; }
+    void setMaxBytes(qint64 bytes) { maxBytes = bytes; }
+
+    // 立即写入还没有保存的索引修改
+    void flush();
+
+signals:
+    // 命中/未命中计数有变化
+    void statsChanged();
+
+private:
+    struct Item {
+        QDateTime created;
+        QDateTime lastUsed;
+        qint64 size;
+    };
+
+    void loadIndex();
+    void saveIndex();
+    void markDirty();
+    void remove(const QByteArray &key);
+    void evict();
+    QString pathFor(const QByteArray &key) const;
+
+    QString directory;
+    QHash<QByteArray, Item> items;         // 键为哈希的十六进制串
+    qint64 totalBytes;
+    qint64 ttlSeconds;
+    qint64 maxBytes;
+    int hitCount;
+    int missCount;
+    bool dirty;                            // 索引有还没写入文件的修改
+    QTimer flushTimer;
+};
+
+#endif // RESPONSECACHE_H
@@ -0,0 +1,158 @@
+#include "searchdialog.h"
+#include "searchindex.h"
+#include "conversationstore.h"
+
+#include <QLineEdit>
+#include <QLabel>
+#include <QListWidget>
+#include <QVBoxLayout>
+#include <QScrollBar>
+#include <QElapsedTimer>
+
+namespace {
+
+const int kConversationIdRole = Qt::UserRole;
+const int kMessageIndexRole = Qt::UserRole + 1;
+const int kSnippetLength = 80;
+const int kSearchDelayMs = 150;        // 输入停顿这么久才查询
+
+// 从第一个查询词附近截取一段摘要
+QString snippetFor(const QString &content, const QString &query)
+{
+    QString text = content.simplified();
+    QString first = query.simplified().section(' ', 0, 0).remove('"');
+    int at = first.isEmpty() ? -1 : text.indexOf(first, 0, Qt::CaseInsensitive);
+    int start = qMax(0, at - kSnippetLength / 4);
+    QString snippet = text.mid(start, kSnippetLength);
+    if (start > 0) {
+        snippet.prepend(QStringLiteral("…"));
+    }
+    if (start + kSnippetLength < text.size()) {
+        snippet.append(QStringLiteral("…"));
+    }
+    return snippet;
+}
+
+} // namespace
+
+SearchDialog::SearchDialog(const SearchIndex *index, ConversationStore *store, QWidget *parent)
+    : QDialog(parent)
+    , index(index)
+    , store(store)
+{
+    setAttribute(Qt::WA_DeleteOnClose);
+    setWindowTitle(tr("搜索聊天记录"));
+    resize(520, 600);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    queryEdit = new QLineEdit(this);
+    queryEdit->setPlaceholderText(tr("输入关键词，加引号按短语搜索"));
+    queryEdit->setClearButtonEnabled(true);
+    layout->addWidget(queryEdit);
+
+    statusLabel = new QLabel(this);
+    layout->addWidget(statusLabel);
+
+    results = new QListWidget(this);
+    results->setWordWrap(true);
+    results->setAlternatingRowColors(true);
+    layout->addWidget(results, 1);
+
+    searchTimer.setSingleShot(true);
+    searchTimer.setInterval(kSearchDelayMs);
+    connect(&searchTimer, &QTimer::timeout, this, &SearchDialog::runSearch);
+    connect(queryEdit, &QLineEdit::textChanged, [this]() {
+        searchTimer.start();
+    });
+    connect(queryEdit, &QLineEdit::returnPressed, [this]() {
+        // 还没来得及查询的输入先查询
+        if (searchTimer.isActive()) {
+            runSearch();
+        }
+        activateItem(results->currentItem() ? results->currentItem() : results->item(0));
+    });
+    connect(results, &QListWidget::itemActivated, this, &SearchDialog::activateItem);
+    connect(results->verticalScrollBar(), &QScrollBar::valueChanged, this, &SearchDialog::requestVisibleSnippets);
+    connect(store, &ConversationStore::messagesLoaded, this, &SearchDialog::fillSnippets);
+
+    statusLabel->setText(tr("共 %1 条消息").arg(index->documentCount()));
+}
+
+void SearchDialog::runSearch()
+{
+    searchTimer.stop();
+    const QString query = queryEdit->text();
+    currentQuery = query;
+    requested.clear();
+    results->clear();
+    if (query.trimmed().isEmpty()) {
+        statusLabel->setText(tr("共 %1 条消息").arg(index->documentCount()));
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const QVector<SearchIndex::Hit> hits = index->search(query);
+    qint64 searchUs = timer.nsecsElapsed() / 1000;
+
+    // 先列出标题，摘要等消息读入后再填
+    for (const SearchIndex::Hit &hit : hits) {
+        QListWidgetItem *item = new QListWidgetItem(results);
+        item->setText(store->title(hit.conversationId) + QStringLiteral("\n…"));
+        item->setData(kConversationIdRole, hit.conversationId);
+        item->setData(kMessageIndexRole, hit.messageIndex);
+    }
+
+    statusLabel->setText(tr("%1 条结果，用时 %2 ms").arg(hits.size()).arg(searchUs / 1000.0, 0, 'f', 2));
+    if (results->count() > 0) {
+        results->setCurrentRow(0);
+    }
+
+    // 等列表排好版再看哪些结果显示出来了
+    QTimer::singleShot(0, this, &SearchDialog::requestVisibleSnippets);
+}
+
+// 只为当前能看到的结果读取消息，每个会话每次查询最多请求一次
+void SearchDialog::requestVisibleSnippets()
+{
+    const QRect area = results->viewport()->rect();
+    int row = qMax(0, results->indexAt(area.topLeft()).row());
+    for (; row < results->count(); ++row) {
+        QListWidgetItem *item = results->item(row);
+        if (results->visualItemRect(item).top() > area.bottom()) {
+            break;
+        }
+        qint64 id = item->data(kConversationIdRole).toLongLong();
+        if (!requested.contains(id)) {
+            requested.insert(id);
+            store->requestMessages(id);
+        }
+    }
+}
+
+void SearchDialog::fillSnippets(qint64 conversationId, const QList<QJsonObject> &messages)
+{
+    for (int row = 0; row < results->count(); ++row) {
+        QListWidgetItem *item = results->item(row);
+        if (item->data(kConversationIdRole).toLongLong() != conversationId) {
+            continue;
+        }
+        int index = item->data(kMessageIndexRole).toInt();
+        if (index >= messages.size()) {
+            continue;
+        }
+        const QJsonObject &message = messages.at(index);
+        QString who = message["role"].toString() == "user" ? tr("我") : tr("AI");
+        item->setText(QString("%1 · %2\n%3").arg(store->title(conversationId), who,
+                                                  snippetFor(message["content"].toString(), currentQuery)));
+    }
+}
+
+void SearchDialog::activateItem(QListWidgetItem *item)
+{
+    if (!item) {
+        return;
+    }
+    emit messageActivated(item->data(kConversationIdRole).toLongLong(), item->data(kMessageIndexRole).toInt());
+}
@@ -0,0 +1,51 @@
+#ifndef SEARCHDIALOG_H
+#define SEARCHDIALOG_H
+
+#include <QDialog>
+#include <QJsonObject>
+#include <QTimer>
+#include <QSet>
+
+class QLineEdit;
+class QLabel;
+class QListWidget;
+class QListWidgetItem;
+class SearchIndex;
+class ConversationStore;
+
+/**
+ * @brief 聊天记录搜索窗口
+ *
+ * 边输入边查询（停顿片刻后才查询），结果按相关度排列，显示会话标题和消息
+ * 摘要。摘要只为显示出来的结果读取消息，滚动到的结果再补上，不会为了一次
+ * 查询把所有命中的会话都读一遍；双击或回车跳转到对应会话的那条消息。
+ */
+class SearchDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    SearchDialog(const SearchIndex *index, ConversationStore *store, QWidget *parent = nullptr);
+
+signals:
+    void messageActivated(qint64 conversationId, int messageIndex);
+
+public slots:
+    void runSearch();
+
+private slots:
+    void activateItem(QListWidgetItem *item);
+    void fillSnippets(qint64 conversationId, const QList<QJsonObject> &messages);
+    void requestVisibleSnippets();
+
+private:
+    const SearchIndex *index;
+    ConversationStore *store;
+    QLineEdit *queryEdit;
+    QLabel *statusLabel;
+    QListWidget *results;
+    QString currentQuery;
+    QTimer searchTimer;                    // 输入停顿后再查询
+    QSet<qint64> requested;                // 这次查询已经请求过消息的会话
+};
+
+#endif // SEARCHDIALOG_H
@@ -0,0 +1,321 @@
+#include "searchindex.h"
+
+#include <QStringList>
+#include <QtMath>
+#include <algorithm>
+
+namespace {
+
+// 汉字、日文假名、韩文等按字切分的文字
+bool isCjk(ushort u)
+{
+    return (u >= 0x3040 && u <= 0x30FF)      // 平假名、片假名
+        || (u >= 0x3400 && u <= 0x4DBF)      // 扩展 A
+        || (u >= 0x4E00 && u <= 0x9FFF)      // 基本汉字
+        || (u >= 0xAC00 && u <= 0xD7AF)      // 韩文
+        || (u >= 0xF900 && u <= 0xFAFF);     // 兼容汉字
+}
+
+bool containsPosition(const QVector<int> &positions, int begin, int end, int position)
+{
+    QVector<int>::const_iterator first = positions.constBegin() + begin;
+    QVector<int>::const_iterator last = positions.constBegin() + end;
+    QVector<int>::const_iterator it = std::lower_bound(first, last, position);
+    return it != last && *it == position;
+}
+
+const double kBm25K = 1.2;
+const double kBm25B = 0.75;
+
+} // namespace
+
+SearchIndex::SearchIndex()
+    : totalLength(0)
+{
+}
+
+// forQuery 为 true 时，长度不小于 2 的汉字串不输出最后的单字：它已经是
+// 前一个二元词的第二个字，查询时再要求它单独成词反而匹配不到
+QVector<SearchIndex::Token> SearchIndex::tokenize(const QString &text, bool forQuery)
+{
+    QVector<Token> tokens;
+    int position = 0;
+    int i = 0;
+    const int n = text.size();
+    while (i < n) {
+        QChar ch = text.at(i);
+        if (isCjk(ch.unicode())) {
+            int start = i;
+            while (i < n && isCjk(text.at(i).unicode())) {
+                ++i;
+            }
+            int length = i - start;
+            for (int k = 0; k + 1 < length; ++k) {
+                Token token;
+                token.term = text.mid(start + k, 2);
+                token.position = position + k;
+                tokens.append(token);
+            }
+            if (length == 1 || !forQuery) {
+                Token token;
+                token.term = text.mid(start + length - 1, 1);
+                token.position = position + length - 1;
+                tokens.append(token);
+            }
+            position += length;
+        } else if (ch.isLetterOrNumber()) {
+            int start = i;
+            while (i < n && text.at(i).isLetterOrNumber() && !isCjk(text.at(i).unicode())) {
+                ++i;
+            }
+            Token token;
+            token.term = text.mid(start, i - start).toLower();
+            token.position = position++;
+            tokens.append(token);
+        } else {
+            ++i; // 空白和标点只分隔词，不占位置
+        }
+    }
+    return tokens;
+}
+
+void SearchIndex::addMessage(qint64 conversationId, int messageIndex, const QString &text)
+{
+    const int doc = docs.size();
+    const QVector<Token> tokens = tokenize(text, false);
+
+    Doc d;
+    d.conversationId = conversationId;
+    d.messageIndex = messageIndex;
+    d.length = tokens.size();
+    docs.append(d);
+    totalLength += d.length;
+
+    // 同一个词在一个文档中的位置要连续存放，先按词归并
+    QHash<int, QVector<int> > local;
+    for (const Token &token : tokens) {
+        QMap<QString, int>::iterator it = termIds.find(token.term);
+        if (it == termIds.end()) {
+            it = termIds.insert(token.term, postings.size());
+            postings.append(Postings());
+        }
+        local[it.value()].append(token.position);
+    }
+
+    for (QHash<int, QVector<int> >::const_iterator it = local.constBegin(); it != local.constEnd(); ++it) {
+        Postings &p = postings[it.key()];
+        p.docs.append(doc);
+        p.posStart.append(p.positions.size());
+        p.positions += it.value();
+    }
+}
+
+void SearchIndex::removeConversation(qint64 conversationId)
+{
+    removed.insert(conversationId);
+}
+
+void SearchIndex::clear()
+{
+    docs.clear();
+    termIds.clear();
+    postings.clear();
+    removed.clear();
+    totalLength = 0;
+}
+
+const SearchIndex::Postings *SearchIndex::postingsFor(const QString &term) const
+{
+    QMap<QString, int>::const_iterator it = termIds.constFind(term);
+    return it == termIds.constEnd() ? nullptr : &postings.at(it.value());
+}
+
+// 所有词按顺序出现在相邻位置的文档，词频为短语出现的次数
+SearchIndex::Matches SearchIndex::matchPhrase(const QVector<Token> &tokens) const
+{
+    Matches matches;
+    QVector<const Postings *> lists;
+    int rarest = 0;
+    for (int i = 0; i < tokens.size(); ++i) {
+        const Postings *p = postingsFor(tokens.at(i).term);
+        if (!p) {
+            return matches;
+        }
+        lists.append(p);
+        if (p->docs.size() < lists.at(rarest)->docs.size()) {
+            rarest = i;
+        }
+    }
+
+    // 从最短的倒排表出发，在其它表中二分查找同一文档
+    const Postings *base = lists.at(rarest);
+    QVector<int> cursor(lists.size());
+    for (int k = 0; k < base->docs.size(); ++k) {
+        int doc = base->docs.at(k);
+        bool inAll = true;
+        for (int i = 0; i < lists.size() && inAll; ++i) {
+            const QVector<int> &docList = lists.at(i)->docs;
+            QVector<int>::const_iterator it = std::lower_bound(docList.constBegin(), docList.constEnd(), doc);
+            inAll = it != docList.constEnd() && *it == doc;
+            cursor[i] = int(it - docList.constBegin());
+        }
+        if (!inAll) {
+            continue;
+        }
+
+        // 以最短表中的每个位置推算短语起点，检查其它词是否在对应位置
+        int tf = 0;
+        int offset = tokens.at(rarest).position - tokens.at(0).position;
+        for (int pi = base->posStart.at(k); pi < base->positionsEnd(k); ++pi) {
+            int start = base->positions.at(pi) - offset;
+            bool adjacent = true;
+            for (int i = 0; i < lists.size() && adjacent; ++i) {
+                if (i == rarest) {
+                    continue;
+                }
+                const Postings *p = lists.at(i);
+                int want = start + tokens.at(i).position - tokens.at(0).position;
+                adjacent = containsPosition(p->positions, p->posStart.at(cursor[i]), p->positionsEnd(cursor[i]), want);
+            }
+            if (adjacent) {
+                ++tf;
+            }
+        }
+        if (tf > 0) {
+            matches.insert(doc, tf);
+        }
+    }
+    return matches;
+}
+
+// 以 prefix 开头的所有词出现的文档，词频为这些词出现次数之和
+SearchIndex::Matches SearchIndex::matchPrefix(const QString &prefix) const
+{
+    Matches matches;
+    for (QMap<QString, int>::const_iterator it = termIds.lowerBound(prefix);
+         it != termIds.constEnd() && it.key().startsWith(prefix); ++it) {
+        const Postings &p = postings.at(it.value());
+        for (int k = 0; k < p.docs.size(); ++k) {
+            matches[p.docs.at(k)] += p.positionsEnd(k) - p.posStart.at(k);
+        }
+    }
+    return matches;
+}
+
+// 单个汉字总是按前缀匹配；输入框末尾、没有加引号的英文单词也按前缀匹配
+SearchIndex::Matches SearchIndex::matchClause(const QString &clause, bool trailing) const
+{
+    QVector<Token> tokens = tokenize(clause, true);
+    if (tokens.isEmpty()) {
+        return Matches();
+    }
+
+    const Token &last = tokens.last();
+    bool singleCjk = last.term.size() == 1 && isCjk(last.term.at(0).unicode());
+    if (tokens.size() == 1 && (singleCjk || trailing)) {
+        return matchPrefix(last.term);
+    }
+    if (trailing && !isCjk(last.term.at(0).unicode())) {
+        // 前面的部分按短语匹配，最后一个单词按前缀过滤
+        Matches prefix = matchPrefix(last.term);
+        tokens.removeLast();
+        Matches phrase = matchPhrase(tokens);
+        Matches both;
+        for (Matches::const_iterator it = phrase.constBegin(); it != phrase.constEnd(); ++it) {
+            if (prefix.contains(it.key())) {
+                both.insert(it.key(), it.value());
+            }
+        }
+        return both;
+    }
+    return matchPhrase(tokens);
+}
+
+QVector<SearchIndex::Hit> SearchIndex::search(const QString &query, int limit) const
+{
+    // 按空白分成多个条件，引号内的内容是一个条件
+    QStringList clauses;
+    QVector<bool> quoted;
+    QString current;
+    bool inQuote = false;
+    for (QChar ch : query) {
+        if (ch == QLatin1Char('"') || ch == QChar(0x201C) || ch == QChar(0x201D)) {
+            if (!current.isEmpty()) {
+                clauses.append(current);
+                quoted.append(inQuote);
+                current.clear();
+            }
+            inQuote = !inQuote;
+        } else if (ch.isSpace() && !inQuote) {
+            if (!current.isEmpty()) {
+                clauses.append(current);
+                quoted.append(false);
+                current.clear();
+            }
+        } else {
+            current.append(ch);
+        }
+    }
+    bool trailingOpen = !current.isEmpty() && !inQuote;
+    if (!current.isEmpty()) {
+        clauses.append(current);
+        quoted.append(inQuote);
+    }
+    if (clauses.isEmpty() || docs.isEmpty()) {
+        return QVector<Hit>();
+    }
+
+    // 各条件取交集，得分为各条件的 BM25 之和
+    const double n = docs.size();
+    const double avgLength = qMax(1.0, double(totalLength) / n);
+    QHash<int, double> scores;
+    for (int c = 0; c < clauses.size(); ++c) {
+        bool trailing = c == clauses.size() - 1 && trailingOpen && !quoted.at(c);
+        Matches matches = matchClause(clauses.at(c), trailing);
+        if (matches.isEmpty()) {
+            return QVector<Hit>();
+        }
+
+        double idf = qLn(1.0 + (n - matches.size() + 0.5) / (matches.size() + 0.5));
+        QHash<int, double> next;
+        for (Matches::const_iterator it = matches.constBegin(); it != matches.constEnd(); ++it) {
+            if (c > 0 && !scores.contains(it.key())) {
+                continue;
+            }
+            double tf = it.value();
+            double norm = 1.0 - kBm25B + kBm25B * docs.at(it.key()).length / avgLength;
+            next.insert(it.key(), scores.value(it.key()) + idf * tf * (kBm25K + 1) / (tf + kBm25K * norm));
+        }
+        scores.swap(next);
+        if (scores.isEmpty()) {
+            return QVector<Hit>();
+        }
+    }
+
+    QVector<QPair<double, int> > ranked;
+    ranked.reserve(scores.size());
+    for (QHash<int, double>::const_iterator it = scores.constBegin(); it != scores.constEnd(); ++it) {
+        if (!removed.contains(docs.at(it.key()).conversationId)) {
+            ranked.append(qMakePair(it.value(), it.key()));
+        }
+    }
+
+    // 只对前 limit 条排序；得分相同时较新的消息在前
+    int count = qMin(limit, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(),
+                      [](const QPair<double, int> &a, const QPair<double, int> &b) {
+        return a.first != b.first ? a.first > b.first : a.second > b.second;
+    });
+
+    QVector<Hit> hits;
+    hits.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const Doc &d = docs.at(ranked.at(i).second);
+        Hit hit;
+        hit.conversationId = d.conversationId;
+        hit.messageIndex = d.messageIndex;
+        hit.score = ranked.at(i).first;
+        hits.append(hit);
+    }
+    return hits;
+}
@@ -0,0 +1,78 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QString>
+#include <QVector>
+#include <QMap>
+#include <QHash>
+#include <QSet>
+
+/**
+ * @brief 聊天记录的全文倒排索引
+ *
+ * 每条消息是一个文档。中文按相邻两个字切成二元词，每段连续汉字的最后一个字
+ * 再单独作为一个词，这样第 i 个字总是位置 i 上那个词的第一个字；英文和数字
+ * 按整个单词（小写）作为一个词。每个词记录出现的文档和位置，因此可以做：
+ *  - 短语查询：连续的汉字或加引号的内容要求各词位置相邻；
+ *  - 前缀查询：输入框里最后一个英文单词或单个汉字按前缀匹配，边输入边出结果。
+ *
+ * 文档编号按添加顺序递增，倒排表天然有序，求交时从最短的表开始。
+ * 新消息直接追加，删除会话只做标记，不重建索引。
+ */
+class SearchIndex
+{
+public:
+    struct Hit {
+        qint64 conversationId;
+        int messageIndex;                  // 消息在会话中的序号
+        double score;
+    };
+
+    SearchIndex();
+
+    void addMessage(qint64 conversationId, int messageIndex, const QString &text);
+    void removeConversation(qint64 conversationId);
+    void clear();
+
+    // 按相关度从高到低返回最多 limit 条结果
+    QVector<Hit> search(const QString &query, int limit = 50) const;
+
+    int documentCount() const { return docs.size(); }
+
+private:
+    struct Token {
+        QString term;
+        int position;
+    };
+
+    struct Doc {
+        qint64 conversationId;
+        int messageIndex;
+        int length;                        // 词数，用于长度归一化
+    };
+
+    // 一个词的倒排表：docs 递增；第 k 个文档的位置为 positions[posStart[k] .. posStart[k+1])
+    struct Postings {
+        QVector<int> docs;
+        QVector<int> posStart;
+        QVector<int> positions;
+        int positionsEnd(int k) const { return k + 1 < posStart.size() ? posStart[k + 1] : positions.size(); }
+    };
+
+    // 一个查询条件匹配到的文档：文档编号 -> 词频
+    typedef QHash<int, int> Matches;
+
+    static QVector<Token> tokenize(const QString &text, bool forQuery);
+    Matches matchPhrase(const QVector<Token> &tokens) const;
+    Matches matchClause(const QString &clause, bool trailing) const;
+    Matches matchPrefix(const QString &prefix) const;
+    const Postings *postingsFor(const QString &term) const;
+
+    QVector<Doc> docs;
+    QMap<QString, int> termIds;            // 有序，便于前缀查找
+    QVector<Postings> postings;
+    QSet<qint64> removed;                  // 已删除的会话
+    qint64 totalLength;                    // 所有文档的词数之和
+};
+
+#endif // SEARCHINDEX_H
@@ -0,0 +1,172 @@
+#include "sseparser.h"
+
+#include <QIODevice>
+#include <cstring>
+
+SseParser::SseParser()
+{
+    reset();
+}
+
+void SseParser::setEventHandler(const EventHandler &eventHandler)
+{
+    handler = eventHandler;
+}
+
+qint64 SseParser::readFrom(QIODevice *device)
+{
+    qint64 available = device->bytesAvailable();
+    if (available <= 0) {
+        return 0;
+    }
+
+    // 直接读到缓冲区末尾，省去 readAll() 的临时 QByteArray
+    compact();
+    int oldSize = buffer.size();
+    buffer.resize(oldSize + int(available));
+    qint64 got = device->read(buffer.data() + oldSize, available);
+    got = qMax<qint64>(got, 0);
+    buffer.resize(oldSize + int(got));
+    parse();
+    return got;
+}
+
+void SseParser::feed(const char *data, int size)
+{
+    compact();
+    buffer.append(data, size);
+    parse();
+}
+
+void SseParser::finish()
+{
+    if (readPos < buffer.size()) {
+        processLine(buffer.constData() + readPos, buffer.size() - readPos);
+        readPos = scanPos = buffer.size();
+    }
+    dispatch();
+}
+
+void SseParser::reset()
+{
+    buffer.resize(0);
+    readPos = 0;
+    scanPos = 0;
+    skipLineFeed = false;
+    hasData = false;
+    dataPtr = nullptr;
+    dataSize = 0;
+    ownedData.resize(0);
+    dataOwned = false;
+    eventType.clear();
+    lastEventId.clear();
+    retry = -1;
+}
+
+// 把未消费的半行移到缓冲区开头，通常只有几十个字节
+void SseParser::compact()
+{
+    if (readPos == 0) {
+        return;
+    }
+    buffer.remove(0, readPos);
+    scanPos -= readPos;
+    readPos = 0;
+}
+
+void SseParser::parse()
+{
+    const char *base = buffer.constData();
+    const int size = buffer.size();
+
+    int pos = scanPos;
+    while (pos < size) {
+        char ch = base[pos];
+        if (ch != '\n' && ch != '\r') {
+            ++pos;
+            continue;
+        }
+
+        if (ch == '\n' && skipLineFeed && pos == readPos) {
+            // \r\n 中的 \n，前一行已经处理过
+            skipLineFeed = false;
+            readPos = ++pos;
+            continue;
+        }
+
+        skipLineFeed = ch == '\r';
+        processLine(base + readPos, pos - readPos);
+        readPos = ++pos;
+    }
+    scanPos = pos;
+
+    // 事件跨越了数据块：缓冲区下次会被移动，先把 data 拷贝出来
+    if (hasData && !dataOwned) {
+        ownedData = QByteArray(dataPtr, dataSize);
+        dataOwned = true;
+    }
+}
+
+void SseParser::processLine(const char *line, int length)
+{
+    if (length == 0) {
+        dispatch(); // 空行表示一个事件结束
+        return;
+    }
+    if (line[0] == ':') {
+        return; // 注释行
+    }
+
+    const char *colon = static_cast<const char *>(memchr(line, ':', size_t(length)));
+    int fieldLength = colon ? int(colon - line) : length;
+    const char *value = colon ? colon + 1 : line + length;
+    int valueLength = length - int(value - line);
+    if (valueLength > 0 && value[0] == ' ') {
+        ++value;
+        --valueLength;
+    }
+
+    if (fieldLength == 4 && memcmp(line, "data", 4) == 0) {
+        if (!hasData) {
+            hasData = true;
+            dataPtr = value;
+            dataSize = valueLength;
+            dataOwned = false;
+        } else {
+            // 多行 data 用换行连接
+            if (!dataOwned) {
+                ownedData = QByteArray(dataPtr, dataSize);
+                dataOwned = true;
+            }
+            ownedData.append('\n');
+            ownedData.append(value, valueLength);
+        }
+    } else if (fieldLength == 5 && memcmp(line, "event", 5) == 0) {
+        eventType = QByteArray(value, valueLength);
+    } else if (fieldLength == 2 && memcmp(line, "id", 2) == 0) {
+        lastEventId = QByteArray(value, valueLength);
+    } else if (fieldLength == 5 && memcmp(line, "retry", 5) == 0) {
+        bool ok = false;
+        int interval = QByteArray::fromRawData(value, valueLength).toInt(&ok);
+        if (ok) {
+            retry = interval;
+        }
+    }
+}
+
+void SseParser::dispatch()
+{
+    if (hasData && handler) {
+        Event event;
+        event.type = eventType.isEmpty() ? QByteArray("message") : eventType;
+        event.id = lastEventId;
+        event.data = dataOwned ? ownedData.constData() : dataPtr;
+        event.size = dataOwned ? ownedData.size() : dataSize;
+        handler(event);
+    }
+
+    hasData = false;
+    dataOwned = false;
+    ownedData.resize(0);
+    eventType.clear();
+}
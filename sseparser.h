@@ -0,0 +1,72 @@
+#ifndef SSEPARSER_H
+#define SSEPARSER_H
+
+#include <QByteArray>
+#include <functional>
+
+class QIODevice;
+
+/**
+ * @brief 增量 Server-Sent Events 解析器
+ *
+ * 数据直接读入内部缓冲区，用游标记录已消费的位置，不再每行 remove 一次；
+ * 每次读入前只把未消费的半行移到缓冲区开头。支持多行 data、event、id、
+ * retry、注释行以及 \n、\r\n、\r 三种换行。
+ *
+ * 事件的 data 以指针 + 长度的形式交给回调，通常直接指向缓冲区，
+ * 只在回调执行期间有效。
+ */
+class SseParser
+{
+public:
+    struct Event {
+        QByteArray type;                   // event 字段，缺省为 "message"
+        QByteArray id;                     // 最近一次的 id 字段
+        const char *data;                  // 事件数据，不含结尾换行
+        int size;
+
+        // 不拷贝数据的 QByteArray 视图
+        QByteArray dataView() const { return QByteArray::fromRawData(data, size); }
+    };
+
+    typedef std::function<void(const Event &)> EventHandler;
+
+    SseParser();
+
+    void setEventHandler(const EventHandler &handler);
+
+    // 从设备读取全部可用数据并解析，返回读到的字节数
+    qint64 readFrom(QIODevice *device);
+    // 解析一段数据
+    void feed(const char *data, int size);
+    // 流结束：处理没有换行结尾的最后一行和未分发的事件
+    void finish();
+    // 清空状态，准备解析新的流
+    void reset();
+
+    int retryInterval() const { return retry; }
+
+private:
+    void compact();
+    void parse();
+    void processLine(const char *line, int length);
+    void dispatch();
+
+    EventHandler handler;
+    QByteArray buffer;                     // 接收缓冲区
+    int readPos;                           // 第一个未消费字节
+    int scanPos;                           // 下次查找换行的起点
+    bool skipLineFeed;                     // 上一行以 \r 结尾，忽略紧随的 \n
+
+    // 正在组装的事件
+    bool hasData;
+    const char *dataPtr;                   // 单行 data 时直接指向缓冲区
+    int dataSize;
+    QByteArray ownedData;                  // 多行或跨数据块时的拷贝
+    bool dataOwned;
+    QByteArray eventType;
+    QByteArray lastEventId;
+    int retry;                             // 服务器建议的重连间隔（毫秒），-1 表示未指定
+};
+
+#endif // SSEPARSER_H
@@ -0,0 +1,159 @@
+#include "statsdialog.h"
+#include "requestmetrics.h"
+
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QLabel>
+#include <QVBoxLayout>
+#include <QMap>
+#include <algorithm>
+
+namespace {
+
+// 一个模型的汇总数据
+struct ModelSummary {
+    ModelSummary() : requests(0), errors(0), cached(0), bytes(0), uploadBytes(0), speedSum(0), speedCount(0) {}
+    int requests;
+    int errors;
+    int cached;                            // 由本地缓存回答，不计入耗时统计
+    qint64 bytes;
+    qint64 uploadBytes;
+    double speedSum;
+    int speedCount;
+    QVector<qint64> firstToken;
+    QVector<qint64> coldFirstToken;        // 新建连接
+    QVector<qint64> warmFirstToken;        // 复用连接
+    QVector<qint64> coldFirstByte;
+    QVector<qint64> warmFirstByte;
+    QVector<qint64> total;
+};
+
+// 百分位数，没有数据时返回 -1
+qint64 percentile(QVector<qint64> values, int p)
+{
+    if (values.isEmpty()) {
+        return -1;
+    }
+    std::sort(values.begin(), values.end());
+    int index = qMin(values.size() - 1, (values.size() * p) / 100);
+    return values.at(index);
+}
+
+QString msText(qint64 ms)
+{
+    return ms < 0 ? QStringLiteral("-") : QString::number(ms);
+}
+
+} // namespace
+
+StatsDialog::StatsDialog(MetricsLog *log, QWidget *parent)
+    : QDialog(parent)
+    , log(log)
+{
+    setAttribute(Qt::WA_DeleteOnClose);
+    setWindowTitle(tr("请求统计"));
+    resize(900, 420);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    table = new QTableWidget(this);
+    table->setColumnCount(14);
+    table->setHorizontalHeaderLabels(QStringList()
+        << tr("模型") << tr("请求数") << tr("失败") << tr("缓存命中") << tr("首字 P50") << tr("首字 P95")
+        << tr("首字(新连接)") << tr("首字(复用)")
+        << tr("首字节(新连接)") << tr("首字节(复用)") << tr("总耗时 P50") << tr("字/秒") << tr("平均字节") << tr("平均上传"));
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->verticalHeader()->hide();
+    table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    layout->addWidget(table, 1);
+
+    histogram = new QLabel(this);
+    histogram->setTextFormat(Qt::PlainText);
+    histogram->setStyleSheet("font-family: monospace;");
+    layout->addWidget(histogram);
+
+    connect(log, &MetricsLog::recorded, this, &StatsDialog::refresh);
+    refresh();
+}
+
+void StatsDialog::refresh()
+{
+    QMap<QString, ModelSummary> summaries;
+    QVector<int> gaps(RequestMetrics::gapBucketBounds().size() + 1, 0);
+
+    for (const RequestMetrics &m : log->recent()) {
+        ModelSummary &s = summaries[m.model];
+        ++s.requests;
+        if (m.cached) {
+            ++s.cached;
+            continue;
+        }
+        if (!m.ok) {
+            ++s.errors;
+            continue;
+        }
+        s.bytes += m.bytesReceived;
+        s.uploadBytes += m.bytesSent;
+        s.total.append(m.totalMs);
+        if (m.firstTokenMs >= 0) {
+            s.firstToken.append(m.firstTokenMs);
+        }
+        // 不知道是否复用连接的请求（明文 HTTP）不计入冷热对比
+        if (m.connection != RequestMetrics::ConnectionUnknown) {
+            const bool reused = m.connection == RequestMetrics::ConnectionReused;
+            if (m.firstTokenMs >= 0) {
+                (reused ? s.warmFirstToken : s.coldFirstToken).append(m.firstTokenMs);
+            }
+            if (m.firstByteMs >= 0) {
+                (reused ? s.warmFirstByte : s.coldFirstByte).append(m.firstByteMs);
+            }
+        }
+        double speed = m.tokensPerSecond();
+        if (speed > 0) {
+            s.speedSum += speed;
+            ++s.speedCount;
+        }
+        for (int i = 0; i < m.gapHistogram.size() && i < gaps.size(); ++i) {
+            gaps[i] += m.gapHistogram.at(i);
+        }
+    }
+
+    table->setRowCount(summaries.size());
+    int row = 0;
+    for (QMap<QString, ModelSummary>::const_iterator it = summaries.constBegin(); it != summaries.constEnd(); ++it, ++row) {
+        const ModelSummary &s = it.value();
+        int succeeded = s.requests - s.errors - s.cached;
+        QStringList cells;
+        cells << it.key()
+              << QString::number(s.requests)
+              << QString::number(s.errors)
+              << QString::number(s.cached)
+              << msText(percentile(s.firstToken, 50))
+              << msText(percentile(s.firstToken, 95))
+              << msText(percentile(s.coldFirstToken, 50))
+              << msText(percentile(s.warmFirstToken, 50))
+              << msText(percentile(s.coldFirstByte, 50))
+              << msText(percentile(s.warmFirstByte, 50))
+              << msText(percentile(s.total, 50))
+              << (s.speedCount > 0 ? QString::number(s.speedSum / s.speedCount, 'f', 1) : QStringLiteral("-"))
+              << (succeeded > 0 ? QString::number(s.bytes / succeeded) : QStringLiteral("-"))
+              << (succeeded > 0 ? QString::number(s.uploadBytes / succeeded) : QStringLiteral("-"));
+        for (int column = 0; column < cells.size(); ++column) {
+            table->setItem(row, column, new QTableWidgetItem(cells.at(column)));
+        }
+    }
+
+    // 增量间隔分布，用字符画出相对比例
+    const QVector<int> &bounds = RequestMetrics::gapBucketBounds();
+    int maxCount = *std::max_element(gaps.constBegin(), gaps.constEnd());
+    QStringList lines;
+    lines << tr("增量间隔分布：");
+    for (int i = 0; i < gaps.size(); ++i) {
+        QString label = i < bounds.size()
+            ? QString("<=%1ms").arg(bounds.at(i))
+            : QString(">%1ms").arg(bounds.last());
+        int bar = maxCount > 0 ? (gaps.at(i) * 40 + maxCount - 1) / maxCount : 0;
+        lines << QString("%1 %2 %3").arg(label, 8).arg(QString(bar, QLatin1Char('#'))).arg(gaps.at(i));
+    }
+    histogram->setText(lines.join('\n'));
+}
@@ -0,0 +1,32 @@
+#ifndef STATSDIALOG_H
+#define STATSDIALOG_H
+
+#include <QDialog>
+
+class QTableWidget;
+class QLabel;
+class MetricsLog;
+
+/**
+ * @brief 请求统计面板
+ *
+ * 按模型汇总最近的请求：首字时间和总耗时的中位数/P95、生成速度、
+ * 新建连接与复用连接的首字节/首字时间对比，以及增量间隔的分布。
+ * 每记录一个新请求就刷新一次。
+ */
+class StatsDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit StatsDialog(MetricsLog *log, QWidget *parent = nullptr);
+
+private slots:
+    void refresh();
+
+private:
+    MetricsLog *log;
+    QTableWidget *table;
+    QLabel *histogram;
+};
+
+#endif // STATSDIALOG_H
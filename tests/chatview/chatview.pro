@@ -0,0 +1,21 @@
+# 聊天列表的绘制开销：流式回复每次更新的重排和重绘、打开会话、头像
+
+include(../tests.pri)
+
+QT += widgets
+
+TARGET = tst_chatview
+
+SOURCES += \
+    $$PWD/../../avatarcache.cpp \
+    $$PWD/../../chatmodel.cpp \
+    $$PWD/../../messagedelegate.cpp \
+    tst_chatview.cpp
+
+HEADERS += \
+    $$PWD/../../avatarcache.h \
+    $$PWD/../../chatmodel.h \
+    $$PWD/../../messagedelegate.h
+
+RESOURCES += \
+    $$PWD/../../resource.qrc
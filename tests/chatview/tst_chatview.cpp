@@ -0,0 +1,282 @@
+#include "testsupport.h"
+#include "avatarcache.h"
+#include "chatmodel.h"
+#include "messagedelegate.h"
+#include "modelregistry.h"
+
+#include <QListView>
+#include <QScopedPointer>
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QTextList>
+
+namespace {
+
+const int kTokensPerRound = 100;           // 每轮基准测试追加的增量数
+const int kDeltaChars = 2;                 // 每个增量的字数，与模拟服务相同
+const int kParagraphChars = 200;           // 生成文本每段的字数
+
+// 分成多段的回复文本，AI 的回复按 Markdown 分块排版
+QString replyText(int chars)
+{
+    const QString plain = MockServer::generatedText(chars);
+    QString text;
+    text.reserve(plain.size() + plain.size() / kParagraphChars * 2);
+    for (int i = 0; i < plain.size(); i += kParagraphChars) {
+        if (i > 0) {
+            text += "\n\n";
+        }
+        text += plain.midRef(i, kParagraphChars);
+    }
+    return text;
+}
+
+// 每块单独 setMarkdown 后的显示结构：每个非空段落一行，带引用层级、列表缩进和编号
+QStringList renderedStructure(const QStringList &blocks)
+{
+    QStringList lines;
+    for (const QString &block : blocks) {
+        QTextDocument document;
+        document.setMarkdown(block);
+        for (QTextBlock paragraph = document.begin(); paragraph.isValid(); paragraph = paragraph.next()) {
+            if (paragraph.text().isEmpty()) {
+                continue;
+            }
+            QString prefix(paragraph.blockFormat().intProperty(QTextFormat::BlockQuoteLevel), QLatin1Char('>'));
+            if (QTextList *list = paragraph.textList()) {
+                prefix += QString(list->format().indent(), QLatin1Char(' ')) + list->itemText(paragraph);
+            }
+            lines.append(prefix + QLatin1Char('|') + paragraph.text());
+        }
+    }
+    return lines;
+}
+
+} // namespace
+
+/**
+ * @brief 聊天列表测试：与主窗口相同的 QListView + ChatModel + MessageDelegate，
+ * 在 offscreen 平台上实际绘制
+ */
+class TestChatView : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void streamTokens_data();
+    void streamTokens();
+    void incrementalMarkdown_data();
+    void incrementalMarkdown();
+    void markdownDelta_data();
+    void markdownDelta();
+    void openConversation_data();
+    void openConversation();
+    void avatar_data();
+    void avatar();
+
+private:
+    ModelRegistry registry;
+    QScopedPointer<QListView> view;
+    ChatModel *model;
+};
+
+void TestChatView::initTestCase()
+{
+    AvatarCache::warmUp(registry, qApp->devicePixelRatio());
+}
+
+void TestChatView::init()
+{
+    view.reset(new QListView);
+    model = new ChatModel(view.data());
+    view->setModel(model);
+    MessageDelegate *delegate = new MessageDelegate(view.data());
+    view->setItemDelegate(delegate);
+    connect(model, &QAbstractItemModel::modelReset, delegate, &MessageDelegate::clearCache);
+    connect(model, &QAbstractItemModel::dataChanged, delegate, &MessageDelegate::handleDataChanged);
+    view->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    view->setLayoutMode(QListView::Batched);
+    view->resize(800, 600);
+    view->show();
+    QVERIFY(QTest::qWaitForWindowExposed(view.data()));
+}
+
+void TestChatView::cleanup()
+{
+    view.reset();
+}
+
+void TestChatView::streamTokens_data()
+{
+    QTest::addColumn<int>("replyChars");
+
+    QTest::newRow("100 tokens, empty reply") << 0;
+    QTest::newRow("100 tokens, 2k chars") << 2000;
+    QTest::newRow("100 tokens, 20k chars") << 20000;
+}
+
+// 流式回复每个增量的界面开销：改文本、滚到底部、立即重绘，
+// 每轮 kTokensPerRound 个增量，结果应与已有回复的长度基本无关
+void TestChatView::streamTokens()
+{
+    QFETCH(int, replyChars);
+
+    const QString prefix = replyText(replyChars);
+    const QString tokens = replyText(kTokensPerRound * kDeltaChars);
+    model->appendMessage("你好", true, AvatarCache::User);
+
+    QBENCHMARK {
+        QString text = prefix;
+        const int row = model->appendMessage(text, false, registry.defaultModel());
+        for (int i = 0; i < kTokensPerRound; ++i) {
+            text += tokens.midRef(i * kDeltaChars, kDeltaChars);
+            model->setText(row, text);
+            view->scrollToBottom();
+            view->viewport()->repaint();
+        }
+        QCOMPARE(model->data(model->index(row), Qt::DisplayRole).toString(), text);
+    }
+}
+
+void TestChatView::incrementalMarkdown_data()
+{
+    QTest::addColumn<QString>("reply");
+
+    QTest::newRow("paragraphs") << QString("# 标题\n\n第一段。\n\n第二段，**加粗**。\n\n第三段。\n");
+    QTest::newRow("loose ordered list") << QString("步骤如下：\n\n1. 第一步\n\n2. 第二步\n\n3. 第三步\n\n完成。\n");
+    QTest::newRow("nested list") << QString("- 水果\n\n  - 苹果\n  - 香蕉\n\n- 蔬菜\n\n  1. 白菜\n  2. 萝卜\n\n以上。\n");
+    QTest::newRow("multi-paragraph quote") << QString("> 第一段引用\n>\n> 第二段引用\n\n> 第三段引用\n\n正文。\n");
+    QTest::newRow("code in list") << QString("1. 编译\n\n   ```\n   make\n\n   make check\n   ```\n\n2. 运行\n\n结束。\n");
+}
+
+// 按增量追加时切出的块与一次切完相同，逐块解析的显示结构与整体 setMarkdown 相同
+void TestChatView::incrementalMarkdown()
+{
+    QFETCH(QString, reply);
+
+    // 与 MessageDelegate 排版流式回复相同：每次追加后从最后一块的起点继续切
+    QStringList frozen;
+    int start = 0;
+    for (int size = kDeltaChars; ; size += kDeltaChars) {
+        const QString text = reply.left(size);
+        for (int next = MessageDelegate::markdownBlockEnd(text, start); next >= 0; next = MessageDelegate::markdownBlockEnd(text, start)) {
+            frozen.append(text.mid(start, next - start));
+            start = next;
+        }
+        if (size >= reply.size()) {
+            break;
+        }
+    }
+
+    QStringList oneShot;
+    for (int pos = 0, next; (next = MessageDelegate::markdownBlockEnd(reply, pos)) >= 0; pos = next) {
+        oneShot.append(reply.mid(pos, next - pos));
+    }
+    QCOMPARE(frozen, oneShot);
+    QVERIFY2(!frozen.isEmpty(), "reply was not split at all");
+
+    QStringList blocks = frozen;
+    blocks.append(reply.mid(start));
+    QCOMPARE(renderedStructure(blocks), renderedStructure(QStringList() << reply));
+}
+
+void TestChatView::markdownDelta_data()
+{
+    QTest::addColumn<int>("listItems");
+
+    QTest::newRow("100 tokens, paragraphs") << 0;
+    QTest::newRow("100 tokens, 10-item list") << 10;
+    QTest::newRow("100 tokens, 100-item list") << 100;
+}
+
+// 每个增量的 Markdown 切块和解析开销（不含绘制）。段落后的增量只解析最后一段；
+// 列表中的空行不切块，正在追加的列表整体重新解析，开销随列表长度增长
+void TestChatView::markdownDelta()
+{
+    QFETCH(int, listItems);
+
+    QString prefix = replyText(2000) + "\n\n";
+    for (int i = 1; i <= listItems; ++i) {
+        prefix += QString("%1. %2\n\n").arg(i).arg(MockServer::generatedText(40));
+    }
+    prefix += listItems > 0 ? QString("%1. ").arg(listItems + 1) : QString();
+    const QString tokens = MockServer::generatedText(kTokensPerRound * kDeltaChars);
+    model->appendMessage("你好", true, AvatarCache::User);
+
+    QBENCHMARK {
+        QString text = prefix;
+        const int row = model->appendMessage(text, false, registry.defaultModel());
+        view->scrollToBottom();
+        view->viewport()->repaint(); // 先排版一次，之后的增量在 dataChanged 中增量排版
+        for (int i = 0; i < kTokensPerRound; ++i) {
+            text += tokens.midRef(i * kDeltaChars, kDeltaChars);
+            model->setText(row, text);
+        }
+    }
+}
+
+void TestChatView::openConversation_data()
+{
+    QTest::addColumn<int>("messageCount");
+
+    QTest::newRow("100 messages") << 100;
+    QTest::newRow("1000 messages") << 1000;
+    QTest::newRow("10000 messages") << 10000;
+}
+
+// 打开会话：整体替换模型、滚到底部并绘制第一屏，与 MainWindow::handleMessagesLoaded 相同
+void TestChatView::openConversation()
+{
+    QFETCH(int, messageCount);
+
+    QVector<ChatModel::Message> items;
+    items.reserve(messageCount);
+    for (int i = 0; i < messageCount; ++i) {
+        ChatModel::Message item;
+        item.id = 0;
+        item.isUser = i % 2 == 0;
+        item.text = item.isUser ? MockServer::generatedText(20 + i % 50) : replyText(200 + i % 800);
+        item.model = item.isUser ? int(AvatarCache::User) : registry.defaultModel();
+        items.append(item);
+    }
+
+    QBENCHMARK {
+        model->setMessages(items);
+        view->scrollToBottom();
+        view->viewport()->repaint();
+    }
+    QCOMPARE(model->rowCount(), messageCount);
+}
+
+void TestChatView::avatar_data()
+{
+    QTest::addColumn<bool>("cached");
+
+    QTest::newRow("AvatarCache") << true;
+    QTest::newRow("decode and scale") << false;
+}
+
+// 每个头像取一次：缓存中预先缩放好的，与每次绘制时解码并缩放
+void TestChatView::avatar()
+{
+    QFETCH(bool, cached);
+
+    const qreal ratio = qApp->devicePixelRatio();
+    const int physical = qRound(AvatarCache::Size * ratio);
+    qint64 pixels = 0;
+    QBENCHMARK {
+        for (int handle = AvatarCache::User; handle < registry.count(); ++handle) {
+            QPixmap pixmap = cached ? AvatarCache::pixmap(handle, ratio)
+                                    : QPixmap(AvatarCache::pathFor(handle)).scaled(physical, physical, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+            pixels += pixmap.width();
+        }
+    }
+    QVERIFY(pixels > 0);
+}
+
+GSAI_TEST_MAIN(TestChatView)
+
+#include "tst_chatview.moc"
@@ -0,0 +1,10 @@
+# 请求体编码：拼接缓存的消息片段与整体用 QJsonDocument 编码的一致性和开销
+
+include(../tests.pri)
+
+QT -= gui
+
+TARGET = tst_contextbuilder
+
+SOURCES += \
+    tst_contextbuilder.cpp
@@ -0,0 +1,131 @@
+#include "testsupport.h"
+#include "contextbuilder.h"
+
+#include <QJsonDocument>
+
+namespace {
+
+const int kMessageChars = 200;             // 每条消息的字数
+const int kUnlimited = 1 << 30;            // 足够装下所有消息的预算
+
+QList<QJsonObject> makeMessages(int count)
+{
+    const QString text = MockServer::generatedText(kMessageChars);
+    QList<QJsonObject> messages;
+    for (int i = 0; i < count; ++i) {
+        QJsonObject message;
+        message["role"] = i % 2 == 0 ? "user" : "assistant";
+        message["content"] = QString::number(i) + text;
+        messages.append(message);
+    }
+    return messages;
+}
+
+// 整体用 QJsonDocument 编码的请求体，即 encodeRequest() 之前的做法
+QByteArray encodeWithDocument(const ContextBuilder &context, const QString &model, int tokenBudget)
+{
+    QJsonObject request;
+    request["model"] = model;
+    request["messages"] = context.build(tokenBudget);
+    request["stream"] = true;
+    return QJsonDocument(request).toJson(QJsonDocument::Compact);
+}
+
+} // namespace
+
+/**
+ * @brief ContextBuilder 测试：encodeRequest() 拼出的请求体与 build() +
+ * QJsonDocument 的结果相同
+ */
+class TestContextBuilder : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void encodeRequest_data();
+    void encodeRequest();
+    void encodeBenchmark_data();
+    void encodeBenchmark();
+};
+
+void TestContextBuilder::encodeRequest_data()
+{
+    QTest::addColumn<QString>("model");
+    QTest::addColumn<int>("messageCount");
+    QTest::addColumn<int>("tokenBudget");
+    QTest::addColumn<QString>("summary");
+    QTest::addColumn<QString>("extraContent");
+
+    QTest::newRow("one message") << "generalv3.5" << 1 << kUnlimited << QString() << QString();
+    QTest::newRow("all messages") << "generalv3.5" << 100 << kUnlimited << QString() << QString();
+    QTest::newRow("over budget") << "generalv3.5" << 100 << 2000 << QString() << QString();
+    QTest::newRow("tiny budget") << "generalv3.5" << 10 << 1 << QString() << QString();
+    QTest::newRow("summary") << "4.0Ultra" << 50 << kUnlimited << QString("较早的对话摘要") << QString();
+    QTest::newRow("summary over budget") << "4.0Ultra" << 50 << 3000 << QString("较早的对话摘要") << QString();
+    QTest::newRow("escapes") << "model \"quoted\" \\ name" << 3 << kUnlimited << QString()
+                             << QString("引号 \" 反斜杠 \\ 换行\n制表\t控制\x01 😀");
+}
+
+void TestContextBuilder::encodeRequest()
+{
+    QFETCH(QString, model);
+    QFETCH(int, messageCount);
+    QFETCH(int, tokenBudget);
+    QFETCH(QString, summary);
+    QFETCH(QString, extraContent);
+
+    ContextBuilder context("系统提示词");
+    context.setMessages(makeMessages(messageCount));
+    if (!extraContent.isEmpty()) {
+        QJsonObject message;
+        message["role"] = "user";
+        message["content"] = extraContent;
+        context.append(message);
+    }
+    if (!summary.isEmpty()) {
+        context.setSummary(summary, messageCount / 2);
+    }
+
+    const QByteArray body = context.encodeRequest(model, tokenBudget);
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(body, &error);
+    QVERIFY2(error.error == QJsonParseError::NoError, qPrintable(error.errorString()));
+    QCOMPARE(document.object(), QJsonDocument::fromJson(encodeWithDocument(context, model, tokenBudget)).object());
+
+    // 第二次编码使用缓存的片段，结果不变
+    QCOMPARE(context.encodeRequest(model, tokenBudget), body);
+}
+
+void TestContextBuilder::encodeBenchmark_data()
+{
+    QTest::addColumn<int>("messageCount");
+    QTest::addColumn<bool>("incremental");
+
+    for (int count : {10, 100, 1000}) {
+        QTest::newRow(qPrintable(QString("%1 messages, encodeRequest").arg(count))) << count << true;
+        QTest::newRow(qPrintable(QString("%1 messages, QJsonDocument").arg(count))) << count << false;
+    }
+}
+
+// 会话中每发一个问题都要编码一次请求体，已经发过的消息片段有缓存
+void TestContextBuilder::encodeBenchmark()
+{
+    QFETCH(int, messageCount);
+    QFETCH(bool, incremental);
+
+    ContextBuilder context("系统提示词");
+    context.setMessages(makeMessages(messageCount));
+    const QString model = "generalv3.5";
+    context.encodeRequest(model, kUnlimited);
+
+    QByteArray body;
+    QBENCHMARK {
+        body = incremental ? context.encodeRequest(model, kUnlimited)
+                           : encodeWithDocument(context, model, kUnlimited);
+    }
+    QVERIFY(!body.isEmpty());
+}
+
+GSAI_TEST_MAIN(TestContextBuilder)
+
+#include "tst_contextbuilder.moc"
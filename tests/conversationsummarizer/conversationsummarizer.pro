@@ -0,0 +1,10 @@
+# 滚动摘要：触发条件、只发送上一次摘要和新增的对话、ContextBuilder 用摘要代替被覆盖的消息
+
+include(../tests.pri)
+
+QT -= gui
+
+TARGET = tst_conversationsummarizer
+
+SOURCES += \
+    tst_conversationsummarizer.cpp
@@ -0,0 +1,166 @@
+#include "testsupport.h"
+#include "chatengine.h"
+#include "contextbuilder.h"
+#include "conversationsummarizer.h"
+#include "requestscheduler.h"
+
+#include <QScopedPointer>
+
+namespace {
+
+const int kReplyChars = 50;                // 模拟服务返回的摘要字数
+const int kUnlimited = 1 << 30;            // 足够装下所有消息的预算
+const qint64 kConversation = 1;
+const int kTimeoutMs = 10000;
+
+// 第 index 条消息：偶数是用户的问题，奇数是回答，内容带序号以便在请求中查找
+QJsonObject turn(int index)
+{
+    QJsonObject message;
+    message["role"] = index % 2 == 0 ? "user" : "assistant";
+    message["content"] = QString(index % 2 == 0 ? "问题 %1。" : "回答 %1。").arg(index);
+    return message;
+}
+
+ContextBuilder conversation(int count)
+{
+    ContextBuilder context(ChatEngine::systemPrompt());
+    for (int i = 0; i < count; ++i) {
+        context.append(turn(i));
+    }
+    return context;
+}
+
+} // namespace
+
+/**
+ * @brief ConversationSummarizer 测试：摘要请求发给进程内的模拟服务，
+ * 从服务的请求记录中检查每次发送的内容
+ */
+class TestConversationSummarizer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void threshold();
+    void incrementalPrompt();
+    void replacesCoveredMessages();
+
+private:
+    // 更新摘要并等它完成
+    bool summarize(const ContextBuilder &context);
+    QString prompt(int request) const;
+
+    QScopedPointer<TestSupport::MockServerThread> server;
+    QScopedPointer<ChatEngine> engine;
+    QScopedPointer<RequestScheduler> scheduler;
+    QScopedPointer<ConversationSummarizer> summarizer;
+};
+
+void TestConversationSummarizer::initTestCase()
+{
+    // 摘要模型没有密钥时不发请求
+    qputenv("GSLITE_PASSWORD", "test");
+}
+
+void TestConversationSummarizer::init()
+{
+    MockServer::Options options;
+    options.port = 0;
+    options.firstTokenMs = 0;
+    options.tokensPerSecond = 0;
+    options.replyChars = kReplyChars;
+    server.reset(new TestSupport::MockServerThread(options));
+    QVERIFY(server->start());
+
+    engine.reset(new ChatEngine(server->endpoint()));
+    scheduler.reset(new RequestScheduler(engine.data()));
+    scheduler->setRateLimit(-1, 0, 1);
+    summarizer.reset(new ConversationSummarizer(engine.data(), scheduler.data()));
+}
+
+void TestConversationSummarizer::cleanup()
+{
+    summarizer.reset();
+    scheduler.reset();
+    engine.reset();
+    server.reset();
+}
+
+bool TestConversationSummarizer::summarize(const ContextBuilder &context)
+{
+    QSignalSpy updated(summarizer.data(), &ConversationSummarizer::summaryUpdated);
+    summarizer->update(kConversation, context);
+    return updated.wait(kTimeoutMs);
+}
+
+QString TestConversationSummarizer::prompt(int request) const
+{
+    return server->requestLog().at(request).toObject().value("prompt").toString();
+}
+
+// 最近几条消息总是原文发送，之前积累的消息足够多才请求摘要，摘要止于一轮问答的结尾
+void TestConversationSummarizer::threshold()
+{
+    summarizer->update(kConversation, conversation(9));
+    QVERIFY(summarize(conversation(10)));
+
+    QTRY_COMPARE_WITH_TIMEOUT(server->requestLog().size(), 1, kTimeoutMs);
+    const QJsonObject entry = server->requestLog().at(0).toObject();
+    QCOMPARE(entry.value("model").toString(), engine->models().model(engine->models().summaryModel()).id);
+
+    const ConversationSummarizer::Summary summary = summarizer->summary(kConversation);
+    QCOMPARE(summary.covered, 4);
+    QCOMPARE(summary.text, MockServer::generatedText(kReplyChars));
+}
+
+// 第二次只发送上一次的摘要和之后新增的对话，已经摘要过的消息和原文部分都不发送
+void TestConversationSummarizer::incrementalPrompt()
+{
+    QVERIFY(summarize(conversation(10)));
+    const QString first = summarizer->summary(kConversation).text;
+    QTRY_COMPARE_WITH_TIMEOUT(server->requestLog().size(), 1, kTimeoutMs);
+    QVERIFY(!prompt(0).contains("已有摘要"));
+    QVERIFY(prompt(0).contains("问题 0。"));
+    QVERIFY(prompt(0).contains("回答 3。"));
+    QVERIFY(!prompt(0).contains("问题 4。"));
+
+    QVERIFY(summarize(conversation(14)));
+    QCOMPARE(summarizer->summary(kConversation).covered, 8);
+    QTRY_COMPARE_WITH_TIMEOUT(server->requestLog().size(), 2, kTimeoutMs);
+    const QString second = prompt(1);
+    QVERIFY2(second.startsWith("已有摘要：\n" + first), qPrintable(second));
+    QVERIFY(second.contains("问题 4。"));
+    QVERIFY(second.contains("回答 7。"));
+    for (const QString &absent : QStringList() << "问题 0。" << "回答 3。" << "问题 8。" << "回答 13。") {
+        QVERIFY2(!second.contains(absent), qPrintable(absent));
+    }
+}
+
+// 设置摘要后，被覆盖的消息换成紧跟系统提示词的一条摘要消息，之后的消息原样发送
+void TestConversationSummarizer::replacesCoveredMessages()
+{
+    ContextBuilder context = conversation(10);
+    QVERIFY(summarize(context));
+    const ConversationSummarizer::Summary summary = summarizer->summary(kConversation);
+    context.setSummary(summary.text, summary.covered);
+    QCOMPARE(context.summaryCovers(), 4);
+
+    const QJsonArray messages = context.build(kUnlimited);
+    QCOMPARE(messages.size(), 1 + 1 + 10 - summary.covered);
+    QCOMPARE(messages.at(1).toObject().value("role").toString(), QString("system"));
+    QVERIFY(messages.at(1).toObject().value("content").toString().endsWith(summary.text));
+    QCOMPARE(messages.at(2).toObject().value("content").toString(), QString("问题 4。"));
+
+    const QString body = QString::fromUtf8(context.encodeRequest("general", kUnlimited));
+    QVERIFY(body.contains(summary.text));
+    QVERIFY(!body.contains("问题 0。"));
+    QVERIFY(!body.contains("回答 3。"));
+}
+
+GSAI_TEST_MAIN(TestConversationSummarizer)
+
+#include "tst_conversationsummarizer.moc"
@@ -0,0 +1,10 @@
+# 增量提取：快速路径与完整解析的一致性和开销
+
+include(../tests.pri)
+
+QT -= gui
+
+TARGET = tst_deltaextractor
+
+SOURCES += \
+    tst_deltaextractor.cpp
@@ -0,0 +1,159 @@
+#include "testsupport.h"
+#include "deltaextractor.h"
+
+namespace {
+
+const int kReplyChars = 20000;             // 基准测试的回复字数
+const int kDeltaChars = 2;
+
+QString describe(const StreamDelta &delta)
+{
+    return QString("content=%1(%2) finish=%3 usage=%4(%5/%6/%7)")
+        .arg(delta.content).arg(delta.hasContent)
+        .arg(QString::fromUtf8(delta.finishReason)).arg(delta.hasUsage)
+        .arg(delta.promptTokens).arg(delta.completionTokens).arg(delta.totalTokens);
+}
+
+// 模拟服务生成的回复中每个事件的 data
+QList<QByteArray> generatedChunks(int replyChars)
+{
+    QList<QByteArray> chunks;
+    const QList<QByteArray> events = MockServer::generateReply(replyChars, kDeltaChars);
+    for (QByteArray event : events) {
+        event = event.trimmed();
+        if (event.startsWith("data: ") && event != "data: [DONE]") {
+            chunks.append(event.mid(6));
+        }
+    }
+    return chunks;
+}
+
+} // namespace
+
+/**
+ * @brief DeltaExtractor 测试：快速路径接受的数据块，结果必须与 QJsonDocument
+ * 完整解析相同
+ */
+class TestDeltaExtractor : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void corpus_data();
+    void corpus();
+    void generated();
+    void extract_data();
+    void extract();
+};
+
+void TestDeltaExtractor::corpus_data()
+{
+    QTest::addColumn<QByteArray>("json");
+    QTest::addColumn<bool>("fastPath");    // 快速路径必须接受
+
+    QTest::newRow("plain")
+        << QByteArray(R"({"code":0,"choices":[{"delta":{"role":"assistant","content":"你好"},"index":0}]})") << true;
+    QTest::newRow("whitespace")
+        << QByteArray(" {\n  \"choices\" : [ { \"delta\" : { \"content\" : \"a b\" } , \"index\" : 0 } ]\r\n} ") << true;
+    QTest::newRow("escapes")
+        << QByteArray(R"({"choices":[{"delta":{"content":"line\n\t\"quoted\" \\ \/ \b\f\r \u00e9中"}}]})") << true;
+    QTest::newRow("surrogate pair")
+        << QByteArray(R"({"choices":[{"delta":{"content":"\ud83d\ude00 ok \ud83d\udc4d"}}]})") << true;
+    QTest::newRow("raw 4-byte utf-8")
+        << QByteArray("{\"choices\":[{\"delta\":{\"content\":\"\xF0\x9F\x98\x80\"}}]}") << true;
+    QTest::newRow("null content")
+        << QByteArray(R"({"choices":[{"delta":{"role":"assistant","content":null},"index":0}]})") << true;
+    QTest::newRow("no content")
+        << QByteArray(R"({"choices":[{"delta":{"role":"assistant"},"index":0}]})") << true;
+    QTest::newRow("empty content")
+        << QByteArray(R"({"choices":[{"delta":{"content":""},"index":0,"finish_reason":null}]})") << true;
+    QTest::newRow("reordered keys")
+        << QByteArray(R"({"usage":{"total_tokens":30,"completion_tokens":20,"prompt_tokens":10},"choices":[{"finish_reason":"stop","index":0,"delta":{"content":"末尾","role":"assistant"}}],"id":"x"})") << true;
+    QTest::newRow("finish with usage")
+        << QByteArray(R"({"choices":[{"delta":{"content":""},"index":0,"finish_reason":"stop"}],"usage":{"prompt_tokens":100,"completion_tokens":400,"total_tokens":500}})") << true;
+    QTest::newRow("null usage")
+        << QByteArray(R"({"choices":[{"delta":{"content":"x"}}],"usage":null})") << true;
+    QTest::newRow("extra choices")
+        << QByteArray(R"({"choices":[{"delta":{"content":"first"}},{"delta":{"content":"second"}}]})") << true;
+    QTest::newRow("nested unknown fields")
+        << QByteArray(R"({"meta":{"a":[1,2,{"b":"}]"}],"c":true},"choices":[{"delta":{"content":"ok","tool_calls":[]},"logprobs":null}]})") << true;
+    QTest::newRow("empty choices")
+        << QByteArray(R"({"choices":[],"usage":{"prompt_tokens":1,"completion_tokens":2,"total_tokens":3}})") << true;
+
+    // 以下可能退回完整解析，只要求两条路径都成功时结果相同
+    QTest::newRow("error")
+        << QByteArray(R"({"error":{"message":"quota exceeded","code":10013}})") << false;
+    QTest::newRow("fractional tokens")
+        << QByteArray(R"({"choices":[],"usage":{"prompt_tokens":1.5,"completion_tokens":2e1,"total_tokens":3}})") << false;
+    QTest::newRow("escaped finish reason")
+        << QByteArray(R"({"choices":[{"delta":{},"finish_reason":"st\u006fp"}]})") << false;
+    QTest::newRow("lone surrogate")
+        << QByteArray(R"({"choices":[{"delta":{"content":"\ud83d"}}]})") << false;
+    QTest::newRow("trailing garbage")
+        << QByteArray(R"({"choices":[]} x)") << false;
+}
+
+void TestDeltaExtractor::corpus()
+{
+    QFETCH(QByteArray, json);
+    QFETCH(bool, fastPath);
+
+    StreamDelta fast;
+    const bool fastOk = DeltaExtractor::extractFast(json.constData(), json.size(), &fast);
+    if (fastPath) {
+        QVERIFY(fastOk);
+    }
+    if (fastOk) {
+        StreamDelta slow;
+        QVERIFY(DeltaExtractor::extractSlow(json, &slow));
+        QVERIFY2(fast == slow, qPrintable(describe(fast) + " != " + describe(slow)));
+    }
+}
+
+// 模拟服务生成的整段回复：每个数据块都走快速路径，拼起来与原文相同
+void TestDeltaExtractor::generated()
+{
+    QString text;
+    for (const QByteArray &chunk : generatedChunks(kReplyChars)) {
+        StreamDelta fast;
+        QVERIFY(DeltaExtractor::extractFast(chunk.constData(), chunk.size(), &fast));
+        StreamDelta slow;
+        QVERIFY(DeltaExtractor::extractSlow(chunk, &slow));
+        QVERIFY2(fast == slow, chunk.constData());
+        text += fast.content;
+    }
+    QCOMPARE(text, MockServer::generatedText(kReplyChars));
+}
+
+void TestDeltaExtractor::extract_data()
+{
+    QTest::addColumn<bool>("fastPath");
+
+    QTest::newRow("fast") << true;
+    QTest::newRow("QJsonDocument") << false;
+}
+
+void TestDeltaExtractor::extract()
+{
+    QFETCH(bool, fastPath);
+
+    const QList<QByteArray> chunks = generatedChunks(kReplyChars);
+    int contentChars = 0;
+    QBENCHMARK {
+        contentChars = 0;
+        for (const QByteArray &chunk : chunks) {
+            StreamDelta delta;
+            if (fastPath) {
+                DeltaExtractor::extractFast(chunk.constData(), chunk.size(), &delta);
+            } else {
+                DeltaExtractor::extractSlow(chunk, &delta);
+            }
+            contentChars += delta.content.size();
+        }
+    }
+    QCOMPARE(contentChars, MockServer::generatedText(kReplyChars).size());
+}
+
+GSAI_TEST_MAIN(TestDeltaExtractor)
+
+#include "tst_deltaextractor.moc"
@@ -0,0 +1,10 @@
+# 端到端：进程内的模拟服务 -> 请求调度 -> 流式解析，统计首字时间、接收速度和上传字节数
+
+include(../tests.pri)
+
+QT -= gui
+
+TARGET = tst_endtoend
+
+SOURCES += \
+    tst_endtoend.cpp
@@ -0,0 +1,231 @@
+#include "testsupport.h"
+#include "chatengine.h"
+#include "chatstream.h"
+#include "contextbuilder.h"
+#include "requestscheduler.h"
+
+#include <QScopedPointer>
+
+namespace {
+
+const int kFirstTokenMs = 20;              // 模拟服务收到请求到第一个事件的延迟
+const int kRequests = 30;                  // 统计首字时间的请求数
+const int kWarmUpWaitMs = 100;            // 预连接之后等待连接建立的时间
+const int kLargeReplyChars = 200000;       // 吞吐量测试的回复字数，约 2.5 MB 的 SSE 数据
+const int kHistoryMessages = 40;           // 上传测试的会话长度
+const int kHistoryChars = 150;             // 其中每条消息的字数
+const int kSummaryChars = 300;             // 代替较早消息的摘要字数
+const int kVerbatimMessages = 6;           // 打开摘要时原文发送的最近消息数，与 ConversationSummarizer 相同
+const int kUploadRequests = 10;            // 每种组合发送的请求数
+const int kTimeoutMs = 30000;
+
+} // namespace
+
+/**
+ * @brief 端到端测试：模拟服务在独立线程中发送回复，客户端走与界面相同的
+ * ContextBuilder -> RequestScheduler -> ChatEngine -> ChatStream 流程
+ */
+class TestEndToEnd : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void timeToFirstToken();
+    void coldVersusWarm();
+    void streamThroughput();
+    void uploadSize();
+
+private:
+    // 提交请求并等它结束，超时返回的流没有结束
+    static ChatStream *send(RequestScheduler *scheduler, int model, const QByteArray &body);
+};
+
+ChatStream *TestEndToEnd::send(RequestScheduler *scheduler, int model, const QByteArray &body)
+{
+    ChatStream *stream = scheduler->submit(0, model, body, RequestScheduler::Interactive);
+    QSignalSpy finished(stream, &ChatStream::finished);
+    finished.wait(kTimeoutMs);
+    return stream;
+}
+
+void TestEndToEnd::timeToFirstToken()
+{
+    MockServer::Options options;
+    options.port = 0;
+    options.firstTokenMs = kFirstTokenMs;
+    options.tokensPerSecond = 0;
+    TestSupport::MockServerThread server(options);
+    QVERIFY(server.start());
+
+    ChatEngine engine(server.endpoint());
+    RequestScheduler scheduler(&engine);
+    scheduler.setRateLimit(-1, 0, 1);
+    const int model = engine.models().defaultModel();
+    const QByteArray body = TestSupport::requestBody(engine, model, "你好");
+
+    QVector<qint64> firstByte;
+    QVector<qint64> firstToken;
+    QVector<qint64> total;
+    for (int i = 0; i < kRequests; ++i) {
+        QScopedPointer<ChatStream> stream(send(&scheduler, model, body));
+        const RequestMetrics &metrics = stream->metrics();
+        QVERIFY2(stream->isDone() && metrics.ok, qPrintable(metrics.error));
+        QCOMPARE(stream->text(), MockServer::generatedText(options.replyChars));
+        firstByte.append(metrics.firstByteMs);
+        firstToken.append(metrics.firstTokenMs);
+        total.append(metrics.totalMs);
+    }
+
+    QJsonObject report;
+    report["serverFirstTokenMs"] = kFirstTokenMs;
+    report["firstByteMs"] = TestSupport::summarize(firstByte);
+    report["firstTokenMs"] = TestSupport::summarize(firstToken);
+    report["totalMs"] = TestSupport::summarize(total);
+    TestSupport::writeReport("endtoend-ttft", report);
+}
+
+// 首字节时间：冷启动每个请求用新的 ChatEngine（新连接），
+// 热启动先 warmUp() 预连接，之后的请求复用同一个 ChatEngine 的连接
+void TestEndToEnd::coldVersusWarm()
+{
+    MockServer::Options options;
+    options.port = 0;
+    options.firstTokenMs = 0;
+    options.tokensPerSecond = 0;
+    TestSupport::MockServerThread server(options);
+    QVERIFY(server.start());
+
+    QVector<qint64> cold;
+    for (int i = 0; i < kRequests; ++i) {
+        ChatEngine engine(server.endpoint());
+        RequestScheduler scheduler(&engine);
+        scheduler.setRateLimit(-1, 0, 1);
+        const int model = engine.models().defaultModel();
+        QScopedPointer<ChatStream> stream(send(&scheduler, model, TestSupport::requestBody(engine, model, "你好")));
+        QVERIFY2(stream->isDone() && stream->metrics().ok, qPrintable(stream->metrics().error));
+        cold.append(stream->metrics().firstByteMs);
+    }
+
+    ChatEngine engine(server.endpoint());
+    RequestScheduler scheduler(&engine);
+    scheduler.setRateLimit(-1, 0, 1);
+    const int model = engine.models().defaultModel();
+    const QByteArray body = TestSupport::requestBody(engine, model, "你好");
+    engine.warmUp(engine.models().defaultModel());
+    QTest::qWait(kWarmUpWaitMs);
+
+    QVector<qint64> warm;
+    for (int i = 0; i < kRequests; ++i) {
+        QScopedPointer<ChatStream> stream(send(&scheduler, model, body));
+        QVERIFY2(stream->isDone() && stream->metrics().ok, qPrintable(stream->metrics().error));
+        warm.append(stream->metrics().firstByteMs);
+    }
+
+    // 本机回环上建立 TCP 连接很快，两者的差别远小于正式接口（HTTPS）上的差别
+    QJsonObject report;
+    report["coldFirstByteMs"] = TestSupport::summarize(cold);
+    report["warmFirstByteMs"] = TestSupport::summarize(warm);
+    TestSupport::writeReport("endtoend-ttfb", report);
+}
+
+void TestEndToEnd::streamThroughput()
+{
+    MockServer::Options options;
+    options.port = 0;
+    options.firstTokenMs = 0;
+    options.tokensPerSecond = 0;
+    options.replyChars = kLargeReplyChars;
+    options.deltaChars = 20;
+    TestSupport::MockServerThread server(options);
+    QVERIFY(server.start());
+
+    ChatEngine engine(server.endpoint());
+    RequestScheduler scheduler(&engine);
+    scheduler.setRateLimit(-1, 0, 1);
+    const int model = engine.models().defaultModel();
+    const QByteArray body = TestSupport::requestBody(engine, model, "你好");
+    const QString expected = MockServer::generatedText(kLargeReplyChars);
+
+    qint64 bytes = 0;
+    qint64 streamMs = 0;
+    QBENCHMARK {
+        QScopedPointer<ChatStream> stream(send(&scheduler, model, body));
+        const RequestMetrics &metrics = stream->metrics();
+        QVERIFY2(stream->isDone() && metrics.ok, qPrintable(metrics.error));
+        QCOMPARE(stream->text().size(), expected.size());
+        bytes += metrics.bytesReceived;
+        streamMs += metrics.totalMs - metrics.firstByteMs;
+    }
+
+    QJsonObject report;
+    report["replyChars"] = kLargeReplyChars;
+    report["bytesReceived"] = bytes;
+    report["streamMs"] = streamMs;
+    report["megabytesPerSecond"] = streamMs > 0 ? bytes / 1048576.0 / (streamMs / 1000.0) : 0.0;
+    TestSupport::writeReport("endtoend-throughput", report);
+}
+
+// 请求压缩和滚动摘要对上传字节数和首字时间的影响：同一段较长的会话，
+// 压缩开/关、摘要开/关四种组合各发 kUploadRequests 次
+void TestEndToEnd::uploadSize()
+{
+    MockServer::Options options;
+    options.port = 0;
+    options.firstTokenMs = kFirstTokenMs;
+    options.tokensPerSecond = 0;
+    TestSupport::MockServerThread server(options);
+    QVERIFY(server.start());
+
+    ContextBuilder context(ChatEngine::systemPrompt());
+    const QString text = MockServer::generatedText(kHistoryChars);
+    for (int i = 0; i < kHistoryMessages; ++i) {
+        QJsonObject message;
+        message["role"] = i % 2 == 0 ? "user" : "assistant";
+        message["content"] = QString::number(i) + text;
+        context.append(message);
+    }
+    const QString summaryText = MockServer::generatedText(kSummaryChars);
+
+    QJsonObject report;
+    QHash<QString, qint64> bytesSent;
+    for (int compress = 0; compress < 2; ++compress) {
+        for (int summary = 0; summary < 2; ++summary) {
+            ChatEngine engine(server.endpoint());
+            engine.setCompressRequests(compress);
+            RequestScheduler scheduler(&engine);
+            scheduler.setRateLimit(-1, 0, 1);
+            if (summary) {
+                context.setSummary(summaryText, kHistoryMessages - kVerbatimMessages);
+            } else {
+                context.clearSummary();
+            }
+            const int model = engine.models().defaultModel();
+            const QByteArray body = context.encodeRequest(engine.models().model(model).id, engine.models().budget(model));
+
+            QVector<qint64> sent;
+            QVector<qint64> firstToken;
+            for (int i = 0; i < kUploadRequests; ++i) {
+                QScopedPointer<ChatStream> stream(send(&scheduler, model, body));
+                QVERIFY2(stream->isDone() && stream->metrics().ok, qPrintable(stream->metrics().error));
+                sent.append(stream->metrics().bytesSent);
+                firstToken.append(stream->metrics().firstTokenMs);
+            }
+
+            const QString name = QString("%1, %2").arg(compress ? "gzip" : "uncompressed", summary ? "summary" : "full history");
+            QJsonObject result;
+            result["bodyBytes"] = body.size();
+            result["bytesSent"] = TestSupport::summarize(sent);
+            result["firstTokenMs"] = TestSupport::summarize(firstToken);
+            report[name] = result;
+            bytesSent.insert(name, TestSupport::percentile(sent, 50));
+        }
+    }
+    TestSupport::writeReport("endtoend-upload", report);
+
+    QVERIFY(bytesSent.value("gzip, full history") < bytesSent.value("uncompressed, full history"));
+    QVERIFY(bytesSent.value("uncompressed, summary") < bytesSent.value("uncompressed, full history"));
+}
+
+GSAI_TEST_MAIN(TestEndToEnd)
+
+#include "tst_endtoend.moc"
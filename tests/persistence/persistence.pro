@@ -0,0 +1,16 @@
+# 会话存储的开销：追加消息（日志写入），一万个会话的 CBOR 与 JSON 整体读写
+
+include(../tests.pri)
+
+QT -= gui
+
+TARGET = tst_persistence
+
+SOURCES += \
+    $$PWD/../../conversationstore.cpp \
+    $$PWD/../../persistenceworker.cpp \
+    tst_persistence.cpp
+
+HEADERS += \
+    $$PWD/../../conversationstore.h \
+    $$PWD/../../persistenceworker.h
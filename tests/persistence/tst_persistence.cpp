@@ -0,0 +1,322 @@
+#include "testsupport.h"
+#include "conversationstore.h"
+#include "persistenceworker.h"
+
+#include <QTemporaryDir>
+#include <QScopedPointer>
+#include <QSaveFile>
+#include <QFile>
+#include <QJsonDocument>
+#include <QFileInfo>
+
+namespace {
+
+const int kMessageChars = 500;             // 每条消息的字数
+const int kTimeoutMs = 10000;
+const int kConversations = 10000;          // 整体读写对比的会话数
+const int kMessagesPerConversation = 6;
+const int kConversationMessageChars = 100;
+
+// 只有一个会话的旧版 conversations.json
+const char *const kSmallLegacyJson = "[{\"title\":\"旧会话\",\"messages\":[{\"role\":\"user\",\"content\":\"你好\"}]}]";
+
+bool writeFile(const QString &path, const QByteArray &bytes)
+{
+    QSaveFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(bytes) == bytes.size() && file.commit();
+}
+
+QJsonObject makeMessage(int chars)
+{
+    QJsonObject message;
+    message["role"] = "assistant";
+    message["content"] = MockServer::generatedText(chars);
+    return message;
+}
+
+} // namespace
+
+/**
+ * @brief 会话存储测试：每个测试用临时目录中的新存储
+ *
+ * 整体读写对比一万个会话：当前的 CBOR 索引 + 数据文件（直接驱动 I/O 线程的
+ * PersistenceWorker）与旧版整体写成一个 conversations.json 的做法。
+ * 启动时 CBOR 只读索引，消息正文打开会话时才读；JSON 必须整个解析。
+ */
+class TestPersistence : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+    void appendMessage();
+    void appendAndFlush();
+    void saveCbor();
+    void saveJson();
+    void loadCbor();
+    void loadJson();
+    void migrateLegacy();
+    void damagedIndexIgnoresLegacy();
+    void unreadableMessages();
+
+private:
+    PersistenceWorker::Task compactTask(int generation) const;
+    bool saveLegacyJson(const QString &path) const;
+    int loadWith(const QString &baseName) const;
+
+    QList<qint64> order;                   // 整体读写用的会话
+    QHash<qint64, ConversationStore::Entry> state;
+    QJsonObject report;
+    QScopedPointer<QTemporaryDir> dir;
+    QScopedPointer<ConversationStore> store;
+    qint64 conversation;
+};
+
+void TestPersistence::initTestCase()
+{
+    const QString text = MockServer::generatedText(kConversationMessageChars);
+    for (qint64 id = 1; id <= kConversations; ++id) {
+        ConversationStore::Entry entry;
+        entry.title = QString("会话 %1").arg(id);
+        entry.lastActivity = id;
+        for (int i = 0; i < kMessagesPerConversation; ++i) {
+            QJsonObject message;
+            message["role"] = i % 2 == 0 ? "user" : "assistant";
+            message["content"] = text;
+            entry.pending.append(message);
+        }
+        state.insert(id, entry);
+        order.prepend(id);
+    }
+    report["conversations"] = kConversations;
+    report["messagesPerConversation"] = kMessagesPerConversation;
+}
+
+void TestPersistence::cleanupTestCase()
+{
+    TestSupport::writeReport("persistence", report);
+}
+
+PersistenceWorker::Task TestPersistence::compactTask(int generation) const
+{
+    PersistenceWorker::Task task;
+    task.type = PersistenceWorker::Task::Compact;
+    task.job.order = order;
+    task.job.state = state;
+    task.job.seq = kConversations;
+    task.job.nextId = kConversations + 1;
+    task.job.generation = generation;
+    return task;
+}
+
+// 旧版的保存方式：全部会话组成一个 JSON 文档整体写入
+bool TestPersistence::saveLegacyJson(const QString &path) const
+{
+    QJsonArray conversations;
+    for (qint64 id : order) {
+        const ConversationStore::Entry &entry = state[id];
+        QJsonArray messages;
+        for (const QJsonObject &message : entry.pending) {
+            messages.append(message);
+        }
+        QJsonObject conversation;
+        conversation["id"] = id;
+        conversation["title"] = entry.title;
+        conversation["messages"] = messages;
+        conversations.append(conversation);
+    }
+    QJsonObject root;
+    root["seq"] = kConversations;
+    root["nextId"] = kConversations + 1;
+    root["conversations"] = conversations;
+
+    QSaveFile file(path);
+    return file.open(QIODevice::WriteOnly)
+        && file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) >= 0
+        && file.commit();
+}
+
+// 用新的 I/O 线程对象读取 baseName，返回读到的会话数
+int TestPersistence::loadWith(const QString &baseName) const
+{
+    int conversations = -1;
+    PersistenceWorker worker(baseName);
+    connect(&worker, &PersistenceWorker::loaded, [&conversations](const ConversationStore::Snapshot &snapshot) {
+        conversations = snapshot.order.size();
+    });
+    PersistenceWorker::Task task;
+    task.type = PersistenceWorker::Task::Load;
+    worker.post(task);
+    worker.drain();
+    return conversations;
+}
+
+void TestPersistence::init()
+{
+    dir.reset(new QTemporaryDir);
+    QVERIFY(dir->isValid());
+    store.reset(new ConversationStore(dir->filePath("conversations")));
+    store->load();
+    QTRY_VERIFY_WITH_TIMEOUT(store->isLoaded(), kTimeoutMs);
+    QSignalSpy saved(store.data(), &ConversationStore::saved);
+    conversation = store->createConversation("benchmark");
+    QVERIFY(saved.wait(kTimeoutMs));
+}
+
+void TestPersistence::cleanup()
+{
+    store.reset();
+    dir.reset();
+}
+
+// 主线程追加一条消息的开销，写盘在 I/O 线程中进行
+void TestPersistence::appendMessage()
+{
+    const QJsonObject message = makeMessage(kMessageChars);
+    int appended = 0;
+    QBENCHMARK {
+        store->appendMessage(conversation, message);
+        ++appended;
+    }
+    QCOMPARE(store->messageCount(conversation), appended);
+
+    QSignalSpy saved(store.data(), &ConversationStore::saved);
+    QVERIFY(saved.wait(kTimeoutMs));
+}
+
+// 追加一条消息直到它写入磁盘（收到 saved()）
+void TestPersistence::appendAndFlush()
+{
+    const QJsonObject message = makeMessage(kMessageChars);
+    QSignalSpy saved(store.data(), &ConversationStore::saved);
+    QBENCHMARK {
+        store->appendMessage(conversation, message);
+        QVERIFY(saved.wait(kTimeoutMs));
+    }
+}
+
+// 检查点：全部会话写成新一代 CBOR 数据文件和索引
+void TestPersistence::saveCbor()
+{
+    const QString baseName = dir->filePath("bulk");
+    PersistenceWorker worker(baseName);
+    bool ok = false;
+    connect(&worker, &PersistenceWorker::compactionFinished, [&ok](const ConversationStore::CompactionResult &result) {
+        ok = result.ok;
+    });
+
+    int generation = 0;
+    QBENCHMARK {
+        ok = false;
+        worker.post(compactTask(++generation));
+        worker.drain();
+        QVERIFY(ok);
+    }
+    report["cborBytes"] = QFileInfo(baseName + ".idx").size()
+        + QFileInfo(QString("%1.%2.dat").arg(baseName).arg(generation)).size();
+}
+
+void TestPersistence::saveJson()
+{
+    const QString path = dir->filePath("bulk.json");
+    QBENCHMARK {
+        QVERIFY(saveLegacyJson(path));
+    }
+    report["jsonBytes"] = QFileInfo(path).size();
+}
+
+// 启动时读取索引，不读消息正文
+void TestPersistence::loadCbor()
+{
+    const QString baseName = dir->filePath("bulk");
+    {
+        PersistenceWorker worker(baseName);
+        worker.post(compactTask(1));
+        worker.drain();
+    }
+
+    int conversations = 0;
+    QBENCHMARK {
+        conversations = loadWith(baseName);
+    }
+    QCOMPARE(conversations, kConversations);
+}
+
+// 旧版 conversations.json：整个文件解析成 QJsonDocument
+void TestPersistence::loadJson()
+{
+    const QString baseName = dir->filePath("bulk");
+    QVERIFY(saveLegacyJson(baseName + ".json"));
+
+    int conversations = 0;
+    QBENCHMARK {
+        conversations = loadWith(baseName);
+    }
+    QCOMPARE(conversations, kConversations);
+}
+
+// 导入旧版文件后立即写检查点，写成后旧文件改名，下次启动从索引读取
+void TestPersistence::migrateLegacy()
+{
+    const QString baseName = dir->filePath("legacy");
+    QVERIFY(writeFile(baseName + ".json", kSmallLegacyJson));
+
+    {
+        ConversationStore migrated(baseName);
+        migrated.load();
+        QTRY_VERIFY_WITH_TIMEOUT(migrated.isLoaded(), kTimeoutMs);
+        QCOMPARE(migrated.title(1), QString("旧会话"));
+        QTRY_VERIFY_WITH_TIMEOUT(QFile::exists(baseName + ".json.migrated"), kTimeoutMs);
+    }
+    QVERIFY(!QFile::exists(baseName + ".json"));
+    QVERIFY(QFile::exists(baseName + ".idx"));
+    QCOMPARE(loadWith(baseName), 1);
+}
+
+// 索引损坏且没有上一代时不退回旧版文件：它的内容早于索引，导入会覆盖之后的修改
+void TestPersistence::damagedIndexIgnoresLegacy()
+{
+    const QString baseName = dir->filePath("damaged");
+    QVERIFY(writeFile(baseName + ".json", kSmallLegacyJson));
+    QVERIFY(writeFile(baseName + ".idx", "not an index"));
+
+    QCOMPARE(loadWith(baseName), 0);
+    QVERIFY(QFile::exists(baseName + ".json"));
+}
+
+// 数据文件损坏时报告失败，不把只剩未写入消息的残缺列表放进缓存
+void TestPersistence::unreadableMessages()
+{
+    const QString baseName = dir->filePath("unreadable");
+    QVERIFY(writeFile(baseName + ".json", kSmallLegacyJson));
+    {
+        ConversationStore migrated(baseName);
+        migrated.load();
+        QTRY_VERIFY_WITH_TIMEOUT(QFile::exists(baseName + ".json.migrated"), kTimeoutMs);
+    }
+
+    // 大小不变，索引仍然有效，只是内容无法解析
+    const QString dataPath = baseName + ".1.dat";
+    const qint64 size = QFileInfo(dataPath).size();
+    QVERIFY(size > 0);
+    QVERIFY(writeFile(dataPath, QByteArray(int(size), char(0xff))));
+
+    ConversationStore damaged(baseName);
+    damaged.load();
+    QTRY_VERIFY_WITH_TIMEOUT(damaged.isLoaded(), kTimeoutMs);
+    QSignalSpy loadedMessages(&damaged, &ConversationStore::messagesLoaded);
+    QSignalSpy failed(&damaged, &ConversationStore::messagesFailed);
+    for (int attempt = 1; attempt <= 2; ++attempt) {
+        damaged.requestMessages(1);
+        QTRY_COMPARE_WITH_TIMEOUT(failed.count(), attempt, kTimeoutMs);
+        QCOMPARE(failed.last().first().toLongLong(), qint64(1));
+    }
+    QCOMPARE(loadedMessages.count(), 0);
+}
+
+GSAI_TEST_MAIN(TestPersistence)
+
+#include "tst_persistence.moc"
@@ -0,0 +1,10 @@
+# 请求调度：限流、重试、压缩回退、按模型限速和优先级，使用模拟服务注入的错误
+
+include(../tests.pri)
+
+QT -= gui
+
+TARGET = tst_requestscheduler
+
+SOURCES += \
+    tst_requestscheduler.cpp
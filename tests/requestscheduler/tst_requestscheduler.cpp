@@ -0,0 +1,301 @@
+#include "testsupport.h"
+#include "chatengine.h"
+#include "chatstream.h"
+#include "requestscheduler.h"
+
+#include <QScopedPointer>
+#include <algorithm>
+
+namespace {
+
+const int kTimeoutMs = 15000;
+const qint64 kBackoffBaseMs = 500;         // 与 RequestScheduler 的第一次退避时间相同
+const qint64 kToleranceMs = 100;           // 定时器和本机网络带来的误差
+
+// 一次 retryScheduled()
+struct Retry {
+    int attempt;
+    qint64 delayMs;
+    QString reason;
+};
+
+// 回复很短、不限速，请求之间的间隔只取决于调度
+MockServer::Options quickOptions()
+{
+    MockServer::Options options;
+    options.port = 0;
+    options.firstTokenMs = 0;
+    options.tokensPerSecond = 0;
+    options.replyChars = 40;
+    options.deltaChars = 4;
+    return options;
+}
+
+} // namespace
+
+/**
+ * @brief RequestScheduler 测试：模拟服务在独立线程中按脚本返回错误，
+ * 请求到达服务的时刻和顺序从服务的请求记录中读取
+ */
+class TestRequestScheduler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void rateLimitWithRetryAfter();
+    void serverErrorBackoff();
+    void midStreamDropRestarts();
+    void gzipFallback();
+    void perModelTokenBucket();
+    void interactiveBeforeBackground();
+
+private:
+    // 启动模拟服务并建立使用它的调度器，之前的全部替换
+    bool startServer(const MockServer::Options &options);
+    QString modelAt(int handle) const { return engine->models().model(handle).id; }
+    ChatStream *submit(int model, RequestScheduler::Priority priority = RequestScheduler::Interactive,
+                       const QString &prompt = QString("你好"));
+    static bool waitFinished(ChatStream *stream);
+
+    QScopedPointer<TestSupport::MockServerThread> server;
+    QScopedPointer<ChatEngine> engine;
+    QScopedPointer<RequestScheduler> scheduler;
+    QList<Retry> retries;
+};
+
+void TestRequestScheduler::init()
+{
+    retries.clear();
+}
+
+void TestRequestScheduler::cleanup()
+{
+    scheduler.reset();
+    engine.reset();
+    server.reset();
+}
+
+bool TestRequestScheduler::startServer(const MockServer::Options &options)
+{
+    scheduler.reset();
+    engine.reset();
+    server.reset(new TestSupport::MockServerThread(options));
+    if (!server->start()) {
+        return false;
+    }
+    engine.reset(new ChatEngine(server->endpoint()));
+    scheduler.reset(new RequestScheduler(engine.data()));
+    scheduler->setRateLimit(-1, 0, 1);
+    connect(scheduler.data(), &RequestScheduler::retryScheduled,
+            [this](ChatStream *, int attempt, qint64 delayMs, const QString &reason) {
+        Retry retry;
+        retry.attempt = attempt;
+        retry.delayMs = delayMs;
+        retry.reason = reason;
+        retries.append(retry);
+    });
+    return true;
+}
+
+ChatStream *TestRequestScheduler::submit(int model, RequestScheduler::Priority priority, const QString &prompt)
+{
+    return scheduler->submit(0, model, TestSupport::requestBody(*engine, model, prompt), priority, scheduler.data());
+}
+
+bool TestRequestScheduler::waitFinished(ChatStream *stream)
+{
+    QSignalSpy finished(stream, &ChatStream::finished);
+    return finished.wait(kTimeoutMs);
+}
+
+// 429 带 Retry-After：按服务器要求的时间等待后重发，成功后内容完整
+void TestRequestScheduler::rateLimitWithRetryAfter()
+{
+    MockServer::Options options = quickOptions();
+    options.retryAfterSeconds = 1;
+    QVERIFY(startServer(options));
+    server->scriptFaults(QList<MockServer::Fault>() << MockServer::RateLimit);
+
+    ChatStream *stream = submit(0);
+    QVERIFY(waitFinished(stream));
+    QVERIFY2(stream->metrics().ok, qPrintable(stream->metrics().error));
+    QCOMPARE(stream->metrics().retries, 1);
+    QCOMPARE(stream->text(), MockServer::generatedText(options.replyChars));
+
+    QCOMPARE(retries.size(), 1);
+    QCOMPARE(retries.at(0).delayMs, qint64(1000));
+    QCOMPARE(retries.at(0).reason, QString("HTTP 429"));
+
+    const QJsonArray log = server->requestLog();
+    QCOMPARE(log.size(), 2);
+    QCOMPARE(log.at(0).toObject().value("status").toInt(), 429);
+    QCOMPARE(log.at(1).toObject().value("status").toInt(), 200);
+    const qint64 gap = qint64(log.at(1).toObject().value("receivedMs").toDouble() - log.at(0).toObject().value("receivedMs").toDouble());
+    QVERIFY2(gap >= 1000 - kToleranceMs, qPrintable(QString("retried after %1 ms").arg(gap)));
+}
+
+// 连续的 5xx：每次退避时间在 [d/2, d] 之间随机，d 从 500 ms 开始翻倍
+void TestRequestScheduler::serverErrorBackoff()
+{
+    QVERIFY(startServer(quickOptions()));
+    server->scriptFaults(QList<MockServer::Fault>() << MockServer::ServerError << MockServer::ServerError << MockServer::ServerError);
+
+    ChatStream *stream = submit(0);
+    QVERIFY(waitFinished(stream));
+    QVERIFY2(stream->metrics().ok, qPrintable(stream->metrics().error));
+    QCOMPARE(stream->metrics().retries, 3);
+
+    QCOMPARE(retries.size(), 3);
+    const QJsonArray log = server->requestLog();
+    QCOMPARE(log.size(), 4);
+    for (int i = 0; i < retries.size(); ++i) {
+        const Retry &retry = retries.at(i);
+        const qint64 ceiling = kBackoffBaseMs << i;
+        QCOMPARE(retry.attempt, i + 1);
+        QCOMPARE(retry.reason, QString("HTTP 503"));
+        QVERIFY2(retry.delayMs >= ceiling / 2 && retry.delayMs <= ceiling,
+                 qPrintable(QString("attempt %1 delayed %2 ms").arg(retry.attempt).arg(retry.delayMs)));
+
+        QCOMPARE(log.at(i).toObject().value("status").toInt(), 503);
+        const qint64 gap = qint64(log.at(i + 1).toObject().value("receivedMs").toDouble() - log.at(i).toObject().value("receivedMs").toDouble());
+        QVERIFY2(gap >= retry.delayMs - kToleranceMs, qPrintable(QString("attempt %1 sent after %2 ms").arg(retry.attempt).arg(gap)));
+    }
+}
+
+// 回复中途断开：从头重新请求，已经收到的一半内容被丢弃，不会重复
+void TestRequestScheduler::midStreamDropRestarts()
+{
+    MockServer::Options options = quickOptions();
+    QVERIFY(startServer(options));
+    server->scriptFaults(QList<MockServer::Fault>() << MockServer::Drop);
+
+    ChatStream *stream = submit(0);
+    QVERIFY(waitFinished(stream));
+    QVERIFY2(stream->metrics().ok, qPrintable(stream->metrics().error));
+    QCOMPARE(stream->metrics().retries, 1);
+    QCOMPARE(stream->text(), MockServer::generatedText(options.replyChars));
+
+    const QJsonArray log = server->requestLog();
+    QCOMPARE(log.size(), 2);
+    const QJsonObject dropped = log.at(0).toObject();
+    QVERIFY(dropped.value("dropped").toBool());
+    QVERIFY(dropped.value("events").toInt() > 0);
+    QVERIFY(dropped.value("events").toInt() < dropped.value("totalEvents").toInt());
+    QVERIFY(!log.at(1).toObject().value("dropped").toBool());
+}
+
+// 压缩的请求体被 415 拒绝：ChatEngine 关闭压缩，同一个请求不压缩重发一次
+void TestRequestScheduler::gzipFallback()
+{
+    MockServer::Options options = quickOptions();
+    options.rejectGzip = true;
+    QVERIFY(startServer(options));
+    engine->setCompressRequests(true);
+
+    // 只有较大的请求体才压缩
+    ChatStream *stream = submit(0, RequestScheduler::Interactive, MockServer::generatedText(2000));
+    QVERIFY(waitFinished(stream));
+    QVERIFY2(stream->metrics().ok, qPrintable(stream->metrics().error));
+    QCOMPARE(stream->metrics().retries, 1);
+    QVERIFY(!engine->compressRequests());
+    QCOMPARE(retries.size(), 1);
+    QCOMPARE(retries.at(0).reason, QString("request encoding rejected"));
+
+    const QJsonArray log = server->requestLog();
+    QCOMPARE(log.size(), 2);
+    QVERIFY(log.at(0).toObject().value("gzip").toBool());
+    QCOMPARE(log.at(0).toObject().value("status").toInt(), 415);
+    QVERIFY(!log.at(1).toObject().value("gzip").toBool());
+    QCOMPARE(log.at(1).toObject().value("status").toInt(), 200);
+
+    // 之后的请求直接不压缩
+    ChatStream *next = submit(0, RequestScheduler::Interactive, MockServer::generatedText(2000));
+    QVERIFY(waitFinished(next));
+    QCOMPARE(next->metrics().retries, 0);
+    QVERIFY(!server->requestLog().at(2).toObject().value("gzip").toBool());
+}
+
+// 每个模型一个令牌桶：被限速的模型按速率逐个发出，不挡住其它模型
+void TestRequestScheduler::perModelTokenBucket()
+{
+    const int throttledCount = 6;
+    const int unthrottledCount = 3;
+    const double rate = 5;                 // 每 200 ms 一个
+    const qint64 interval = qint64(1000 / rate);
+
+    QVERIFY(startServer(quickOptions()));
+    const int throttled = 0;
+    const int unthrottled = 1;
+    scheduler->setRateLimit(throttled, rate, 1);
+
+    QList<ChatStream *> streams;
+    for (int i = 0; i < throttledCount; ++i) {
+        streams.append(submit(throttled));
+    }
+    for (int i = 0; i < unthrottledCount; ++i) {
+        streams.append(submit(unthrottled));
+    }
+    for (ChatStream *stream : streams) {
+        QVERIFY(stream->isDone() || waitFinished(stream));
+        QVERIFY2(stream->metrics().ok, qPrintable(stream->metrics().error));
+    }
+
+    QVector<qint64> throttledTimes;
+    QVector<qint64> unthrottledTimes;
+    for (const QJsonValue &value : server->requestLog()) {
+        const QJsonObject entry = value.toObject();
+        const qint64 receivedMs = qint64(entry.value("receivedMs").toDouble());
+        (entry.value("model").toString() == modelAt(throttled) ? throttledTimes : unthrottledTimes).append(receivedMs);
+    }
+    QCOMPARE(throttledTimes.size(), throttledCount);
+    QCOMPARE(unthrottledTimes.size(), unthrottledCount);
+    std::sort(throttledTimes.begin(), throttledTimes.end());
+
+    for (int i = 1; i < throttledTimes.size(); ++i) {
+        const qint64 gap = throttledTimes.at(i) - throttledTimes.at(i - 1);
+        QVERIFY2(gap >= interval - kToleranceMs / 5, qPrintable(QString("request %1 sent %2 ms after the previous one").arg(i).arg(gap)));
+    }
+    // 不限速的模型没有等被限速的模型
+    for (qint64 receivedMs : unthrottledTimes) {
+        QVERIFY2(receivedMs < throttledTimes.at(1), qPrintable(QString("unthrottled request waited until %1 ms").arg(receivedMs)));
+    }
+}
+
+// 同一模型排队时，用户正在等待的请求先于后台请求发出，同优先级先进先出
+void TestRequestScheduler::interactiveBeforeBackground()
+{
+    QVERIFY(startServer(quickOptions()));
+    const int model = 0;
+    // 每 100 ms 发一个：前一个回复在下一个发出前已经结束，结束顺序就是发出顺序
+    scheduler->setRateLimit(model, 10, 1);
+
+    QStringList order;
+    QList<ChatStream *> streams;
+    const QList<QPair<QString, RequestScheduler::Priority> > requests = QList<QPair<QString, RequestScheduler::Priority> >()
+        << qMakePair(QString("first"), RequestScheduler::Normal)
+        << qMakePair(QString("background 1"), RequestScheduler::Background)
+        << qMakePair(QString("background 2"), RequestScheduler::Background)
+        << qMakePair(QString("normal"), RequestScheduler::Normal)
+        << qMakePair(QString("interactive"), RequestScheduler::Interactive);
+    for (const QPair<QString, RequestScheduler::Priority> &request : requests) {
+        ChatStream *stream = submit(model, request.second);
+        const QString name = request.first;
+        connect(stream, &ChatStream::finished, [&order, name]() {
+            order.append(name);
+        });
+        streams.append(stream);
+    }
+    QCOMPARE(scheduler->queuedCount(), requests.size() - 1);
+
+    QTRY_COMPARE_WITH_TIMEOUT(order.size(), requests.size(), kTimeoutMs);
+    QCOMPARE(order, QStringList() << "first" << "interactive" << "normal" << "background 1" << "background 2");
+    for (ChatStream *stream : streams) {
+        QVERIFY2(stream->metrics().ok, qPrintable(stream->metrics().error));
+    }
+}
+
+GSAI_TEST_MAIN(TestRequestScheduler)
+
+#include "tst_requestscheduler.moc"
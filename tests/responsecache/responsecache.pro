@@ -0,0 +1,10 @@
+# 回复缓存：重放、命中统计、过期、按大小淘汰和缓存键
+
+include(../tests.pri)
+
+QT -= gui
+
+TARGET = tst_responsecache
+
+SOURCES += \
+    tst_responsecache.cpp
@@ -0,0 +1,241 @@
+#include "testsupport.h"
+#include "chatengine.h"
+#include "chatstream.h"
+#include "contextbuilder.h"
+#include "requestscheduler.h"
+#include "responsecache.h"
+
+#include <QTemporaryDir>
+#include <QScopedPointer>
+#include <QFile>
+
+namespace {
+
+const int kTimeoutMs = 10000;
+
+QJsonObject message(const QString &role, const QString &content)
+{
+    QJsonObject object;
+    object["role"] = role;
+    object["content"] = content;
+    return object;
+}
+
+// 一轮问答之后又问了一个问题的上下文
+ContextBuilder conversation(const QString &systemPrompt, const QString &question)
+{
+    ContextBuilder context(systemPrompt);
+    context.append(message("user", "最早的问题"));
+    context.append(message("assistant", "最早的回答"));
+    context.append(message("user", "上一个问题"));
+    context.append(message("assistant", "上一个回答"));
+    context.append(message("user", question));
+    return context;
+}
+
+} // namespace
+
+/**
+ * @brief ResponseCache 测试：与 MainWindow 相同的查找 -> 请求 -> 写入流程，
+ * 请求发往独立线程中的模拟服务
+ */
+class TestResponseCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void replayWithoutRequest();
+    void reloadIndex();
+    void timeToLive();
+    void leastRecentlyUsedEviction();
+    void cacheKey_data();
+    void cacheKey();
+    void cacheKeyWindow();
+
+private:
+    // 命中时重放缓存，否则请求模拟服务并在成功后写入缓存；返回已结束的流
+    ChatStream *ask(RequestScheduler *scheduler, const ContextBuilder &context, int model, const QString &modelId);
+    QString entryPath(const QByteArray &key) const { return dir->filePath(QString::fromLatin1(key) + ".sse"); }
+
+    QScopedPointer<QTemporaryDir> dir;
+    QScopedPointer<ResponseCache> cache;
+};
+
+void TestResponseCache::init()
+{
+    dir.reset(new QTemporaryDir);
+    QVERIFY(dir->isValid());
+    cache.reset(new ResponseCache(dir->path()));
+}
+
+void TestResponseCache::cleanup()
+{
+    cache.reset();
+    dir.reset();
+}
+
+ChatStream *TestResponseCache::ask(RequestScheduler *scheduler, const ContextBuilder &context, int model, const QString &modelId)
+{
+    const QByteArray key = context.cacheKey(modelId);
+    QByteArray cached;
+    ChatStream *stream;
+    if (cache->lookup(key, &cached)) {
+        stream = new ChatStream(0, model, modelId, cached, this);
+    } else {
+        stream = scheduler->submit(0, model, context.encodeRequest(modelId, 1 << 20), RequestScheduler::Interactive, this);
+        stream->setCacheKey(key);
+    }
+
+    QSignalSpy finished(stream, &ChatStream::finished);
+    if (finished.wait(kTimeoutMs) && !stream->cacheKey().isEmpty() && stream->metrics().ok) {
+        cache->insert(stream->cacheKey(), stream->recordedStream());
+    }
+    return stream;
+}
+
+// 第二次问同样的问题直接重放缓存，模拟服务只收到一个请求
+void TestResponseCache::replayWithoutRequest()
+{
+    MockServer::Options options;
+    options.port = 0;
+    options.firstTokenMs = 0;
+    options.tokensPerSecond = 0;
+    TestSupport::MockServerThread server(options);
+    QVERIFY(server.start());
+    ChatEngine engine(server.endpoint());
+    RequestScheduler scheduler(&engine);
+    scheduler.setRateLimit(-1, 0, 1);
+    const int model = engine.models().defaultModel();
+    const QString modelId = engine.models().model(model).id;
+    const ContextBuilder context = conversation(ChatEngine::systemPrompt(), "你好");
+
+    QScopedPointer<ChatStream> first(ask(&scheduler, context, model, modelId));
+    QVERIFY2(first->isDone() && first->metrics().ok, qPrintable(first->metrics().error));
+    QVERIFY(!first->isFromCache());
+    QCOMPARE(cache->hits(), 0);
+    QCOMPARE(cache->misses(), 1);
+
+    QScopedPointer<ChatStream> second(ask(&scheduler, context, model, modelId));
+    QVERIFY(second->isDone());
+    QVERIFY(second->isFromCache());
+    QCOMPARE(second->text(), first->text());
+    QCOMPARE(second->text(), MockServer::generatedText(options.replyChars));
+    QCOMPARE(cache->hits(), 1);
+    QCOMPARE(cache->misses(), 1);
+    QCOMPARE(server.requestLog().size(), 1);
+
+    // 换一个问题仍然请求接口
+    QScopedPointer<ChatStream> third(ask(&scheduler, conversation(ChatEngine::systemPrompt(), "再见"), model, modelId));
+    QVERIFY(!third->isFromCache());
+    QCOMPARE(cache->misses(), 2);
+    QCOMPARE(server.requestLog().size(), 2);
+}
+
+// 索引写入后重新打开缓存，条目仍然可以命中；索引中没有的条目文件被删除
+void TestResponseCache::reloadIndex()
+{
+    cache->insert("aaaa", "data: kept\n\n");
+    cache->flush();
+    QFile orphan(entryPath("bbbb"));
+    QVERIFY(orphan.open(QIODevice::WriteOnly));
+    orphan.write("data: orphan\n\n");
+    orphan.close();
+
+    cache.reset(new ResponseCache(dir->path()));
+    QByteArray stream;
+    QVERIFY(cache->lookup("aaaa", &stream));
+    QCOMPARE(stream, QByteArray("data: kept\n\n"));
+    QVERIFY(!QFile::exists(entryPath("bbbb")));
+}
+
+void TestResponseCache::timeToLive()
+{
+    cache->setTimeToLive(1);
+    cache->insert("aaaa", "data: x\n\n");
+    QByteArray stream;
+    QVERIFY(cache->lookup("aaaa", &stream));
+
+    // 过期按整秒计算
+    QTest::qWait(2100);
+    QVERIFY(!cache->lookup("aaaa", &stream));
+    QVERIFY(!QFile::exists(entryPath("aaaa")));
+    QCOMPARE(cache->hits(), 1);
+    QCOMPARE(cache->misses(), 1);
+}
+
+// 总大小超过上限时先淘汰最久没有用到的条目
+void TestResponseCache::leastRecentlyUsedEviction()
+{
+    const QByteArray entry(100, 'x');
+    cache->setMaxBytes(250);
+    cache->insert("aaaa", entry);
+    QTest::qWait(10);
+    cache->insert("bbbb", entry);
+    QTest::qWait(10);
+    QByteArray stream;
+    QVERIFY(cache->lookup("aaaa", &stream));
+    QTest::qWait(10);
+    cache->insert("cccc", entry);
+
+    QVERIFY(!QFile::exists(entryPath("bbbb")));
+    QVERIFY(!cache->lookup("bbbb", &stream));
+    QVERIFY(cache->lookup("aaaa", &stream));
+    QVERIFY(cache->lookup("cccc", &stream));
+
+    // 超过上限的单个回复不缓存
+    cache->insert("dddd", QByteArray(300, 'x'));
+    QVERIFY(!QFile::exists(entryPath("dddd")));
+}
+
+void TestResponseCache::cacheKey_data()
+{
+    QTest::addColumn<QString>("model");
+    QTest::addColumn<QString>("systemPrompt");
+    QTest::addColumn<QString>("question");
+    QTest::addColumn<bool>("sameKey");
+
+    QTest::newRow("identical") << "generalv3.5" << "系统提示词" << "你好" << true;
+    QTest::newRow("whitespace") << "generalv3.5" << "系统提示词" << "  你好 \n" << true;
+    QTest::newRow("model") << "4.0Ultra" << "系统提示词" << "你好" << false;
+    QTest::newRow("system prompt") << "generalv3.5" << "另一个系统提示词" << "你好" << false;
+    QTest::newRow("question") << "generalv3.5" << "系统提示词" << "你好吗" << false;
+}
+
+void TestResponseCache::cacheKey()
+{
+    QFETCH(QString, model);
+    QFETCH(QString, systemPrompt);
+    QFETCH(QString, question);
+    QFETCH(bool, sameKey);
+
+    const QByteArray base = conversation("系统提示词", "你好").cacheKey("generalv3.5");
+    QCOMPARE(conversation(systemPrompt, question).cacheKey(model) == base, sameKey);
+}
+
+// 缓存键只看最近几条消息：更早的消息不同不影响，上一轮回答不同则不命中
+void TestResponseCache::cacheKeyWindow()
+{
+    ContextBuilder base = conversation("系统提示词", "你好");
+
+    ContextBuilder older("系统提示词");
+    older.append(message("user", "另一个最早的问题"));
+    older.append(message("assistant", "最早的回答"));
+    older.append(message("user", "上一个问题"));
+    older.append(message("assistant", "上一个回答"));
+    older.append(message("user", "你好"));
+    QCOMPARE(older.cacheKey("generalv3.5"), base.cacheKey("generalv3.5"));
+
+    ContextBuilder previous("系统提示词");
+    previous.append(message("user", "最早的问题"));
+    previous.append(message("assistant", "最早的回答"));
+    previous.append(message("user", "上一个问题"));
+    previous.append(message("assistant", "另一个回答"));
+    previous.append(message("user", "你好"));
+    QVERIFY(previous.cacheKey("generalv3.5") != base.cacheKey("generalv3.5"));
+}
+
+GSAI_TEST_MAIN(TestResponseCache)
+
+#include "tst_responsecache.moc"
@@ -0,0 +1,14 @@
+# 全文搜索：十万条消息上的查询延迟
+
+include(../tests.pri)
+
+QT -= gui
+
+TARGET = tst_searchindex
+
+SOURCES += \
+    $$PWD/../../searchindex.cpp \
+    tst_searchindex.cpp
+
+HEADERS += \
+    $$PWD/../../searchindex.h
@@ -0,0 +1,142 @@
+#include "testsupport.h"
+#include "searchindex.h"
+
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+
+namespace {
+
+const int kMessages = 100000;              // 索引的消息条数
+const int kMessagesPerConversation = 20;
+const int kRepeats = 20;                   // 统计延迟时每个查询重复的次数
+const qint64 kTargetUs = 10000;            // 每次查询的目标延迟：10 ms
+
+// 组成合成消息的词，中英文混合，出现频率各不相同
+const char *const kWords[] = {
+    "模型", "接口", "回复", "问题", "会话", "消息", "搜索", "索引", "延迟", "缓存",
+    "浙江", "工商", "大学", "学生", "课程", "考试", "图书馆", "食堂", "宿舍", "选课",
+    "星火", "上下文", "流式", "解析", "重试", "限速", "压缩", "连接", "线程", "信号",
+    "qt", "signal", "slot", "widget", "json", "stream", "http", "request", "latency", "thread",
+    "quick", "query", "queue", "model", "message", "search", "index", "cache", "parser", "token",
+};
+const int kWordCount = int(sizeof(kWords) / sizeof(kWords[0]));
+
+// 测试用的查询：名称、内容；最后一个英文单词或单个汉字按前缀匹配
+const char *const kQueries[][2] = {
+    {"common phrase", "模型"},
+    {"long phrase", "浙江工商大学"},
+    {"rare phrase", "图书馆选课"},
+    {"single char prefix", "图"},
+    {"english word", "signal"},
+    {"english prefix", "qu"},
+    {"mixed clauses", "qt 信号 slot"},
+    {"quoted", "\"stream parser\""},
+};
+const int kQueryCount = int(sizeof(kQueries) / sizeof(kQueries[0]));
+
+// 按固定种子生成的消息，词的分布偏向列表前面的词
+QString syntheticMessage(QRandomGenerator &random)
+{
+    QString text;
+    const int words = 10 + random.bounded(40);
+    for (int i = 0; i < words; ++i) {
+        const int index = qMin(random.bounded(kWordCount), random.bounded(kWordCount));
+        const QString word = QString::fromUtf8(kWords[index]);
+        if (!text.isEmpty() && (word.at(0).unicode() < 0x80 || text.at(text.size() - 1).unicode() < 0x80)) {
+            text += ' ';
+        }
+        text += word;
+        if (random.bounded(8) == 0) {
+            text += QStringLiteral("，");
+        }
+    }
+    return text;
+}
+
+} // namespace
+
+/**
+ * @brief SearchIndex 测试：在十万条合成消息上测查询延迟，目标每次 10 ms 以内
+ */
+class TestSearchIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void search_data();
+    void search();
+    void latency();
+
+private:
+    SearchIndex index;
+    QJsonObject report;
+};
+
+void TestSearchIndex::initTestCase()
+{
+    QRandomGenerator random(42);
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < kMessages; ++i) {
+        index.addMessage(i / kMessagesPerConversation, i % kMessagesPerConversation, syntheticMessage(random));
+    }
+    report["messages"] = index.documentCount();
+    report["buildMs"] = timer.elapsed();
+    QCOMPARE(index.documentCount(), kMessages);
+}
+
+void TestSearchIndex::cleanupTestCase()
+{
+    TestSupport::writeReport("searchindex", report);
+}
+
+void TestSearchIndex::search_data()
+{
+    QTest::addColumn<QString>("query");
+
+    for (int i = 0; i < kQueryCount; ++i) {
+        QTest::newRow(kQueries[i][0]) << QString::fromUtf8(kQueries[i][1]);
+    }
+}
+
+void TestSearchIndex::search()
+{
+    QFETCH(QString, query);
+
+    QVector<SearchIndex::Hit> hits;
+    QBENCHMARK {
+        hits = index.search(query);
+    }
+    QVERIFY(!hits.isEmpty());
+}
+
+// 每个查询重复多次，报告延迟分位数（微秒）；超过目标只给出警告，结果与机器有关
+void TestSearchIndex::latency()
+{
+    QJsonObject latencies;
+    for (int i = 0; i < kQueryCount; ++i) {
+        const QString query = QString::fromUtf8(kQueries[i][1]);
+        QVector<qint64> times;
+        for (int repeat = 0; repeat < kRepeats; ++repeat) {
+            QElapsedTimer timer;
+            timer.start();
+            const QVector<SearchIndex::Hit> hits = index.search(query);
+            times.append(timer.nsecsElapsed() / 1000);
+            QVERIFY(!hits.isEmpty());
+        }
+
+        const qint64 median = TestSupport::percentile(times, 50);
+        if (median > kTargetUs) {
+            QWARN(qPrintable(QString("\"%1\" took %2 us, target is %3 us").arg(query).arg(median).arg(kTargetUs)));
+        }
+        latencies[QString::fromUtf8(kQueries[i][0])] = TestSupport::summarize(times);
+    }
+    report["targetUs"] = kTargetUs;
+    report["latencyUs"] = latencies;
+}
+
+GSAI_TEST_MAIN(TestSearchIndex)
+
+#include "tst_searchindex.moc"
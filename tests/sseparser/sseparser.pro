@@ -0,0 +1,10 @@
+# SSE 解析器的吞吐量
+
+include(../tests.pri)
+
+QT -= gui
+
+TARGET = tst_sseparser
+
+SOURCES += \
+    tst_sseparser.cpp
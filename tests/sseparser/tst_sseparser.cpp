@@ -0,0 +1,143 @@
+#include "testsupport.h"
+#include "sseparser.h"
+
+#include <QFile>
+#include <QElapsedTimer>
+
+namespace {
+
+const int kReplyChars = 400000;            // 生成的回复字数，约 5 MB 的 SSE 数据
+const int kDeltaChars = 2;                 // 每个事件的字数，与正式接口相近
+
+} // namespace
+
+/**
+ * @brief SSE 解析器测试：把多 MB 的流按不同大小切块喂给解析器
+ *
+ * 默认使用模拟服务生成的回复；环境变量 GSAI_TEST_RECORDING 指向录制的
+ * SSE 文件（curl -N 的输出或 response_cache/ 中的 .sse）时改用录制的数据。
+ */
+class TestSseParser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void events_data();
+    void events();
+    void throughput_data();
+    void throughput();
+
+private:
+    QByteArray stream;
+    QList<QByteArray> expected;            // 每个事件的 data
+    QJsonObject report;
+};
+
+void TestSseParser::initTestCase()
+{
+    const QString recording = qEnvironmentVariable("GSAI_TEST_RECORDING");
+    if (!recording.isEmpty()) {
+        QFile file(recording);
+        QVERIFY2(file.open(QIODevice::ReadOnly), qPrintable(file.errorString()));
+        stream = file.readAll();
+    } else {
+        const QList<QByteArray> events = MockServer::generateReply(kReplyChars, kDeltaChars);
+        for (const QByteArray &event : events) {
+            stream += event;
+        }
+    }
+
+    // 用整块解析的结果作为各种切块方式的参照
+    SseParser parser;
+    parser.setEventHandler([this](const SseParser::Event &event) {
+        expected.append(QByteArray(event.data, event.size));
+    });
+    parser.feed(stream.constData(), stream.size());
+    parser.finish();
+    QVERIFY(!expected.isEmpty());
+
+    report["source"] = recording.isEmpty() ? QStringLiteral("generated") : recording;
+    report["bytes"] = stream.size();
+    report["events"] = expected.size();
+}
+
+void TestSseParser::cleanupTestCase()
+{
+    TestSupport::writeReport("sseparser", report);
+}
+
+void TestSseParser::events_data()
+{
+    QTest::addColumn<int>("chunkBytes");
+
+    QTest::newRow("1 byte") << 1;
+    QTest::newRow("7 bytes") << 7;
+    QTest::newRow("1460 bytes") << 1460;
+}
+
+// 切块方式不影响解析结果
+void TestSseParser::events()
+{
+    QFETCH(int, chunkBytes);
+
+    QList<QByteArray> parsed;
+    SseParser parser;
+    parser.setEventHandler([&parsed](const SseParser::Event &event) {
+        parsed.append(QByteArray(event.data, event.size));
+    });
+    for (int offset = 0; offset < stream.size(); offset += chunkBytes) {
+        parser.feed(stream.constData() + offset, qMin(chunkBytes, stream.size() - offset));
+    }
+    parser.finish();
+    QCOMPARE(parsed, expected);
+}
+
+void TestSseParser::throughput_data()
+{
+    QTest::addColumn<int>("chunkBytes");
+
+    QTest::newRow("16 bytes") << 16;
+    QTest::newRow("1460 bytes") << 1460;
+    QTest::newRow("64 KB") << 65536;
+}
+
+void TestSseParser::throughput()
+{
+    QFETCH(int, chunkBytes);
+
+    SseParser parser;
+    int count = 0;
+    qint64 dataBytes = 0;
+    parser.setEventHandler([&count, &dataBytes](const SseParser::Event &event) {
+        ++count;
+        dataBytes += event.size;
+    });
+
+    qint64 bytes = 0;
+    qint64 elapsedNs = 0;
+    QBENCHMARK {
+        QElapsedTimer timer;
+        timer.start();
+        parser.reset();
+        count = 0;
+        for (int offset = 0; offset < stream.size(); offset += chunkBytes) {
+            parser.feed(stream.constData() + offset, qMin(chunkBytes, stream.size() - offset));
+        }
+        parser.finish();
+        elapsedNs += timer.nsecsElapsed();
+        bytes += stream.size();
+    }
+    QCOMPARE(count, expected.size());
+    QVERIFY(dataBytes > 0);
+
+    QJsonObject result;
+    result["chunkBytes"] = chunkBytes;
+    result["megabytesPerSecond"] = elapsedNs > 0 ? bytes / 1048576.0 / (elapsedNs / 1e9) : 0.0;
+    report[QString::fromLatin1(QTest::currentDataTag())] = result;
+}
+
+GSAI_TEST_MAIN(TestSseParser)
+
+#include "tst_sseparser.moc"
@@ -0,0 +1,23 @@
+# 各测试共用的设置：QtTest、聊天核心、进程内的模拟服务和测试工具
+
+QT += testlib network
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+# 报告目录，运行时可以用环境变量 GSAI_TEST_REPORT_DIR 改掉
+DEFINES += GSAI_TEST_REPORT_DIR=\\\"$$clean_path($$OUT_PWD/../reports)\\\"
+
+include($$PWD/../core.pri)
+include($$PWD/../mock/mock.pri)
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += \
+    $$PWD/testsupport.cpp
+
+HEADERS += \
+    $$PWD/testsupport.h
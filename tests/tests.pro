@@ -0,0 +1,16 @@
+# 测试和基准测试。构建后运行 make check；每个测试的结果（含 QBENCHMARK 数据）
+# 写成 XML 报告，需要分位数等汇总的测试另外写 JSON 报告，都放在 reports/ 下
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    chatview \
+    contextbuilder \
+    conversationsummarizer \
+    deltaextractor \
+    endtoend \
+    persistence \
+    requestscheduler \
+    responsecache \
+    searchindex \
+    sseparser
@@ -0,0 +1,137 @@
+#include "testsupport.h"
+#include "chatengine.h"
+#include "contextbuilder.h"
+
+#include <QDir>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <algorithm>
+
+#ifndef GSAI_TEST_REPORT_DIR
+#define GSAI_TEST_REPORT_DIR "reports"
+#endif
+
+namespace TestSupport {
+
+void setUp()
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+}
+
+int exec(QObject *test, int argc, char *argv[])
+{
+    QStringList arguments;
+    bool hasOutput = false;
+    for (int i = 0; i < argc; ++i) {
+        const QString argument = QString::fromLocal8Bit(argv[i]);
+        hasOutput = hasOutput || argument == QLatin1String("-o");
+        arguments.append(argument);
+    }
+
+    // 同时输出到控制台和 XML 报告，运行 make check 就能得到机器可读的结果
+    if (!hasOutput) {
+        const QString report = QDir(reportDir()).filePath(QString::fromLatin1(test->metaObject()->className()) + ".xml");
+        arguments << "-o" << report + ",xml" << "-o" << "-,txt";
+    }
+    return QTest::qExec(test, arguments);
+}
+
+QString reportDir()
+{
+    QString dir = qEnvironmentVariable("GSAI_TEST_REPORT_DIR", QString::fromUtf8(GSAI_TEST_REPORT_DIR));
+    QDir().mkpath(dir);
+    return dir;
+}
+
+void writeReport(const QString &name, const QJsonObject &report)
+{
+    QSaveFile file(QDir(reportDir()).filePath(name + ".json"));
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(report).toJson()) < 0 || !file.commit()) {
+        qWarning() << "Failed to write report" << file.fileName() << file.errorString();
+    }
+}
+
+QByteArray requestBody(const ChatEngine &engine, int model, const QString &prompt)
+{
+    ContextBuilder context(ChatEngine::systemPrompt());
+    QJsonObject message;
+    message["role"] = "user";
+    message["content"] = prompt;
+    context.append(message);
+    return context.encodeRequest(engine.models().model(model).id, engine.models().budget(model));
+}
+
+qint64 percentile(QVector<qint64> values, int percent)
+{
+    if (values.isEmpty()) {
+        return -1;
+    }
+    std::sort(values.begin(), values.end());
+    int index = qBound(0, (values.size() * percent + 99) / 100 - 1, values.size() - 1);
+    return values.at(index);
+}
+
+QJsonObject summarize(const QVector<qint64> &values)
+{
+    QJsonObject summary;
+    summary["count"] = values.size();
+    summary["p50"] = percentile(values, 50);
+    summary["p90"] = percentile(values, 90);
+    summary["p99"] = percentile(values, 99);
+    summary["max"] = percentile(values, 100);
+    return summary;
+}
+
+MockServerThread::MockServerThread(const MockServer::Options &options)
+    : server(new MockServer(options))
+    , listenPort(0)
+{
+    server->moveToThread(&thread);
+    QObject::connect(&thread, &QThread::finished, server, &QObject::deleteLater);
+    thread.start();
+}
+
+MockServerThread::~MockServerThread()
+{
+    thread.quit();
+    thread.wait();
+}
+
+bool MockServerThread::start()
+{
+    bool ok = false;
+    MockServer *target = server;
+    quint16 *port = &listenPort;
+    QMetaObject::invokeMethod(server, [target, port, &ok]() {
+        ok = target->start();
+        *port = target->port();
+    }, Qt::BlockingQueuedConnection);
+    return ok;
+}
+
+QUrl MockServerThread::endpoint() const
+{
+    return QUrl(QString("http://127.0.0.1:%1/v1/chat/completions").arg(listenPort));
+}
+
+QJsonArray MockServerThread::requestLog() const
+{
+    QJsonArray log;
+    MockServer *target = server;
+    QMetaObject::invokeMethod(server, [target, &log]() {
+        log = target->requestLog();
+    }, Qt::BlockingQueuedConnection);
+    return log;
+}
+
+void MockServerThread::scriptFaults(const QList<MockServer::Fault> &faults)
+{
+    MockServer *target = server;
+    QMetaObject::invokeMethod(server, [target, faults]() {
+        target->scriptFaults(faults);
+    }, Qt::BlockingQueuedConnection);
+}
+
+} // namespace TestSupport
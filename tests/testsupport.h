@@ -0,0 +1,86 @@
+#ifndef TESTSUPPORT_H
+#define TESTSUPPORT_H
+
+#include <QtTest>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QVector>
+#include <QThread>
+#include <QUrl>
+#include "mockserver.h"
+
+class ChatEngine;
+
+#ifdef QT_WIDGETS_LIB
+#include <QApplication>
+#define GSAI_TEST_APPLICATION QApplication
+#else
+#define GSAI_TEST_APPLICATION QCoreApplication
+#endif
+
+/**
+ * @brief 测试和基准测试共用的工具
+ *
+ * 报告写到构建目录的 tests/reports/ 下（环境变量 GSAI_TEST_REPORT_DIR 可以
+ * 改掉）：每个测试的 QtTest 结果为 <测试类名>.xml，QBENCHMARK 的数据也在其中；
+ * 需要分位数等汇总的测试另外用 writeReport() 写 JSON。
+ */
+namespace TestSupport {
+
+// 没有指定显示平台时使用 offscreen，界面测试不需要显示器；在构造应用对象之前调用
+void setUp();
+// 运行测试对象。命令行没有 -o 时结果同时输出到控制台和 <报告目录>/<测试类名>.xml
+int exec(QObject *test, int argc, char *argv[]);
+
+// 报告目录，不存在时创建
+QString reportDir();
+// 写入 <报告目录>/<name>.json
+void writeReport(const QString &name, const QJsonObject &report);
+
+// 只有一个问题的请求体，与界面发出的相同
+QByteArray requestBody(const ChatEngine &engine, int model, const QString &prompt);
+
+// values 的第 percent 百分位，没有数据时为 -1
+qint64 percentile(QVector<qint64> values, int percent);
+// 毫秒数组的汇总：count、p50、p90、p99、max
+QJsonObject summarize(const QVector<qint64> &values);
+
+/**
+ * @brief 在独立线程中运行的模拟服务
+ *
+ * 服务端生成和发送事件的开销不占用被测客户端所在的主线程。
+ */
+class MockServerThread
+{
+public:
+    explicit MockServerThread(const MockServer::Options &options);
+    ~MockServerThread();
+
+    // 在服务线程中开始监听，失败时返回 false
+    bool start();
+    // chat/completions 接口地址
+    QUrl endpoint() const;
+    // 服务已处理完的请求（拷贝）
+    QJsonArray requestLog() const;
+    // 见 MockServer::scriptFaults()
+    void scriptFaults(const QList<MockServer::Fault> &faults);
+
+private:
+    QThread thread;
+    MockServer *server;
+    quint16 listenPort;
+};
+
+} // namespace TestSupport
+
+// 代替 QTEST_MAIN：选择显示平台，并默认写 XML 报告
+#define GSAI_TEST_MAIN(TestObject) \
+int main(int argc, char *argv[]) \
+{ \
+    TestSupport::setUp(); \
+    GSAI_TEST_APPLICATION app(argc, argv); \
+    TestObject test; \
+    return TestSupport::exec(&test, argc, argv); \
+}
+
+#endif // TESTSUPPORT_H